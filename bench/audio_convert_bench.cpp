@@ -0,0 +1,101 @@
+// 音频采样格式转换 microbenchmark: FLTP -> 交错 S16(同采样率), swr 与 SIMD 内核对比
+// 用法: xmake build audio_convert_bench && xmake run audio_convert_bench [声道数] [每帧采样数]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <player/audio_kernels.hpp>
+#include <player/ffmpeg.hpp>
+#include <random>
+#include <vector>
+
+constexpr int kSampleRate = 48000;
+constexpr int kIterations = 20000;
+constexpr int kMixTracks = 4;
+
+template <typename F>
+static double MeasureNsPerSample(F&& fn, int nb_samples) {
+    fn();  // 预热
+    auto start = std::chrono::steady_clock::now();
+    for (int i{0}; i < kIterations; ++i) {
+        fn();
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / kIterations / nb_samples;
+}
+
+int main(int argc, char* argv[]) {
+    int nb_channels{argc > 1 ? atoi(argv[1]) : 2};
+    int nb_samples{argc > 2 ? atoi(argv[2]) : 1024};  // AAC 一帧 1024, Opus 20ms 一帧 960
+    if (nb_channels <= 0 || nb_samples <= 0) {
+        fprintf(stderr, "usage: %s [channels] [samples]\n", argv[0]);
+        return -1;
+    }
+
+    std::mt19937 rng{42};
+    std::uniform_real_distribution<float> dist{-1.2f, 1.2f};  // 含少量越界样本, 覆盖削波
+    std::vector<std::vector<float>> planes(nb_channels, std::vector<float>(nb_samples));
+    std::vector<float const*> in;
+    for (auto& plane : planes) {
+        for (float& x : plane) {
+            x = dist(rng);
+        }
+        in.push_back(plane.data());
+    }
+    std::vector<int16_t> out(nb_samples * nb_channels);
+    std::vector<int16_t> ref(nb_samples * nb_channels);
+
+    // ================== swr ==================
+    AVChannelLayout ch_layout;
+    av_channel_layout_default(&ch_layout, nb_channels);
+    SwrContext* swr_context{nullptr};
+    swr_alloc_set_opts2(&swr_context, &ch_layout, AV_SAMPLE_FMT_S16, kSampleRate, &ch_layout, AV_SAMPLE_FMT_FLTP,
+                        kSampleRate, 0, nullptr);
+    if (!swr_context || swr_init(swr_context) < 0) {
+        fprintf(stderr, "swr_init failed\n");
+        return -1;
+    }
+    uint8_t* swr_out{reinterpret_cast<uint8_t*>(ref.data())};
+    uint8_t const** swr_in{reinterpret_cast<uint8_t const**>(in.data())};
+    double swr_ns = MeasureNsPerSample(
+        [&] { swr_convert(swr_context, &swr_out, nb_samples, swr_in, nb_samples); }, nb_samples * nb_channels);
+    printf("fltp -> s16, %d ch x %d samples\n", nb_channels, nb_samples);
+    printf("  %-8s %8.3f ns/sample\n", "swr", swr_ns);
+
+    // ================== SIMD 内核 ==================
+    for (SimdLevel level : {SimdLevel::kScalar, SimdLevel::kSse2, SimdLevel::kAvx2}) {
+        AudioKernels kernels{GetAudioKernels(level)};
+        auto convert = [&] { kernels.fltp_to_s16(out.data(), in.data(), nb_channels, nb_samples, 1.0f); };
+        double ns = MeasureNsPerSample(convert, nb_samples * nb_channels);
+        // 与 swr 的结果对比(取整方式可能不同, 允许 1 的误差)
+        int max_diff{0};
+        for (size_t i{0}; i < out.size(); ++i) {
+            max_diff = std::max(max_diff, std::abs(out[i] - ref[i]));
+        }
+        printf("  %-8s %8.3f ns/sample  %5.2fx  max diff vs swr: %d\n", SimdLevelName(level), ns, swr_ns / ns,
+               max_diff);
+    }
+
+    // ================== 音量 / 混音 ==================
+    std::vector<std::vector<int16_t>> tracks(kMixTracks, ref);
+    std::vector<int16_t const*> srcs;
+    for (auto& track : tracks) {
+        srcs.push_back(track.data());
+    }
+    float gains[kMixTracks]{0.5f, 0.25f, 0.25f, 0.1f};
+    int total{nb_samples * nb_channels};
+    printf("scale_s16 / mix_s16 (%d tracks)\n", kMixTracks);
+    for (SimdLevel level : {SimdLevel::kScalar, SimdLevel::kSse2, SimdLevel::kAvx2}) {
+        AudioKernels kernels{GetAudioKernels(level)};
+        double scale_ns = MeasureNsPerSample([&] { kernels.scale_s16(out.data(), total, 0.999f); }, total);
+        double mix_ns =
+            MeasureNsPerSample([&] { kernels.mix_s16(out.data(), srcs.data(), gains, kMixTracks, total); }, total);
+        printf("  %-8s scale %8.3f ns/sample  mix %8.3f ns/sample\n", SimdLevelName(level), scale_ns, mix_ns);
+    }
+
+    swr_free(&swr_context);
+    av_channel_layout_uninit(&ch_layout);
+    return 0;
+}
@@ -0,0 +1,282 @@
+// 暂停空闲测试: 暂停期间进程里的线程(除了下面明确排除的)都不应该再被调度, 即没有轮询也没有定时唤醒
+// 按线程读 /proc/self/task/<tid>/status 的上下文切换次数(自愿 + 非自愿), 比较暂停窗口前后的差值;
+// 不依赖线程自己上报的 wakeup_count_, 原始输出线程、SDL 定时器线程、ffmpeg 的解码线程都统计在内
+// 两个用例各在一个子进程中运行: 原始输出(--raw-video/--raw-audio 写到 /dev/null), 以及正常的 SDL 播放
+// (dummy 视频/音频驱动, 辅助线程像用户一样按空格暂停/恢复). 和性能基线无关, 任何机器上结果都应该相同
+// 用法: xmake build pause_idle_test && xmake run pause_idle_test [--idle-ms <ms>]
+
+#include <dirent.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <player/read_thread.hpp>
+#include <player/video_thread.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_media.hpp"
+
+SDL_Window* window = nullptr;
+SDL_Renderer* renderer = nullptr;
+
+constexpr double kMediaDuration = 10.0;  // 生成的媒体时长(秒), 远长于暂停窗口, 暂停时管线一定还在播放中
+constexpr int kDefaultIdleMs = 1000;     // 统计上下文切换的暂停窗口
+constexpr int kSettleIntervalMs = 100;   // 暂停后等管线停稳的采样间隔
+constexpr int kSettleTimeoutMs = 3000;   // 一直停不稳(有线程在轮询)时最多等这么久, 之后照样测量并报告
+
+static BenchCase const kTestCase{AV_CODEC_ID_MPEG4, 640, 360, {25, 1}, kGopIp, "stereo"};
+
+// ================== 按线程采样 ==================
+
+struct ThreadSample {
+    std::string name_;     // /proc/self/task/<tid>/comm(线程名, 最多 15 个字符)
+    int64_t switches_{0};  // 自愿 + 非自愿上下文切换次数
+};
+
+using ThreadSamples = std::map<pid_t, ThreadSample>;
+
+static ThreadSamples SampleThreads() {
+    ThreadSamples samples;
+    DIR* dir{opendir("/proc/self/task")};
+    if (!dir) {
+        return samples;
+    }
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        std::string task{std::string{"/proc/self/task/"} + entry->d_name};
+        std::ifstream comm{task + "/comm"};
+        std::ifstream status{task + "/status"};
+        ThreadSample sample;
+        if (!std::getline(comm, sample.name_)) {
+            continue;  // 线程在 readdir 之后退出了
+        }
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.starts_with("voluntary_ctxt_switches:") || line.starts_with("nonvoluntary_ctxt_switches:")) {
+                sample.switches_ += atoll(line.c_str() + line.find(':') + 1);
+            }
+        }
+        samples[atoi(entry->d_name)] = sample;
+    }
+    closedir(dir);
+    return samples;
+}
+
+// 暂停期间允许被调度的线程
+static bool IsExcluded(pid_t tid, ThreadSample const& sample, bool sdl) {
+    if (tid == gettid()) {
+        return true;  // 测量线程自己
+    }
+    if (sample.name_.starts_with("SDLAudio")) {
+        return true;  // SDL 的音频设备线程: SDL_PauseAudio(1) 只是让它改为输出静音, 线程按缓冲周期一直运行
+    }
+    // dummy 视频驱动不支持阻塞等待事件, SDL_WaitEvent 在主线程每毫秒轮询一次(真实的 X11/Wayland 下是阻塞的)
+    return sdl && tid == getpid();
+}
+
+// 两次采样之间被调度过的线程(期间新建的线程也算), 每项形如 "ReadThread(1234): 37"
+static std::vector<std::string> ActiveThreads(ThreadSamples const& before, ThreadSamples const& after, bool sdl) {
+    std::vector<std::string> active;
+    for (auto const& [tid, sample] : after) {
+        if (IsExcluded(tid, sample, sdl)) {
+            continue;
+        }
+        auto it = before.find(tid);
+        int64_t switches{sample.switches_ - (it == before.end() ? 0 : it->second.switches_)};
+        if (switches > 0 || it == before.end()) {
+            active.push_back(sample.name_ + "(" + std::to_string(tid) + "): " + std::to_string(switches));
+        }
+    }
+    return active;
+}
+
+// 暂停后先等管线停稳(解码线程要填满帧队列、读线程要填满包队列, 不能一暂停就计数):
+// 连续两次采样之间没有线程被调度就算停稳. 然后在 idle_ms 的窗口内统计, 有线程被调度就失败
+static int CheckPausedIdle(bool sdl, int idle_ms) {
+    ThreadSamples settled{SampleThreads()};
+    int64_t deadline{av_gettime_relative() + kSettleTimeoutMs * 1000LL};
+    while (av_gettime_relative() < deadline) {
+        SDL_Delay(kSettleIntervalMs);
+        ThreadSamples sample{SampleThreads()};
+        bool quiet{ActiveThreads(settled, sample, sdl).empty()};
+        settled = std::move(sample);
+        if (quiet) {
+            break;
+        }
+    }
+    SDL_Delay(idle_ms);
+    std::vector<std::string> active{ActiveThreads(settled, SampleThreads(), sdl)};
+    for (std::string const& thread : active) {
+        printf("    %s context switches while paused\n", thread.c_str());
+    }
+    return active.empty() ? 0 : -1;
+}
+
+// ================== 用例 ==================
+
+static int WaitStreamsOpened(VideoState* video_state) {
+    std::unique_lock lk{video_state->state_mtx_};
+    video_state->state_cv_.wait(lk, [&] { return video_state->quit_ || video_state->streams_opened_; });
+    return video_state->quit_ ? -1 : 0;
+}
+
+// 无窗口的原始输出: 流打开后立即暂停, 测量后恢复并等它播完(确认暂停没有把管线卡死)
+static int RunRawCase(std::string const& path, int idle_ms) {
+    std::string program{"pause_idle_test"};
+    std::string raw_video{"--raw-video"};
+    std::string raw_audio{"--raw-audio"};
+    std::string null_path{"/dev/null"};
+    std::string input{path};
+    char* argv[]{program.data(), raw_video.data(), null_path.data(), raw_audio.data(), null_path.data(),
+                 input.data()};
+    PlayerOptions options;
+    if (ParseOptions(&options, static_cast<int>(std::size(argv)), argv) < 0) {
+        return -1;
+    }
+    VideoState* video_state{OpenStream(options)};
+    if (!video_state) {
+        return -1;
+    }
+    int ret{WaitStreamsOpened(video_state)};
+    if (ret == 0) {
+        TogglePause(video_state);
+        ret = CheckPausedIdle(false, idle_ms);
+        TogglePause(video_state);
+        std::unique_lock lk{video_state->state_mtx_};
+        video_state->state_cv_.wait(lk, [&] { return video_state->quit_ || video_state->raw_sinks_running_ == 0; });
+    }
+    RequestQuit(video_state);
+    JoinVideoState(video_state);
+    RawSink const* video_sink{&video_state->raw_video_sink_};
+    RawSink const* audio_sink{&video_state->raw_audio_sink_};
+    if (video_sink->error_ < 0 || audio_sink->error_ < 0 || video_sink->nb_frames_ == 0 ||
+        audio_sink->nb_frames_ == 0) {
+        printf("    raw output did not finish after resume\n");
+        ret = -1;
+    }
+    return ret;
+}
+
+static void PushKey(SDL_Keycode key) {
+    SDL_Event event{};
+    event.type = SDL_KEYDOWN;
+    event.key.keysym.sym = key;
+    SDL_PushEvent(&event);
+}
+
+// 正常播放: 主线程跑 SdlEventLoop, 辅助线程按空格暂停, 测量后再按空格恢复, 最后发退出事件
+// 没有显示器和声卡也能跑(dummy 驱动), 设置了 SDL_VIDEODRIVER/SDL_AUDIODRIVER 时用指定的驱动
+static int RunSdlCase(std::string const& path, int idle_ms) {
+    setenv("SDL_VIDEODRIVER", "dummy", 0);
+    setenv("SDL_AUDIODRIVER", "dummy", 0);
+    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_TIMER)) {
+        printf("    cannot initialize SDL: %s\n", SDL_GetError());
+        return -1;
+    }
+    window = SDL_CreateWindow("pause_idle_test", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, kDefaultWidth,
+                              kDefaultHeight, 0);
+    renderer = window ? SDL_CreateRenderer(window, -1, 0) : nullptr;
+    if (!window || !renderer) {
+        printf("    cannot create window or renderer: %s\n", SDL_GetError());
+        return -1;
+    }
+
+    std::string program{"pause_idle_test"};
+    std::string input{path};
+    char* argv[]{program.data(), input.data()};
+    PlayerOptions options;
+    if (ParseOptions(&options, static_cast<int>(std::size(argv)), argv) < 0) {
+        return -1;
+    }
+    VideoState* video_state{OpenStream(options)};
+    if (!video_state) {
+        return -1;
+    }
+    int ret{-1};
+    std::thread driver{[&] {
+        if (WaitStreamsOpened(video_state) == 0) {
+            // 按键由主线程的事件循环处理, 等它真正切换了状态再继续
+            PushKey(SDLK_SPACE);
+            while (!video_state->paused_) {
+                SDL_Delay(1);
+            }
+            ret = CheckPausedIdle(true, idle_ms);
+            PushKey(SDLK_SPACE);
+            while (video_state->paused_) {
+                SDL_Delay(1);
+            }
+        }
+        SDL_Event quit{};
+        quit.type = SDL_QUIT;
+        SDL_PushEvent(&quit);
+    }};
+    SdlEventLoop(video_state);  // 收到 SDL_QUIT 后结束所有线程并 SDL_Quit
+    driver.join();
+    return ret;
+}
+
+// 每个用例一个子进程: SDL 和全局状态每次都是新的, /proc/self/task 里也只有这个用例的线程
+static int RunInChild(int (*run)(std::string const&, int), std::string const& path, int idle_ms) {
+    fflush(stdout);
+    pid_t pid{fork()};
+    if (pid < 0) {
+        perror("fork");
+        return -1;
+    }
+    if (pid == 0) {
+        av_log_set_level(AV_LOG_WARNING);
+        int ret{run(path, idle_ms)};
+        fflush(stdout);
+        _exit(ret < 0 ? 1 : 0);  // 不做全局析构, 读线程等留下的对象随进程回收
+    }
+    int status{0};
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+int main(int argc, char* argv[]) {
+    av_log_set_level(AV_LOG_ERROR);
+    int idle_ms{kDefaultIdleMs};
+    for (int i{1}; i < argc; ++i) {
+        std::string arg{argv[i]};
+        if (arg == "--idle-ms" && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            idle_ms = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--idle-ms <ms>]\n", argv[0]);
+            return -1;
+        }
+    }
+
+    std::string path{CreateTempMediaPath("pause_idle_test")};
+    if (path.empty()) {
+        return 1;
+    }
+    if (GenerateMedia(kTestCase, kMediaDuration, path) < 0) {
+        unlink(path.c_str());
+        return 1;
+    }
+
+    struct PauseCase {
+        char const* name_;
+        int (*run_)(std::string const&, int);
+    };
+    PauseCase const cases[]{{"raw", RunRawCase}, {"sdl", RunSdlCase}};
+    int nb_failed{0};
+    for (PauseCase const& c : cases) {
+        printf("%s:\n", c.name_);
+        bool ok{RunInChild(c.run_, path, idle_ms) == 0};
+        printf("    %s\n", ok ? "idle while paused" : "FAILED");
+        nb_failed += !ok;
+    }
+    unlink(path.c_str());
+    printf("%d failed (%d ms paused window)\n", nb_failed, idle_ms);
+    return nb_failed ? 1 : 0;
+}
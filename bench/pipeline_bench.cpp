@@ -0,0 +1,341 @@
+// 管线性能回归测试: 在进程内生成测试媒体(见 test_media.hpp), 不需要任何媒体文件和网络
+// 每个用例在子进程中通过 OpenStream/ReadThread/DecodeThread 跑一遍无窗口的原始输出(写到 /dev/null),
+// 记录吞吐、首帧时间、峰值 RSS 和音视频覆盖范围之差, 与保存的基线比较, 超出容差时返回非 0
+// 基线文件不存在或缺少某个用例时算失败, 需要用 --update-baseline 显式生成
+// 用法: xmake build pipeline_bench && xmake run pipeline_bench [--full] [--duration <s>] [--filter <substr>]
+//       [--baseline <file>] [--tolerance <ratio>] [--update-baseline]
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <player/read_thread.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "test_media.hpp"
+
+SDL_Window* window = nullptr;  // 原始输出模式不开窗口, 只是满足 video_thread.cpp 的链接
+SDL_Renderer* renderer = nullptr;
+
+constexpr double kDefaultDuration = 10.0;   // 每个用例生成的媒体时长(秒)
+constexpr double kDefaultTolerance = 0.15;  // 吞吐/首帧时间/峰值 RSS 允许偏离基线的比例
+constexpr double kSpanSlack = 0.005;        // 音视频覆盖范围之差允许比基线多出的绝对值(秒)
+constexpr double kFirstFrameSlack = 0.005;  // 首帧时间很短时比例容差太严, 额外允许的绝对值(秒)
+constexpr char const* kDefaultBaseline = "bench/pipeline_baseline.txt";
+
+struct BenchResult {
+    double fps_{0};              // 每秒解码输出的视频帧数
+    double first_frame_{0};      // OpenStream 到第一帧写出的时间(秒)
+    double peak_rss_{0};         // 子进程的峰值 RSS(MiB)
+    double span_mismatch_{0};    // 音视频输出覆盖的时间区间起止之差(秒, 见 RawOutputSpanMismatch)
+    int64_t nb_frames_{0};
+    int64_t nb_samples_{0};
+    int ok_{0};
+};
+
+static BenchCase const kReferenceCase{AV_CODEC_ID_MPEG4, 1280, 720, {25, 1}, kGopIp, "stereo"};
+
+// 默认矩阵: 以参考用例为中心每次只改变一个维度; --full 时为全组合
+static std::vector<BenchCase> BuildMatrix(bool full) {
+    std::vector<AVCodecID> codecs{AV_CODEC_ID_MPEG4, AV_CODEC_ID_MPEG2VIDEO, AV_CODEC_ID_H264};
+    std::vector<std::pair<int, int>> sizes{{640, 360}, {1280, 720}, {1920, 1080}};
+    std::vector<AVRational> rates{{25, 1}, {60, 1}};
+    std::vector<GopStructure> gops{kGopIntra, kGopIp, kGopIbp};
+    std::vector<char const*> layouts{"mono", "stereo", "5.1"};
+    BenchCase const& reference{kReferenceCase};
+
+    std::vector<BenchCase> cases;
+    if (full) {
+        for (AVCodecID codec_id : codecs) {
+            for (auto [width, height] : sizes) {
+                for (AVRational rate : rates) {
+                    for (GopStructure gop : gops) {
+                        for (char const* layout : layouts) {
+                            cases.push_back({codec_id, width, height, rate, gop, layout});
+                        }
+                    }
+                }
+            }
+        }
+        return cases;
+    }
+    cases.push_back(reference);
+    auto add = [&](BenchCase c) {
+        if (c.Name() != reference.Name()) {
+            cases.push_back(c);
+        }
+    };
+    for (AVCodecID codec_id : codecs) {
+        BenchCase c{reference};
+        c.codec_id_ = codec_id;
+        add(c);
+    }
+    for (auto [width, height] : sizes) {
+        BenchCase c{reference};
+        c.width_ = width;
+        c.height_ = height;
+        add(c);
+    }
+    for (AVRational rate : rates) {
+        BenchCase c{reference};
+        c.frame_rate_ = rate;
+        add(c);
+    }
+    for (GopStructure gop : gops) {
+        BenchCase c{reference};
+        c.gop_ = gop;
+        add(c);
+    }
+    for (char const* layout : layouts) {
+        BenchCase c{reference};
+        c.layout_ = layout;
+        add(c);
+    }
+    return cases;
+}
+
+// ================== 运行管线 ==================
+
+// 在子进程中运行: 和 --raw-video/--raw-audio 完全相同的路径, 只是输出写到 /dev/null
+static BenchResult RunPipeline(std::string const& path) {
+    BenchResult result;
+    std::string program{"pipeline_bench"};
+    std::string raw_video{"--raw-video"};
+    std::string raw_audio{"--raw-audio"};
+    std::string null_path{"/dev/null"};
+    std::string input{path};
+    char* argv[]{program.data(), raw_video.data(), null_path.data(), raw_audio.data(), null_path.data(),
+                 input.data()};
+    PlayerOptions options;
+    if (ParseOptions(&options, static_cast<int>(std::size(argv)), argv) < 0) {
+        return result;
+    }
+
+    int64_t start_time{av_gettime_relative()};
+    VideoState* video_state{OpenStream(options)};
+    if (!video_state) {
+        return result;
+    }
+    {
+        std::unique_lock lk{video_state->state_mtx_};
+        video_state->state_cv_.wait(lk, [&] {
+            return video_state->quit_ || (video_state->streams_opened_ && video_state->raw_sinks_running_ == 0);
+        });
+    }
+    RequestQuit(video_state);
+    JoinVideoState(video_state);
+    double elapsed{(av_gettime_relative() - start_time) / 1000000.0};
+
+    RawSink const* video_sink{&video_state->raw_video_sink_};
+    RawSink const* audio_sink{&video_state->raw_audio_sink_};
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    result.nb_frames_ = video_sink->nb_frames_;
+    result.nb_samples_ = audio_sink->nb_frames_;
+    result.fps_ = video_sink->nb_frames_ / std::max(elapsed, 1e-6);
+    result.first_frame_ = (video_sink->first_write_time_ - start_time) / 1000000.0;  // 没有输出时 ok_ 为 0, 不会用到
+    result.peak_rss_ = usage.ru_maxrss / 1024.0;  // Linux 上单位为 KiB
+    result.span_mismatch_ = RawOutputSpanMismatch(video_state);
+    result.ok_ = video_sink->error_ == 0 && audio_sink->error_ == 0 && video_sink->nb_frames_ > 0 &&
+                 audio_sink->nb_frames_ > 0 && !std::isnan(result.span_mismatch_);
+    return result;
+}
+
+// 每个用例一个子进程: 峰值 RSS 互不影响, 全局状态(内存记账等)每次都是新的, 某个用例崩溃也不影响其他用例
+static BenchResult RunCase(std::string const& path) {
+    BenchResult result;
+    int fds[2];
+    if (pipe(fds) < 0) {
+        fprintf(stderr, "pipe failed: %s\n", strerror(errno));
+        return result;
+    }
+    pid_t pid{fork()};
+    if (pid < 0) {
+        fprintf(stderr, "fork failed: %s\n", strerror(errno));
+        close(fds[0]);
+        close(fds[1]);
+        return result;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        av_log_set_level(AV_LOG_WARNING);
+        BenchResult child{RunPipeline(path)};
+        ssize_t n{write(fds[1], &child, sizeof(child))};
+        _exit(n == sizeof(child) ? 0 : 1);  // 不做全局析构, 读线程等留下的对象随进程回收
+    }
+    close(fds[1]);
+    ssize_t n{read(fds[0], &result, sizeof(result))};
+    close(fds[0]);
+    int status{0};
+    waitpid(pid, &status, 0);
+    if (n != sizeof(result) || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "pipeline process failed (status %d)\n", status);
+        result = BenchResult{};
+    }
+    return result;
+}
+
+// 生成用例的媒体到临时文件, 运行后删除
+static BenchResult RunCaseOnTempMedia(BenchCase const& c, double duration) {
+    BenchResult result;
+    std::string path{CreateTempMediaPath("pipeline_bench")};
+    if (path.empty()) {
+        return result;
+    }
+    if (GenerateMedia(c, duration, path) == 0) {
+        result = RunCase(path);
+    }
+    unlink(path.c_str());
+    return result;
+}
+
+// ================== 基线 ==================
+
+// 每行一个用例: 名称 fps 首帧时间(秒) 峰值RSS(MiB) 音视频覆盖范围之差(秒), # 之后为注释
+static std::map<std::string, BenchResult> LoadBaseline(std::string const& path) {
+    std::map<std::string, BenchResult> baseline;
+    std::ifstream file{path};
+    std::string line;
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream in{line};
+        std::string name;
+        BenchResult result;
+        if (in >> name >> result.fps_ >> result.first_frame_ >> result.peak_rss_ >> result.span_mismatch_) {
+            result.ok_ = 1;
+            baseline[name] = result;
+        }
+    }
+    return baseline;
+}
+
+static int SaveBaseline(std::string const& path, std::map<std::string, BenchResult> const& baseline) {
+    FILE* file{fopen(path.c_str(), "w")};
+    if (!file) {
+        fprintf(stderr, "cannot write %s: %s\n", path.c_str(), strerror(errno));
+        return -1;
+    }
+    fprintf(file, "# pipeline_bench baseline: name fps first_frame(s) peak_rss(MiB) av_span_mismatch(s)\n");
+    fprintf(file, "# machine specific, regenerate with --update-baseline after intended changes\n");
+    for (auto const& [name, result] : baseline) {
+        fprintf(file, "%s %.2f %.4f %.1f %.4f\n", name.c_str(), result.fps_, result.first_frame_, result.peak_rss_,
+                result.span_mismatch_);
+    }
+    fclose(file);
+    return 0;
+}
+
+// 和基线比较, 返回回退的指标(空字符串表示没有回退)
+static std::string CompareBaseline(BenchResult const& result, BenchResult const& base, double tolerance) {
+    std::string regressions;
+    if (result.fps_ < base.fps_ * (1 - tolerance)) {
+        regressions += " fps";
+    }
+    if (result.first_frame_ > base.first_frame_ * (1 + tolerance) + kFirstFrameSlack) {
+        regressions += " first-frame";
+    }
+    if (result.peak_rss_ > base.peak_rss_ * (1 + tolerance)) {
+        regressions += " rss";
+    }
+    if (result.span_mismatch_ > base.span_mismatch_ + kSpanSlack) {
+        regressions += " av-span";
+    }
+    return regressions;
+}
+
+static void PrintUsage(char const* program) {
+    fprintf(stderr,
+            "usage: %s [--full] [--duration <s>] [--filter <substr>] [--baseline <file>] [--tolerance <ratio>]\n"
+            "       [--update-baseline]\n",
+            program);
+}
+
+int main(int argc, char* argv[]) {
+    av_log_set_level(AV_LOG_ERROR);
+    bool full{false};
+    bool update_baseline{false};
+    double duration{kDefaultDuration};
+    double tolerance{kDefaultTolerance};
+    std::string filter;
+    std::string baseline_path{kDefaultBaseline};
+    for (int i{1}; i < argc; ++i) {
+        std::string arg{argv[i]};
+        bool has_value{i + 1 < argc};
+        if (arg == "--full") {
+            full = true;
+        } else if (arg == "--update-baseline") {
+            update_baseline = true;
+        } else if (arg == "--duration" && has_value && atof(argv[i + 1]) > 0) {
+            duration = atof(argv[++i]);
+        } else if (arg == "--tolerance" && has_value && atof(argv[i + 1]) > 0) {
+            tolerance = atof(argv[++i]);
+        } else if (arg == "--filter" && has_value) {
+            filter = argv[++i];
+        } else if (arg == "--baseline" && has_value) {
+            baseline_path = argv[++i];
+        } else {
+            PrintUsage(argv[0]);
+            return -1;
+        }
+    }
+
+    std::map<std::string, BenchResult> baseline{LoadBaseline(baseline_path)};
+    // 没有基线就比较不出回退, 不能当作通过; 基线和机器相关, 只能显式生成
+    if (baseline.empty() && !update_baseline) {
+        fprintf(stderr, "no baseline at %s, run with --update-baseline on this machine to record one\n",
+                baseline_path.c_str());
+        return 1;
+    }
+
+    int nb_failed{0};
+    int nb_regressed{0};
+    int nb_missing{0};  // 基线里没有的用例(比如基线不是用 --full 生成的)
+    printf("%-40s %9s %9s %9s %9s  %s\n", "case", "fps", "ttff ms", "rss MiB", "span ms", "vs baseline");
+    for (BenchCase const& c : BuildMatrix(full)) {
+        std::string name{c.Name()};
+        if (!filter.empty() && name.find(filter) == std::string::npos) {
+            continue;
+        }
+        BenchResult result{RunCaseOnTempMedia(c, duration)};
+        if (!result.ok_) {
+            printf("%-40s %9s\n", name.c_str(), "FAILED");
+            ++nb_failed;
+            continue;
+        }
+
+        std::string verdict{update_baseline ? "new" : "NO BASELINE"};
+        auto it = baseline.find(name);
+        if (it == baseline.end()) {
+            nb_missing += !update_baseline;
+        } else {
+            std::string regressions{CompareBaseline(result, it->second, tolerance)};
+            verdict = regressions.empty() ? "ok" : "REGRESSED:" + regressions;
+            nb_regressed += !regressions.empty();
+            verdict += " (" + std::to_string(static_cast<int>(std::lround(100 * (result.fps_ / it->second.fps_ - 1)))) +
+                       "% fps)";
+        }
+        printf("%-40s %9.1f %9.1f %9.1f %9.2f  %s\n", name.c_str(), result.fps_, result.first_frame_ * 1000,
+               result.peak_rss_, result.span_mismatch_ * 1000, verdict.c_str());
+        fflush(stdout);
+        if (update_baseline) {
+            baseline[name] = result;
+        }
+    }
+
+    if (update_baseline && SaveBaseline(baseline_path, baseline) == 0) {
+        printf("baseline written to %s\n", baseline_path.c_str());
+    }
+    printf("%d failed, %d regressed, %d without baseline (tolerance %.0f%%)\n", nb_failed, nb_regressed, nb_missing,
+           tolerance * 100);
+    return nb_failed || nb_missing || (nb_regressed && !update_baseline) ? 1 : 0;
+}
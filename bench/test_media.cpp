@@ -0,0 +1,230 @@
+#include "test_media.hpp"
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+extern "C" {
+#include <libavutil/opt.h>
+}
+
+// 一路生成器: 源滤镜 -> (a)buffersink -> 编码器 -> 输出流
+struct Generator {
+    AVFilterGraph* graph_{nullptr};
+    AVFilterContext* sink_{nullptr};
+    AVCodecContext* codec_context_{nullptr};
+    AVStream* stream_{nullptr};
+    AVFrame* frame_{nullptr};
+    AVPacket* packet_{nullptr};
+    int64_t next_pts_{0};  // 下一帧的时间戳(编码器时间基), 用来交错写两路
+    bool done_{false};
+};
+
+static void FreeGenerator(Generator* gen) {
+    avfilter_graph_free(&gen->graph_);
+    avcodec_free_context(&gen->codec_context_);
+    av_frame_free(&gen->frame_);
+    av_packet_free(&gen->packet_);
+}
+
+static int BuildSourceGraph(Generator* gen, std::string const& desc, bool audio) {
+    gen->graph_ = avfilter_graph_alloc();
+    AVFilter const* sink{avfilter_get_by_name(audio ? "abuffersink" : "buffersink")};
+    if (!gen->graph_ || !sink ||
+        avfilter_graph_create_filter(&gen->sink_, sink, "out", nullptr, nullptr, gen->graph_) < 0) {
+        fprintf(stderr, "cannot create %s\n", audio ? "abuffersink" : "buffersink");
+        return -1;
+    }
+    AVFilterInOut* inputs{avfilter_inout_alloc()};
+    AVFilterInOut* outputs{nullptr};
+    if (!inputs) {
+        return -1;
+    }
+    inputs->name = av_strdup("out");
+    inputs->filter_ctx = gen->sink_;
+    inputs->pad_idx = 0;
+    inputs->next = nullptr;
+    int ret{avfilter_graph_parse_ptr(gen->graph_, desc.c_str(), &inputs, &outputs, nullptr)};
+    avfilter_inout_free(&inputs);
+    avfilter_inout_free(&outputs);
+    if (ret < 0 || avfilter_graph_config(gen->graph_, nullptr) < 0) {
+        fprintf(stderr, "cannot build filter graph: %s\n", desc.c_str());
+        return -1;
+    }
+    return 0;
+}
+
+static int OpenEncoder(Generator* gen, AVFormatContext* format_context, AVCodec const* codec) {
+    if (format_context->oformat->flags & AVFMT_GLOBALHEADER) {
+        gen->codec_context_->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+    if (avcodec_open2(gen->codec_context_, codec, nullptr) < 0) {
+        fprintf(stderr, "cannot open encoder %s\n", codec->name);
+        return -1;
+    }
+    gen->stream_ = avformat_new_stream(format_context, nullptr);
+    gen->frame_ = av_frame_alloc();
+    gen->packet_ = av_packet_alloc();
+    if (!gen->stream_ || !gen->frame_ || !gen->packet_ ||
+        avcodec_parameters_from_context(gen->stream_->codecpar, gen->codec_context_) < 0) {
+        return -1;
+    }
+    gen->stream_->time_base = gen->codec_context_->time_base;
+    return 0;
+}
+
+static int OpenVideoGenerator(Generator* gen, AVFormatContext* format_context, BenchCase const& c,
+                              double duration) {
+    AVCodec const* codec{avcodec_find_encoder(c.codec_id_)};
+    if (!codec) {
+        fprintf(stderr, "no %s encoder in this ffmpeg build\n", avcodec_get_name(c.codec_id_));
+        return -1;
+    }
+    char desc[256];
+    snprintf(desc, sizeof(desc), "testsrc2=size=%dx%d:rate=%d/%d:duration=%g,format=yuv420p", c.width_, c.height_,
+             c.frame_rate_.num, c.frame_rate_.den, duration);
+    if (BuildSourceGraph(gen, desc, false) < 0) {
+        return -1;
+    }
+    gen->codec_context_ = avcodec_alloc_context3(codec);
+    if (!gen->codec_context_) {
+        return -1;
+    }
+    AVCodecContext* ctx{gen->codec_context_};
+    ctx->width = c.width_;
+    ctx->height = c.height_;
+    ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+    ctx->time_base = av_inv_q(c.frame_rate_);
+    ctx->framerate = c.frame_rate_;
+    ctx->gop_size = c.gop_.gop_size_;
+    ctx->max_b_frames = c.gop_.max_b_frames_;
+    ctx->bit_rate = static_cast<int64_t>(0.1 * c.width_ * c.height_ * av_q2d(c.frame_rate_));  // 约 0.1 bit/像素
+    if (c.codec_id_ == AV_CODEC_ID_H264) {
+        av_opt_set(ctx->priv_data, "preset", "veryfast", 0);  // 只影响生成速度, 测的是解码
+    }
+    return OpenEncoder(gen, format_context, codec);
+}
+
+static int OpenAudioGenerator(Generator* gen, AVFormatContext* format_context, BenchCase const& c,
+                              double duration) {
+    AVCodec const* codec{avcodec_find_encoder(AV_CODEC_ID_AAC)};
+    if (!codec) {
+        fprintf(stderr, "no aac encoder in this ffmpeg build\n");
+        return -1;
+    }
+    // 每秒一声短促的提示音, 和 testsrc2 的计时画面一样便于人工核对同步
+    char desc[256];
+    snprintf(desc, sizeof(desc),
+             "sine=frequency=1000:beep_factor=4:sample_rate=%d:duration=%g,"
+             "aformat=sample_fmts=fltp:channel_layouts=%s",
+             kAudioSampleRate, duration, c.layout_);
+    if (BuildSourceGraph(gen, desc, true) < 0) {
+        return -1;
+    }
+    gen->codec_context_ = avcodec_alloc_context3(codec);
+    if (!gen->codec_context_) {
+        return -1;
+    }
+    AVCodecContext* ctx{gen->codec_context_};
+    if (av_channel_layout_from_string(&ctx->ch_layout, c.layout_) < 0) {
+        fprintf(stderr, "bad channel layout %s\n", c.layout_);
+        return -1;
+    }
+    ctx->sample_fmt = AV_SAMPLE_FMT_FLTP;
+    ctx->sample_rate = kAudioSampleRate;
+    ctx->time_base = av_make_q(1, kAudioSampleRate);
+    ctx->bit_rate = 64000 * ctx->ch_layout.nb_channels;
+    if (OpenEncoder(gen, format_context, codec) < 0) {
+        return -1;
+    }
+    av_buffersink_set_frame_size(gen->sink_, ctx->frame_size);  // aac 每帧固定 1024 个采样
+    return 0;
+}
+
+// 把编码器中已有的包都写出去
+static int DrainEncoder(Generator* gen, AVFormatContext* format_context) {
+    while (true) {
+        int ret{avcodec_receive_packet(gen->codec_context_, gen->packet_)};
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            return 0;
+        }
+        if (ret < 0) {
+            return ret;
+        }
+        av_packet_rescale_ts(gen->packet_, gen->codec_context_->time_base, gen->stream_->time_base);
+        gen->packet_->stream_index = gen->stream_->index;
+        ret = av_interleaved_write_frame(format_context, gen->packet_);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+}
+
+// 从滤镜取一帧送进编码器, 滤镜结束时冲刷编码器
+static int StepGenerator(Generator* gen, AVFormatContext* format_context) {
+    int ret{av_buffersink_get_frame(gen->sink_, gen->frame_)};
+    if (ret == AVERROR_EOF) {
+        gen->done_ = true;
+        ret = avcodec_send_frame(gen->codec_context_, nullptr);
+    } else if (ret >= 0) {
+        gen->frame_->pts = av_rescale_q(gen->frame_->pts, av_buffersink_get_time_base(gen->sink_),
+                                        gen->codec_context_->time_base);
+        gen->frame_->pict_type = AV_PICTURE_TYPE_NONE;
+        gen->next_pts_ = gen->frame_->pts + (gen->frame_->nb_samples > 0 ? gen->frame_->nb_samples : 1);
+        ret = avcodec_send_frame(gen->codec_context_, gen->frame_);
+        av_frame_unref(gen->frame_);
+    }
+    if (ret < 0) {
+        return ret;
+    }
+    return DrainEncoder(gen, format_context);
+}
+
+int GenerateMedia(BenchCase const& c, double duration, std::string const& path) {
+    AVFormatContext* format_context{nullptr};
+    if (avformat_alloc_output_context2(&format_context, nullptr, "matroska", path.c_str()) < 0) {
+        return -1;
+    }
+    Generator video;
+    Generator audio;
+    int ret{-1};
+    if (OpenVideoGenerator(&video, format_context, c, duration) >= 0 &&
+        OpenAudioGenerator(&audio, format_context, c, duration) >= 0 &&
+        avio_open(&format_context->pb, path.c_str(), AVIO_FLAG_WRITE) >= 0 &&
+        avformat_write_header(format_context, nullptr) >= 0) {
+        ret = 0;
+        // 按时间戳交错生成两路, 让复用器的交错缓冲保持很小
+        while (ret >= 0 && (!video.done_ || !audio.done_)) {
+            bool video_first{!video.done_ &&
+                             (audio.done_ || av_compare_ts(video.next_pts_, video.codec_context_->time_base,
+                                                           audio.next_pts_, audio.codec_context_->time_base) <= 0)};
+            ret = StepGenerator(video_first ? &video : &audio, format_context);
+        }
+        if (ret >= 0) {
+            ret = av_write_trailer(format_context);
+        }
+    }
+    if (ret < 0) {
+        fprintf(stderr, "failed to generate %s\n", c.Name().c_str());
+    }
+    FreeGenerator(&video);
+    FreeGenerator(&audio);
+    avio_closep(&format_context->pb);
+    avformat_free_context(format_context);
+    return ret < 0 ? -1 : 0;
+}
+
+std::string CreateTempMediaPath(char const* prefix) {
+    char const* tmpdir{getenv("TMPDIR")};
+    std::string path{std::string{tmpdir ? tmpdir : "/tmp"} + "/" + prefix + "_XXXXXX.mkv"};
+    int fd{mkstemps(path.data(), 4)};
+    if (fd < 0) {
+        fprintf(stderr, "mkstemps failed: %s\n", strerror(errno));
+        return {};
+    }
+    close(fd);
+    return path;
+}
@@ -0,0 +1,43 @@
+// 测试媒体生成: 用 libavfilter(testsrc2/sine) + libavcodec 在进程内生成 matroska 文件, 不需要任何媒体文件和网络
+// pipeline_bench 和 pause_idle_test 共用
+
+#pragma once
+
+#include <cstdio>
+#include <player/ffmpeg.hpp>
+#include <string>
+
+constexpr int kAudioSampleRate = 48000;
+
+// GOP 结构
+struct GopStructure {
+    char const* name_;
+    int gop_size_;
+    int max_b_frames_;
+};
+
+constexpr GopStructure kGopIntra{"intra", 1, 0};  // 全 I 帧
+constexpr GopStructure kGopIp{"ip", 50, 0};       // I + P
+constexpr GopStructure kGopIbp{"ibp", 50, 2};     // I + P + B(解码顺序和显示顺序不同)
+
+struct BenchCase {
+    AVCodecID codec_id_;
+    int width_;
+    int height_;
+    AVRational frame_rate_;
+    GopStructure gop_;
+    char const* layout_;  // 音频声道布局(av_channel_layout_from_string 的格式)
+
+    std::string Name() const {
+        char name[128];
+        snprintf(name, sizeof(name), "%s_%dx%d_%g_%s_%s", avcodec_get_name(codec_id_), width_, height_,
+                 av_q2d(frame_rate_), gop_.name_, layout_);
+        return name;
+    }
+};
+
+// 生成 duration 秒的音视频到 path, 失败返回 -1
+int GenerateMedia(BenchCase const& c, double duration, std::string const& path);
+
+// 在 $TMPDIR(默认 /tmp) 下创建一个空的 .mkv 临时文件, 返回路径; 失败返回空字符串. 用完由调用方 unlink
+std::string CreateTempMediaPath(char const* prefix);
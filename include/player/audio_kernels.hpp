@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+// 音频采样格式转换 / 音量 / 混音的 SIMD 内核(AVX2 / SSE2, 其余走标量)
+// 只处理同采样率、同声道布局的情况, 真正的重采样仍然交给 swr
+
+enum class SimdLevel { kScalar, kSse2, kAvx2 };
+
+struct AudioKernels {
+    // 平面 float(FLTP) -> 交错 S16, 乘音量并饱和到 [-32768, 32767]
+    void (*fltp_to_s16)(int16_t *dst, float const *const *src, int nb_channels, int nb_samples, float volume);
+    // S16 原地乘音量(饱和)
+    void (*scale_s16)(int16_t *buf, int nb_samples, float volume);
+    // dst = sum(srcs[i] * gains[i]), 饱和; nb_samples 为所有声道的样本总数
+    void (*mix_s16)(int16_t *dst, int16_t const *const *srcs, float const *gains, int nb_tracks, int nb_samples);
+};
+
+// 当前 CPU 支持的最优实现(只检测一次)
+AudioKernels const &GetAudioKernels();
+
+// 指定指令集的实现, CPU 不支持时退回到支持的最高级别(benchmark 用)
+AudioKernels GetAudioKernels(SimdLevel level);
+
+char const *SimdLevelName(SimdLevel level);
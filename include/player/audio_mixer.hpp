@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <memory>
+#include <player/executor.hpp>
+#include <player/ffmpeg.hpp>
+#include <string>
+#include <vector>
+
+// 混音源: 解码协程把 PCM 转成设备格式(S16 交错)写入环形缓冲, 音频回调从中读取
+// 单生产者单消费者, 读写位置都是单调递增的样本计数, 回调中不加锁
+struct MixerSource {
+    std::string name_;
+    std::vector<int16_t> ring_;           // 容量固定, 决定了这个源最多能积压多少延迟
+    std::atomic<uint64_t> read_pos_{0};   // 回调已读到的位置
+    std::atomic<uint64_t> write_pos_{0};  // 生产者已写到的位置
+    std::atomic<size_t> space_wanted_{0};  // 挂起的生产者需要的空闲样本数
+    std::atomic<bool> space_waiting_{false};  // 生产者挂起等待空间, 回调或中止时把它交回执行器
+    std::atomic<float> gain_{1.0f};
+    std::atomic<bool> muted_{false};
+    std::atomic<bool> solo_{false};
+    std::atomic<bool> eof_{false};  // 生产者已结束, 之后读空不算欠载
+    std::atomic<bool> abort_{false};
+    std::atomic<int64_t> underruns_{0};  // 回调取数据时缓冲不足的次数
+
+    // 以下只由生产者使用
+    SwrContext *swr_context_{nullptr};
+    std::vector<int16_t> convert_buffer_;
+    size_t pending_pos_{0};  // convert_buffer_ 中还没写进环形缓冲的部分 [pending_pos_, pending_end_)
+    size_t pending_end_{0};
+    std::coroutine_handle<> space_waiter_;  // space_waiting_ 为 true 时有效
+};
+
+struct AudioMixer {
+    int sample_rate_{0};
+    AVChannelLayout ch_layout_{};
+    std::vector<std::unique_ptr<MixerSource>> sources_;  // 音频回调启动后不再增删
+    std::vector<int16_t> scratch_;                       // 回调中每个源的连续副本(环形缓冲可能回绕)
+    int scratch_samples_{0};                             // 每个源的副本能放下的样本数
+    Executor executor_;                                  // 所有源的解码协程共用这一个线程
+};
+
+int InitAudioMixer(AudioMixer *mixer, int sample_rate, AVChannelLayout const *ch_layout, int callback_bytes);
+
+MixerSource *AddMixerSource(AudioMixer *mixer, std::string const &name, float gain);
+
+int ConvertMixerFrame(AudioMixer const *mixer, MixerSource *source, AVFrame *frame);
+
+int FlushMixerSource(MixerSource *source);
+
+// co_await WaitMixerSpace(source): 挂起到环形缓冲腾出足够的空间(或者混音器中止), 期间执行器去跑别的源
+struct MixerSpaceAwaiter {
+    MixerSource *source_;
+
+    bool await_ready() const;
+    bool await_suspend(std::coroutine_handle<> handle);
+    void await_resume() const noexcept {}
+};
+
+inline MixerSpaceAwaiter WaitMixerSpace(MixerSource *source) { return MixerSpaceAwaiter{source}; }
+
+void MixAudio(AudioMixer *mixer, int16_t *stream, int nb_samples);
+
+bool AnySoloMixerSource(AudioMixer const *mixer);
+
+void AbortAudioMixer(AudioMixer *mixer);
+
+void DestroyAudioMixer(AudioMixer *mixer);
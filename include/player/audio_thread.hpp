@@ -1,9 +1,20 @@
 #pragma once
 
 #include <cmath>
+#include <memory>
 #include <player/common.hpp>
 #include <player/const.hpp>
 #include <player/core.hpp>
 #include <player/ffmpeg.hpp>
 
-int OpenAudio(void* opaque, AVChannelLayout* wanted_channel_layout, int wanted_sample_rate);
\ No newline at end of file
+int OpenAudio(void* opaque, AVChannelLayout* wanted_channel_layout, int wanted_sample_rate);
+
+int ReopenAudio(VideoState* video_state, int samples);
+
+void FreeAudioBuffer(VideoState* video_state);
+
+int StartMixSources(VideoState* video_state, int callback_bytes);
+
+int OpenRawAudio(void* opaque, AVChannelLayout* wanted_channel_layout, int wanted_sample_rate);
+
+int RawAudioThread(void* arg);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+struct VideoState;
+
+// 自动调优(--auto-tune)的测量结果
+struct AutoTuneStats {
+    // 解码线程: 每帧的解码(含像素格式转换)耗时, 不含等待队列的时间
+    int64_t nb_frames_{0};
+    double decode_time_sum_{0};
+    double decode_time_sq_sum_{0};
+    double decode_time_max_{0};
+    double frame_duration_{0};  // 最近一帧的时长(秒)
+
+    // 音频回调: 相邻两次回调的间隔比一个缓冲的时长晚了多少
+    int64_t nb_callbacks_{0};
+    int64_t last_callback_time_{0};
+    double callback_lateness_max_{0};
+};
+
+// 开始播放后采集解码耗时和音频回调的抖动, 然后选出不卡顿的最小队列深度和音频缓冲
+// 解码线程和音频回调只在 collecting_ 期间加锁记录, 调整在主线程进行
+struct AutoTune {
+    std::atomic<bool> collecting_{false};
+    std::mutex mtx_;
+    AutoTuneStats stats_;
+};
+
+void StartAutoTune(VideoState *video_state);
+
+void RecordDecodeTime(AutoTune *tune, double decode_time, double frame_duration);
+
+void RecordAudioCallback(AutoTune *tune, double buffer_time);
+
+void FinishAutoTune(VideoState *video_state);
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <player/ffmpeg.hpp>
+#include <string>
+#include <vector>
+
+struct VideoState;
+
+// 剪辑用的包: 读线程放进队列前另外引用一份
+struct ClipPacket {
+    AVPacket *packet_{nullptr};
+    bool video_{false};
+    double time_{0};  // dts(没有时用 pts)换算成秒, 只用于裁剪环形缓冲
+};
+
+// 最近 N 秒的包(--clip-seconds), 按 GOP 分组: 每组从一个视频关键帧开始, 只整组丢弃
+// 所以剪辑总是从关键帧开始, 覆盖至少 N 秒(最多再多一个 GOP), 转封装时不需要重新编码
+// 只记录当前条目的当前音视频轨, 换条目或换轨时清空(新的流参数不同)
+struct ClipRing {
+    double seconds_{0};  // 0 表示不记录
+    std::mutex mtx_;
+    std::deque<std::vector<ClipPacket>> gops_;
+    AVStream const *video_stream_{nullptr};  // 正在记录的流(只用来判断是否换了流)
+    AVStream const *audio_stream_{nullptr};
+    AVCodecParameters *video_par_{nullptr};  // 流参数的拷贝, 剪辑线程转封装时使用
+    AVCodecParameters *audio_par_{nullptr};
+    AVRational video_time_base_{0, 1};
+    AVRational audio_time_base_{0, 1};
+};
+
+enum class CaptureKind {
+    kScreenshot,  // 正在显示的一帧编码成 PNG/JPEG
+    kClip,        // 环形缓冲中的包转封装成 MP4(编码格式 MP4 不支持时用 MKV)
+    kStop,        // 处理完之前的任务后退出
+};
+
+// 交给截图/剪辑线程的任务, 编码和写文件都不在显示线程上进行
+struct CaptureJob {
+    CaptureKind kind_{CaptureKind::kStop};
+    AVFrame *frame_{nullptr};  // 截图: 显示队列中那一帧的引用(av_frame_clone, 不拷贝像素)
+    double pts_{0};
+    std::string path_;  // 不含扩展名
+};
+
+void RecordClipPacket(ClipRing *ring, AVStream const *stream, AVPacket const *packet);
+
+void FreeClipRing(ClipRing *ring);
+
+int RequestScreenshot(VideoState *video_state);
+
+int RequestClip(VideoState *video_state);
+
+void StopCaptureThread(VideoState *video_state);
@@ -7,11 +7,76 @@ constexpr int kDefaultHeight = 540;
 // constexpr int kScreenLeft = SDL_WINDOWPOS_CENTERED; // 窗口左上角的 x 坐标
 // constexpr int kScreenTop = SDL_WINDOWPOS_CENTERED;  // 窗口左上角的 y 坐标
 constexpr int kVideoPictureQueueSize = 3;
+constexpr int kFrameQueueSize = 16;  // FrameQueue 的默认槽数(队列深度的上限)
 constexpr int kFFRefreshEvent = SDL_USEREVENT + 1;
+constexpr int kFFAutoTuneEvent = SDL_USEREVENT + 2;
 constexpr int kMaxQueueSize = 15 * 1024 * 1024;
 constexpr int kSdlAudioBufferSize = 1024;
 constexpr double kMaxAvSyncThreshold = 0.1;
 constexpr double kMinAvSyncThreshold = 0.04;
 constexpr double kAvNoSyncThreshold = 10.0;
 constexpr int kScreenWidth = 960;
-constexpr int kScreenHeight = 540;
\ No newline at end of file
+constexpr int kScreenHeight = 540;
+constexpr double kPlaylistPreloadTime = 5.0;  // 当前条目剩余多少秒时开始预加载下一个条目
+constexpr int kPlaylistPrimePackets = 32;     // 预加载时预先读出的包数
+constexpr float kVolumeStep = 0.1f;           // 每次按键调节的音量
+constexpr float kMaxVolume = 2.0f;            // 软件音量上限(超过 1.0 的部分会饱和削波)
+constexpr int kMaxMixerSources = 8;           // 最多混入的音频源数(F1-F8 控制)
+constexpr double kMixerBufferTime = 0.2;      // 每个混音源环形缓冲的时长(秒), 即该源的最大延迟
+constexpr int kFilterQueueSize = 8;           // --vf 时解码线程和滤镜线程之间的帧队列深度(滤镜偶尔变慢时解码不停)
+
+// ================== Thumbnails ==================
+constexpr int kDefaultThumbnailCount = 16;   // 每个文件默认的缩略图数量(4x4 拼图)
+constexpr int kDefaultThumbnailWidth = 320;  // 缩略图默认宽度
+constexpr int kThumbnailJpegQuality = 3;     // JPEG 拼图的 qscale(2-31, 越小质量越高)
+
+// ================== Analysis ==================
+constexpr int kSegmentsPerWorker = 4;   // 每个工作线程分到的段数(段越多负载越均衡, 段首的重复解码也越多)
+constexpr int kSegmentQueueFrames = 8;  // 每段已解码未消费的帧数上限(限制内存)
+constexpr int kFrameHashBatch = 32;     // 攒够多少帧交给线程池并行计算哈希
+
+// ================== Raw Output ==================
+constexpr int kRawPipeSize = 1024 * 1024;  // 输出到管道时申请的管道容量(不超过 /proc/sys/fs/pipe-max-size)
+constexpr int kShmRingSlots = 8;           // 共享内存帧环的槽数(消费者落后超过这么多帧就会丢帧)
+
+// ================== Low Latency ==================
+constexpr int kLowLatencyMaxQueueSize = 256 * 1024;  // 低延迟模式下 PacketQueue 的上限
+constexpr int kLowLatencyPictureQueueSize = 2;       // 低延迟模式下 FrameQueue 的深度(keep_last 至少需要 2)
+constexpr int kLowLatencyAudioBufferSize = 256;      // 低延迟模式下 SDL 音频缓冲的采样数
+constexpr double kDefaultTargetLatency = 0.2;        // 默认目标延迟(秒)
+constexpr int kLiveRetryDelay = 10;                  // 网络直播流暂时没有数据(EAGAIN/EOF)时重试的间隔(毫秒)
+
+// ================== Capture ==================
+constexpr int kMaxPendingCaptures = 16;      // 截图/剪辑线程积压的任务上限(超过时丢掉新的请求)
+constexpr double kClipAudioGroupTime = 1.0;  // 没有视频时剪辑环形缓冲按多少秒分组裁剪
+
+// ================== Subtitle ==================
+constexpr int kSubtitleQueueSize = 16;          // 解码后等待显示的字幕条数
+constexpr int kSubtitleAtlasSize = 2048;        // 字形/字幕位图图集纹理的边长
+constexpr double kSubtitleFontScale = 0.055;    // 字号占视频显示高度的比例
+constexpr int kSubtitleMinFontSize = 12;        // 字号下限(像素)
+constexpr double kSubtitleOutlineScale = 0.08;  // 描边宽度占字号的比例(至少 1 像素)
+constexpr double kSubtitleMargin = 0.05;        // 文字字幕离视频底边的距离占显示高度的比例
+constexpr double kSubtitleMaxWidth = 0.9;       // 文字字幕一行最多占显示宽度的比例, 超出时换行
+// 没有 --sub-font 时依次尝试的字体(中日韩字体优先)
+constexpr char const *kDefaultSubtitleFonts[] = {
+    "/usr/share/fonts/opentype/noto/NotoSansCJK-Regular.ttc",
+    "/usr/share/fonts/noto-cjk/NotoSansCJK-Regular.ttc",
+    "/usr/share/fonts/truetype/wqy/wqy-microhei.ttc",
+    "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf",
+    "/usr/share/fonts/TTF/DejaVuSans.ttf",
+    "C:/Windows/Fonts/msyh.ttc",
+    "C:/Windows/Fonts/arial.ttf",
+    "/System/Library/Fonts/PingFang.ttc",
+    "/System/Library/Fonts/Helvetica.ttc",
+};
+
+// ================== Memory ==================
+constexpr double kMemorySoftLimit = 0.75;        // 占用超过上限的这个比例后开始收缩预读量和帧队列深度
+constexpr int kMemoryMinQueueSize = 256 * 1024;  // 收缩后每个 PacketQueue 至少还能预读的字节数
+
+// ================== Auto Tune ==================
+constexpr int kAutoTuneTime = 5000;                // 开始播放后采集多久(毫秒)再调整队列深度和音频缓冲
+constexpr int kAutoTuneMinFrames = 30;             // 至少采集到这么多视频帧才调整(否则继续采集)
+constexpr int kAutoTuneMinCallbacks = 50;          // 至少采集到这么多次音频回调才调整
+constexpr int kAutoTuneMaxAudioBufferSize = 8192;  // 自动调优选出的 SDL 音频缓冲上限(采样数)
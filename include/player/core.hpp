@@ -1,13 +1,23 @@
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <string>
+#include <vector>
 
 //
+#include <player/audio_mixer.hpp>
+#include <player/auto_tune.hpp>
+#include <player/capture.hpp>
 #include <player/ffmpeg.hpp>
-
-constexpr int kFrameQueueSize = 16;
+#include <player/memory_governor.hpp>
+#include <player/mtx_queue.hpp>
+#include <player/options.hpp>
+#include <player/raw_output.hpp>
+#include <player/shm_ring.hpp>
+#include <player/subtitle.hpp>
+#include <player/video_filter.hpp>
 
 struct MyAVPacketList {
     AVPacket *pkt;
@@ -16,10 +26,12 @@ struct MyAVPacketList {
 struct PacketQueue {
     AVFifo *pkt_list_; /* ffmpeg封装的队列数据结构，里面的数据对象是MyAVPacketList */
     int nb_packets_;   /* 队列中当前的packet数 */
-    int size_;         /* 队列所有节点占用的总内存大小 */
+    int64_t size_;     /* 队列所有节点占用的总内存大小(含 AVPacket 和缓冲区的开销) */
     int64_t duration_; /* 队列中所有节点的合计时长 */
+    int abort_request_; /* 是否中止队列(退出时唤醒所有阻塞在队列上的线程) */
     std::mutex mtx_;
-    std::condition_variable cv_;  // 队列是否为空的条件变量
+    std::condition_variable cv_;          // 队列是否为空的条件变量
+    std::condition_variable cv_notfull_;  // 队列是否未满的条件变量(读线程等待消费者取走数据)
 };
 
 struct Frame {
@@ -31,25 +43,60 @@ struct Frame {
     int height_;
     int format_;
     AVRational sar_;
+    int64_t arrival_time_; /* 对应的包被读到的时间(av_gettime_relative, 仅低延迟模式), 用于测量端到端延迟 */
+    AVSubtitle sub_;       /* 字幕队列: 解码出的字幕(width_/height_ 为画布大小), 显示端取走时清零 */
 };
 
 struct FrameQueue {
-    Frame queue_[kFrameQueueSize]; /* 用于存放帧数据的队列 */
+    Frame *queue_;                 /* 用于存放帧数据的队列(capacity_ 个槽) */
+    int capacity_;                 /* 槽数, 读写索引按它回绕 */
     int rindex_;                   /* 读索引 */
     int windex_;                   /* 写索引 */
     int size_;                     /* 队列中的帧数 */
-    int max_size_;                 /* 队列最大缓存的帧数 */
+    int max_size_;                 /* 队列最大缓存的帧数(不超过 capacity_, 播放中可以调整) */
     int keep_last_;                /* 播放后是否在队列中保留上一帧不销毁 */
     int rindex_shown_;             /* keep_last的实现，读的时候实际上读的是rindex + rindex_shown，分析见下 */
+    int eof_;                      /* 生产者已结束(播放列表结束), 不会再有新帧 */
     std::mutex mtx_;
     std::condition_variable cv_notfull_;   // 队列是否为空的条件变量
     std::condition_variable cv_notempty_;  // 队列是否为满的条件变量
     PacketQueue *pktq_;                    // 关联的 PacketQueue
 };
 
+// 播放列表中的一个条目(已打开的解复用器, 预加载时还会打开解码器)
+struct MediaItem {
+    std::string file_name_;
+    AVFormatContext *format_context_{nullptr};
+    int video_stream_idx_{-1};
+    int audio_stream_idx_{-1};
+    int subtitle_stream_idx_{-1};
+    AVCodecContext *video_codec_context_{nullptr};
+    AVCodecContext *audio_codec_context_{nullptr};
+    AVCodecContext *subtitle_codec_context_{nullptr};
+    std::vector<AVPacket *> primed_packets_;  // 预加载时预先读出的包, 切换时先送入队列
+};
+
+// 解码器交接: 读线程在条目结束时把下一个条目的解码器交给解码线程(与空包一一对应)
+struct DecoderHandoff {
+    AVCodecContext *codec_context_;
+    AVRational frame_rate_;
+    double pts_offset_;  // 下一个条目的时间戳偏移(秒), 保证跨条目的时钟连续
+};
+
+// 空包是否表示换轨(丢弃解码器缓存), 否则表示条目结束(排空解码器)
+inline bool IsFlushPacket(AVPacket const *pkt) {
+    return !pkt->data && !pkt->size && (pkt->flags & AV_PKT_FLAG_DISCARD);
+}
+
+inline bool IsDrainPacket(AVPacket const *pkt) {
+    return !pkt->data && !pkt->size && !(pkt->flags & AV_PKT_FLAG_DISCARD);
+}
+
 struct VideoState {
     std::string file_name_;
     AVFormatContext *format_context_;
+    PlayerOptions options_;
+    int max_queue_size_;  // PacketQueue 的上限(低延迟模式下很小)
 
     // ================== Audio & Video ==================
     int video_stream_idx_{-1};
@@ -69,13 +116,22 @@ struct VideoState {
 
     // ================== Audio ==================
     AVFrame audio_frame_;
-    uint8_t *audio_buffer_;
-    uint32_t audio_buffer_size_;
-    uint32_t audio_buffer_index_;
+    uint8_t *audio_buffer_;        // 当前待播放的 PCM 数据(指向 audio_buffer1_, 为空表示输出静音)
+    uint32_t audio_buffer_size_;   // audio_buffer_ 中的有效数据长度
+    uint32_t audio_buffer_index_;  // audio_buffer_ 中已播放到的位置
+    uint8_t *audio_buffer1_;       // 重采样输出缓冲区(av_fast_malloc 分配, 所有权在这里)
+    uint32_t audio_buffer1_size_;  // audio_buffer1_ 已分配的大小
     struct SwrContext *audio_swr_context_;
+    int audio_hw_sample_rate_;             // 音频设备的采样率
+    int audio_hw_buffer_samples_;          // 音频设备每次回调的采样数(自动调优可能重开设备改变它)
+    AVChannelLayout audio_hw_ch_layout_;   // 音频设备的声道布局(切换条目不重开设备, 新条目重采样到这个格式)
+    double audio_pts_offset_;              // 当前条目音频的时间戳偏移(秒)
+    bool audio_thread_tuned_;              // 音频回调线程已按 --thread audio 调整(只由回调访问)
 
     // ================== Video ==================
-    FrameQueue video_frame_queue_;  // 解码后的视频帧队列
+    FrameQueue video_frame_queue_;   // 解码后的视频帧队列
+    FrameQueue filter_frame_queue_;  // --vf: 解码后等待滤镜线程处理的帧(keep_last 为 0)
+    VideoFilter video_filter_;       // --vf: 滤镜图, 只由滤镜线程访问
 
     // ================== SDL ==================
     int x_left_;  // 播放器窗口左上角 x 坐标
@@ -85,6 +141,15 @@ struct VideoState {
 
     SDL_Texture *texture_;
 
+    // ================== Subtitle ==================
+    int subtitle_stream_idx_{-1};
+    AVStream *subtitle_stream_;
+    AVCodecContext *subtitle_codec_context_;  // 只由字幕解码线程访问(包括换条目时的交接)
+    PacketQueue subtitle_packet_queue_;
+    FrameQueue subtitle_frame_queue_;            // 解码出的字幕(Frame::sub_), 显示端按时间取走
+    MtxQueue<DecoderHandoff> subtitle_handoff_;  // 交给字幕解码线程的下一个解码器(下一个条目没有字幕时为空)
+    SubtitleOverlay subtitle_overlay_;           // 激活的字幕和图集, 只由主线程访问
+
     // ================== Sync ==================
     // NOTE: 写死了主时钟为音频时钟
     double frame_timer_;              // 最后一帧播放的时刻(现在视频播放了多长时间)
@@ -96,13 +161,70 @@ struct VideoState {
     double audio_clock_;
     double video_clock_;
 
+    // ================== Volume ==================
+    std::atomic<float> volume_{1.0f};  // 软件音量(1.0 为原始音量), 在采样格式转换时一并乘上
+    std::atomic<bool> muted_{false};
+
+    // ================== Mixer ==================
+    AudioMixer audio_mixer_;                      // 其他音频源(--mix)在音频回调中混入主音轨
+    std::atomic<bool> audio_mixer_ready_{false};  // 混音源全部添加完毕(之后 sources_ 不再变化)
+
+    // ================== Latency ==================
+    double latency_;                              // 最近一帧从读到包到显示的延迟(秒)
+    double latency_avg_;                          // 延迟的滑动平均(秒)
+    int64_t frame_drops_;                         // 为维持目标延迟丢掉的视频帧数
+    std::atomic<int64_t> audio_packet_drops_{0};  // 为维持目标延迟丢掉的音频包数
+    int64_t latency_report_time_;                 // 上次输出延迟指标的时间
+
+    // ================== Playlist ==================
+    std::vector<std::string> playlist_;
+    size_t playlist_index_;                    // 当前读取的条目
+    MediaItem next_item_;                      // 预加载的下一个条目
+    size_t next_item_index_;                   // 预加载条目在 playlist_ 中的位置
+    SDL_Thread *preload_tid_;                  // 预加载线程
+    MtxQueue<DecoderHandoff> video_handoff_;   // 交给视频解码线程的下一个解码器
+    MtxQueue<DecoderHandoff> audio_handoff_;   // 交给音频回调的下一个解码器
+
+    // ================== Track ==================
+    std::atomic<int> video_track_requests_{0};  // 用户请求切换视频轨的次数, 由读线程处理
+    std::atomic<int> audio_track_requests_{0};  // 用户请求切换音频轨的次数, 由读线程处理
+
+    // ================== Pause ==================
+    // NOTE: 暂停时音频设备暂停、时钟冻结, 读/解码线程阻塞在条件变量上, 刷新定时器停表, 不产生任何周期性唤醒
+    std::atomic<bool> paused_{false};
+    int64_t pause_start_time_;                  // 暂停开始的系统时间(微秒)
+    std::atomic<bool> refresh_parked_{false};   // 刷新定时器是否已停表(暂停或无帧可显示), 由入队的帧重新启动
+    std::atomic<int64_t> wakeup_count_{0};      // 读/解码/刷新线程的唤醒次数
+    int64_t wakeup_count_at_pause_;             // 暂停时的唤醒次数快照(恢复时用于统计暂停期间的唤醒)
+
+    // ================== Raw Output ==================
+    RawSink raw_video_sink_;      // --raw-video: 解码后的视频不显示, 写成 Y4M/裸 YUV
+    RawSink raw_audio_sink_;      // --raw-audio: 解码后的音频不播放, 写成 PCM/WAV
+    int raw_sinks_running_{0};    // 还在写的原始输出线程数(state_mtx_ 保护)
+    bool streams_opened_{false};  // 读线程已经打开(或放弃打开)音视频流(state_mtx_ 保护)
+
+    // ================== Auto Tune ==================
+    AutoTune auto_tune_;  // --auto-tune: 开头几秒的测量, 之后调整队列深度和音频缓冲
+
+    // ================== Shared Memory ==================
+    ShmRing shm_ring_;  // --shm: 解码出的每一帧同时发布到共享内存, 供本机其他进程读取
+
+    // ================== Capture ==================
+    ClipRing clip_ring_;                                       // --clip-seconds: 最近 N 秒的包, 剪辑时转封装
+    MtxQueue<CaptureJob> capture_jobs_{kMaxPendingCaptures};  // 交给截图/剪辑线程的任务
+    SDL_Thread *capture_tid_;                                  // 截图/剪辑线程(第一次请求时启动)
+
     // ================== Misc ==================
     SDL_Thread *read_tid_;
     SDL_Thread *decode_tid_;
+    SDL_Thread *filter_tid_;
+    SDL_Thread *subtitle_tid_;
 
-    SDL_cond *continue_read_thread_;
+    std::mutex state_mtx_;
+    std::condition_variable state_cv_;  // 暂停/退出状态变化的条件变量
 
-    bool quit_{false};
+    std::atomic<bool> quit_{false};  // 各线程不加锁轮询; 写入时持有 state_mtx_(条件变量的等待者才不会错过)
+    int quit_fd_{-1};                // 低延迟模式的 eventfd, RequestQuit 写入: 唤醒在 poll 上等直播文件增长的读线程
 };
 
 // ================== PacketQueue Functions ==================
@@ -112,14 +234,22 @@ int PutPacketQueueInternal(PacketQueue *q, AVPacket *pkt);
 
 int PutPacketQueue(PacketQueue *q, AVPacket *pkt);
 
+int PutNullPacketQueue(PacketQueue *q, int stream_index, int flags);
+
 int GetPacketQueue(PacketQueue *q, AVPacket *pkt, int block);
 
+int WaitPacketQueueNotFull(PacketQueue *q, int max_size);
+
+int64_t PacketQueueDuration(PacketQueue *q);
+
 void FlushPacketQueue(PacketQueue *q);
 
+void AbortPacketQueue(PacketQueue *q);
+
 void DestoryPacketQueue(PacketQueue *q);
 
 // ================== FrameQueue Functions ==================
-int InitFrameQueue(FrameQueue *f, PacketQueue *pktq, int max_size, int keep_last);
+int InitFrameQueue(FrameQueue *f, PacketQueue *pktq, int max_size, int capacity, int keep_last);
 
 void MoveWriteIndex(FrameQueue *f);  // 将写索引后移
 
@@ -127,4 +257,16 @@ void MoveReadIndex(FrameQueue *f);  // 将读索引后移
 
 Frame *PeekWritableFrameQueue(FrameQueue *f);
 
-Frame *PeekFrameQueue(FrameQueue *f);
\ No newline at end of file
+Frame *PeekFrameQueue(FrameQueue *f);
+
+Frame *PeekLastFrameQueue(FrameQueue *f);
+
+Frame *PeekReadableFrameQueue(FrameQueue *f);
+
+int NbRemainingFrameQueue(FrameQueue *f);
+
+void SignalFrameQueue(FrameQueue *f);
+
+void FinishFrameQueue(FrameQueue *f);
+
+void SetFrameQueueMaxSize(FrameQueue *f, int max_size);
\ No newline at end of file
@@ -0,0 +1,180 @@
+// 单线程协程执行器
+
+#pragma once
+
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 由 Executor::Spawn 运行的协程(不返回值), 协程帧由执行器持有, 运行结束后销毁
+struct Task {
+    struct promise_type {
+        Task get_return_object() { return Task{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }  // 交给执行器后才开始运行
+        std::suspend_always final_suspend() noexcept { return {}; }    // 由执行器在 done() 后销毁
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+// 一个线程轮流运行就绪的协程, 没有就绪的协程时睡在条件变量上(不轮询)
+// 协程在 co_await 处让出线程, 所以一个线程可以服务很多轻量的会话;
+// 挂起的协程由唤醒方(任意线程)调用 Post 交回执行器
+// 会阻塞的调用(打开网络输入、读包)不能在执行器线程上做, 否则一个慢的会话会卡住所有会话:
+// co_await Blocking(fn) 把 fn 交给阻塞工作线程, 做完后协程回到执行器继续
+// NOTE: 目前只有混音源会话运行在执行器上; 读/解码线程仍是独立线程, 它们阻塞在条件变量上, 没有轮询
+class Executor {
+private:
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<std::coroutine_handle<>> ready_;
+    int nb_tasks_{0};  // 还没运行结束的协程数
+    bool stop_requested_{false};
+    std::thread thread_;
+
+    // 阻塞工作线程: 没有空闲的就新开一个, 慢的调用不会让别的会话排在它后面
+    std::condition_variable blocking_cv_;
+    std::deque<std::function<void()>> blocking_jobs_;
+    std::vector<std::thread> blocking_threads_;
+    int blocking_idle_{0};  // 空闲(等待任务)的阻塞工作线程数
+    bool blocking_stop_{false};
+
+    void RunBlockingWorker() {
+        std::unique_lock lk{mtx_};
+        while (true) {
+            ++blocking_idle_;
+            blocking_cv_.wait(lk, [this] { return !blocking_jobs_.empty() || blocking_stop_; });
+            --blocking_idle_;
+            if (blocking_jobs_.empty()) {
+                break;
+            }
+            std::function<void()> job{std::move(blocking_jobs_.front())};
+            blocking_jobs_.pop_front();
+            lk.unlock();
+            job();
+            lk.lock();
+        }
+    }
+
+    void SubmitBlocking(std::function<void()> job) {
+        {
+            std::lock_guard lk{mtx_};
+            blocking_jobs_.push_back(std::move(job));
+            if (blocking_idle_ < static_cast<int>(blocking_jobs_.size())) {
+                blocking_threads_.emplace_back([this] { RunBlockingWorker(); });
+            }
+        }
+        blocking_cv_.notify_one();
+    }
+
+    void Run() {
+        std::unique_lock lk{mtx_};
+        while (true) {
+            cv_.wait(lk, [this] { return !ready_.empty() || (stop_requested_ && nb_tasks_ == 0); });
+            if (ready_.empty()) {
+                break;  // 要求退出且所有协程都已结束
+            }
+            std::coroutine_handle<> handle{ready_.front()};
+            ready_.pop_front();
+            lk.unlock();
+            handle.resume();
+            // NOTE: 协程之间不互相 co_await, 恢复的总是顶层协程
+            bool done{handle.done()};
+            if (done) {
+                handle.destroy();
+            }
+            lk.lock();
+            if (done) {
+                --nb_tasks_;
+            }
+        }
+    }
+
+public:
+    Executor() = default;
+
+    ~Executor() { Shutdown(); }
+
+    Executor(Executor const&) = delete;
+    Executor& operator=(Executor const&) = delete;
+
+public:
+    void Start() { thread_ = std::thread([this] { Run(); }); }
+
+    void Spawn(Task task) {
+        {
+            std::lock_guard lk{mtx_};
+            ++nb_tasks_;
+            ready_.push_back(task.handle_);
+        }
+        cv_.notify_one();
+    }
+
+    // 把挂起的协程交回执行器(任意线程调用)
+    void Post(std::coroutine_handle<> handle) {
+        {
+            std::lock_guard lk{mtx_};
+            ready_.push_back(handle);
+        }
+        cv_.notify_one();
+    }
+
+    // co_await executor.Yield(): 让其他就绪的协程先运行
+    auto Yield() {
+        struct Awaiter {
+            Executor* executor_;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) { executor_->Post(handle); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{this};
+    }
+
+    // co_await executor.Blocking(fn): 在阻塞工作线程上运行 fn, 期间执行器去跑别的协程
+    // fn 的结果通过引用捕获的协程局部变量带回(协程挂起期间它们一直有效)
+    template <typename F>
+    auto Blocking(F fn) {
+        struct Awaiter {
+            Executor* executor_;
+            F fn_;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) {
+                executor_->SubmitBlocking([fn = &fn_, executor = executor_, handle] {
+                    (*fn)();
+                    executor->Post(handle);  // 之后不能再访问 fn: 协程可能已经恢复运行
+                });
+            }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{this, std::move(fn)};
+    }
+
+    // 结构化退出: 等所有协程自己运行结束(调用者负责先让挂起的协程恢复并退出), 再 join 线程
+    // 协程都结束了, 阻塞工作线程上也就没有任务了, 最后一起 join
+    void Shutdown() {
+        {
+            std::lock_guard lk{mtx_};
+            stop_requested_ = true;
+        }
+        cv_.notify_one();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        {
+            std::lock_guard lk{mtx_};
+            blocking_stop_ = true;
+        }
+        blocking_cv_.notify_all();
+        for (std::thread& thread : blocking_threads_) {
+            thread.join();
+        }
+        blocking_threads_.clear();
+    }
+};
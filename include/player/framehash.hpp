@@ -0,0 +1,7 @@
+#pragma once
+
+#include <player/options.hpp>
+
+// 解码校验(--framehash): 对每个解码出的视频帧/音频帧的像素和样本数据计算 xxh3 哈希, 输出到 stdout
+// 格式参考 ffmpeg 的 framemd5, 可以直接 diff 不同版本/主机/构建的输出
+int RunFrameHash(PlayerOptions const &options);
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <player/ffmpeg.hpp>
+
+// 进程内所有会话共用的内存记账, 按组成部分统计真实占用的字节数(含 AVPacket/AVBuffer 的开销和对齐填充)
+enum class MemoryComponent {
+    kPackets,  // 各 PacketQueue 中的包
+    kFrames,   // 各 FrameQueue 中解码后的帧
+    kAudio,    // 音频输出缓冲和混音源的环形缓冲
+};
+
+constexpr int kNbMemoryComponents = 3;
+
+// 设置了上限(--memory-limit)时, 占用接近上限就收缩预读量和帧队列深度
+// 只收缩到最小值为止, 不会让管线停住(包和帧被消费后占用自然回落)
+struct MemoryGovernor {
+    std::atomic<int64_t> current_[kNbMemoryComponents]{};
+    std::atomic<int64_t> peak_[kNbMemoryComponents]{};
+    std::atomic<int64_t> total_{0};
+    std::atomic<int64_t> total_peak_{0};
+    int64_t limit_{0};                     // 上限(字节), 0 表示不限制; 启动时设置一次
+    std::atomic<bool> over_limit_{false};  // 超过上限后置位, 回落到软上限以下时清除(只在状态变化时输出日志)
+};
+
+MemoryGovernor &GetMemoryGovernor();
+
+void SetMemoryLimit(int64_t limit);
+
+void ChargeMemory(MemoryComponent component, int64_t bytes);
+
+int64_t PacketMemorySize(AVPacket const *pkt);
+
+int64_t FrameMemorySize(AVFrame const *frame);
+
+int GovernedQueueSize(int max_size);
+
+int GovernedFrameQueueSize(int max_size);
+
+void ReportMemoryUsage();
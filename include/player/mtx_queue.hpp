@@ -14,7 +14,7 @@ template <typename T, typename Queue = std::queue<T>>
 class MtxQueue {
 private:
     Queue queue_;
-    std::mutex mtx_;
+    mutable std::mutex mtx_;
     std::condition_variable cv_notfull_;   // 队列未满条件变量
     std::condition_variable cv_notempty_;  // 队列非空条件变量
     std::size_t limit_;                    // 最大允许堆积的元素数量
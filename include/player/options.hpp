@@ -0,0 +1,76 @@
+#pragma once
+
+#include <player/const.hpp>
+#include <player/thread_tuning.hpp>
+#include <string>
+#include <vector>
+
+// 额外混入主音频的音频源(--mix / --mix-track)
+struct MixSourceOptions {
+    std::string url_;
+    int track_{-1};  // 第几条音频流, -1 表示自动选择
+    float gain_{1.0f};
+};
+
+// 管线参数(--set key=value / --config <file>), 默认值来自 const.hpp
+// 为 0 的项在解析完命令行后按模式(普通/低延迟)填成对应的默认值
+struct PipelineConfig {
+    int picture_queue_size_{0};                       // picture_queue_size: FrameQueue 深度(keep_last 至少需要 2)
+    int frame_queue_capacity_{kFrameQueueSize};       // frame_queue_capacity: FrameQueue 槽数, 自动调优时深度的上限
+    int max_queue_size_{0};                           // max_queue_size: 每个 PacketQueue 的字节上限
+    int audio_buffer_size_{0};                        // audio_buffer_size: SDL 音频缓冲的采样数(2 的幂)
+    double max_sync_threshold_{kMaxAvSyncThreshold};  // max_sync_threshold: 音视频差超过它时跳帧/重复帧(秒)
+    double no_sync_threshold_{kAvNoSyncThreshold};    // no_sync_threshold: 差距超过它时不再尝试同步(秒)
+    int screen_width_{kScreenWidth};                  // screen_width: 窗口的默认大小
+    int screen_height_{kScreenHeight};                // screen_height
+};
+
+// 命令行选项
+struct PlayerOptions {
+    std::vector<std::string> playlist_;
+    bool low_latency_{false};                      // 直播低延迟模式
+    double target_latency_{kDefaultTargetLatency};  // 低延迟模式下要维持的延迟(秒)
+    std::vector<MixSourceOptions> mix_sources_;     // 混入主音频的其他音频源(监看多路音频)
+
+    // ================== Pipeline ==================
+    PipelineConfig pipeline_;  // 队列深度、音频缓冲、同步阈值等(原来都是编译期常量)
+    bool auto_tune_{false};    // 开头几秒测量解码耗时和音频回调抖动, 然后调整队列深度和音频缓冲
+    int64_t memory_limit_{0};  // 包/帧/音频缓冲的内存上限(字节), 0 表示不限制
+
+    // ================== Video Filter ==================
+    std::string video_filters_;  // --vf: 解码和显示之间的 libavfilter 滤镜图, 为空表示不经过滤镜
+    int filter_threads_{0};      // 滤镜图的切片线程数, 0 为自动
+
+    // ================== Subtitle ==================
+    bool subtitles_{true};       // 解码并显示字幕流(--no-subs 关闭; 离线和原始输出模式不显示)
+    std::string subtitle_font_;  // 文字字幕的字体文件, 为空时在 kDefaultSubtitleFonts 中查找
+
+    // ================== Capture ==================
+    std::string capture_dir_{"."};       // 截图(s 键)和剪辑(c 键)的输出目录
+    std::string capture_format_{"png"};  // 截图格式: png / jpg
+    double clip_seconds_{0};             // 剪辑保存最近多少秒, 0 表示不记录(不占内存)
+
+    // ================== Thumbnails ==================
+    bool thumbnails_{false};                       // 批量生成缩略图(不开窗口, 不播放)
+    int thumbnail_count_{kDefaultThumbnailCount};  // 每个文件的缩略图数量
+    int thumbnail_width_{kDefaultThumbnailWidth};  // 每张缩略图的宽度(像素)
+    std::string thumbnail_format_{"jpg"};          // jpg / png
+    std::string output_dir_{"."};                  // 拼图输出目录
+
+    // ================== Analysis ==================
+    bool analyze_{false};    // 离线分析: 不开窗口, 按 GOP 切段并行解码整个文件
+    bool framehash_{false};  // 输出每帧解码结果的哈希(隐含 analyze_)
+
+    // ================== Raw Output ==================
+    bool raw_output_{false};      // 不开窗口和音频设备, 解码结果写到下面的输出
+    std::string raw_video_path_;  // 视频输出(Y4M, .yuv 为裸 YUV420P), "-" 为标准输出
+    std::string raw_audio_path_;  // 音频输出(S16 PCM, .wav 带 WAV 头), "-" 为标准输出
+
+    // ================== Shared Memory ==================
+    std::string shm_name_;  // 解码出的帧同时发布到 /dev/shm/<name>, 为空表示不发布
+
+    // ================== Threads ==================
+    ThreadPolicies thread_policies_;  // 读/解码/音频/显示线程的 CPU 亲和性、nice 和实时调度
+};
+
+int ParseOptions(PlayerOptions* options, int argc, char* argv[]);
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <player/ffmpeg.hpp>
+#include <vector>
+
+// 像素格式转换: 把 SDL 不能直接显示的解码输出(10 位、4:2:2、4:4:4、GBRP 等)转成 YUV420P
+// 每帧切成水平条带并行处理, 常见的 10 位 -> 8 位、4:2:2 -> 4:2:0 走 SIMD, 其余走 sws_scale
+struct PixelConverter {
+    std::vector<SwsContext *> sws_contexts_;  // 每个条带一个(sws_scale 的上下文不能跨线程共用)
+    int src_format_{AV_PIX_FMT_NONE};
+    int64_t nb_frames_{0};
+    int64_t total_time_{0};   // 累计转换耗时(微秒)
+    int64_t max_time_{0};     // 单帧最大转换耗时(微秒)
+    int64_t report_time_{0};  // 上次输出统计的时间
+};
+
+bool NeedPixelConvert(int format);
+
+int ConvertFrame(PixelConverter *converter, AVFrame const *src, AVFrame *dst);
+
+void FreePixelConverter(PixelConverter *converter);
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <player/const.hpp>
+#include <player/core.hpp>
+#include <player/ffmpeg.hpp>
+#include <player/options.hpp>
+#include <string>
+
+// ================== Playlist Functions ==================
+int OpenMediaItem(MediaItem *item, std::string const &file_name, PlayerOptions const &options,
+                  AVIOInterruptCB interrupt_callback = {nullptr, nullptr});
+
+int QuitInterrupt(void *opaque);
+
+void CloseMediaItem(MediaItem *item);
+
+int PreloadThread(void *arg);
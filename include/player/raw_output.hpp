@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <player/ffmpeg.hpp>
+#include <player/options.hpp>
+#include <string>
+#include <utility>
+
+struct VideoState;
+
+enum class RawFormat {
+    kY4m,  // YUV4MPEG2, 带分辨率/帧率头
+    kYuv,  // 裸 YUV420P, 没有任何头
+    kPcm,  // 裸 S16 交错 PCM
+    kWav,  // S16 PCM + WAV 头
+};
+
+// 原始输出: 解码后的帧不显示/不播放, 直接写到文件、命名管道或标准输出
+// 写不动时阻塞, 节奏完全由下游的消费速度决定(不按时钟)
+struct RawSink {
+    std::string path_;
+    RawFormat format_{RawFormat::kY4m};
+    int fd_{-1};
+    bool is_pipe_{false};  // 管道用 vmsplice 把帧的页面直接挂进管道(不拷贝), 否则用 writev
+    int pipe_size_{0};     // 管道容量(字节)
+    bool header_written_{false};
+    int width_{0};  // 第一帧的分辨率(Y4M 不支持中途改变)
+    int height_{0};
+    int error_{0};
+    uint64_t bytes_written_{0};
+    int64_t nb_frames_{0};
+    int64_t first_write_time_{0};  // 第一次写出的时间(av_gettime_relative), 0 表示还没写过
+    double first_pts_{NAN};        // 已写出的数据在媒体时间轴上的起止(秒), 用来检查两路输出是否对齐
+    double end_pts_{NAN};
+    // vmsplice 出去的帧可能还在管道里, 其后再写满一个管道容量之前不能释放(否则缓冲区被解码器复用)
+    // 每项是帧的引用和它在输出中的结束位置
+    std::deque<std::pair<AVFrame *, uint64_t>> pinned_frames_;
+    SDL_Thread *tid_{nullptr};
+};
+
+int OpenRawSink(RawSink *sink, std::string const &path, AVMediaType type);
+
+int WriteRawVideoFrame(RawSink *sink, AVFrame const *frame, AVRational frame_rate);
+
+int WriteRawAudio(RawSink *sink, uint8_t const *data, int size, int sample_rate, int nb_channels);
+
+void MarkRawSinkTime(RawSink *sink, double start_pts, double end_pts);
+
+void CloseRawSink(RawSink *sink);
+
+int StartRawOutputThread(VideoState *video_state, RawSink *sink, SDL_ThreadFunction fn, char const *name);
+
+void FinishRawOutputThread(VideoState *video_state);
+
+bool WaitRawOutputResumed(VideoState *video_state);
+
+double RawOutputSpanMismatch(VideoState const *video_state);
+
+int RunRawOutput(PlayerOptions const &options);
@@ -6,13 +6,18 @@
 #include <player/const.hpp>
 #include <player/core.hpp>
 #include <player/ffmpeg.hpp>
+#include <player/options.hpp>
+#include <player/playlist.hpp>
 #include <string>
+#include <vector>
 
 // 视频线程
 #include <player/video_thread.hpp>
 // 音频线程
 #include <player/audio_thread.hpp>
 
-VideoState* OpenStream(std::string const& file_name);
+VideoState* OpenStream(PlayerOptions const& options);
 
-int ReadThread(void* arg);
\ No newline at end of file
+int ReadThread(void* arg);
+
+AVCodecContext* OpenCodecContext(AVStream* stream, PlayerOptions const& options);
\ No newline at end of file
@@ -0,0 +1,19 @@
+// 作用域退出时执行清理, 代替 goto end 式的统一释放
+
+#pragma once
+
+#include <utility>
+
+template <typename F>
+class ScopeGuard {
+private:
+    F fn_;
+
+public:
+    explicit ScopeGuard(F fn) : fn_(std::move(fn)) {}
+
+    ~ScopeGuard() { fn_(); }
+
+    ScopeGuard(ScopeGuard const&) = delete;
+    ScopeGuard& operator=(ScopeGuard const&) = delete;
+};
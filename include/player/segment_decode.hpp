@@ -0,0 +1,16 @@
+#pragma once
+
+#include <functional>
+#include <player/ffmpeg.hpp>
+#include <player/options.hpp>
+#include <string>
+
+// 按 pts 顺序收到视频流的每一帧(所有权不转移, 返回后帧即被释放), 返回负值中止解码
+using FrameConsumer = std::function<int(AVFrame *frame)>;
+
+// GOP 并行解码: 在关键帧处把文件切成若干段, 每段用独立的解复用器和解码器在线程池上解码,
+// 再按段的顺序交给 consumer(段内本来就是显示顺序), 对 consumer 来说和单线程顺序解码一样
+int SegmentDecode(std::string const &file_name, PlayerOptions const &options, FrameConsumer const &consumer);
+
+// 离线分析(--analyze): 不开窗口, 依次对每个文件做 GOP 并行解码并报告吞吐
+int RunAnalysis(PlayerOptions const &options);
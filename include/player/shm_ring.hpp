@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <player/ffmpeg.hpp>
+#include <string>
+
+// 共享内存帧环(--shm <name>): 解码线程把每一帧拷一份到 /dev/shm/<name>, 本机的其他进程只读映射后直接使用
+// 发布方从不等待消费者: 消费者太慢时槽被覆盖, 表现为帧序号不连续
+//
+// 布局: [ShmRingHeader, 补齐到 kShmRingHeaderSize] [槽 0] [槽 1] ... 每个槽为 [ShmSlotHeader] [图像数据]
+// 消费者协议:
+//   1. 映射后等 magic_ == kShmRingMagic(文件在第一帧到来时才设置大小); 版本不同时不要继续读
+//   2. 最新的帧序号为 write_seq_ - 1, 序号 s 在槽 s % nb_slots_
+//   3. 读槽: l1 = lock_(acquire), 为奇数说明正在写; 使用数据; l2 = lock_;
+//      l1 == l2 且 seq_ 是想要的序号时数据有效, 否则这帧在使用过程中被覆盖了(按丢帧处理)
+//   4. 没有新帧时: v = futex_; 再检查一次 write_seq_; 然后 FUTEX_WAIT(&futex_, v)(不能带 FUTEX_PRIVATE_FLAG)
+constexpr uint32_t kShmRingMagic = 0x4d524843;  // "CHRM"
+constexpr uint32_t kShmRingVersion = 1;
+constexpr size_t kShmRingHeaderSize = 4096;
+
+struct ShmRingHeader {
+    std::atomic<uint32_t> magic_;      // 其余字段初始化完毕后最后写入
+    uint32_t version_;
+    uint32_t nb_slots_;
+    uint32_t reserved_;
+    uint64_t slot_size_;               // 每个槽的字节数, 槽 i 的偏移为 kShmRingHeaderSize + i * slot_size_
+    std::atomic<uint64_t> write_seq_;  // 已发布的帧数
+    std::atomic<uint32_t> futex_;      // 每发布一帧加一, 消费者在上面等待
+};
+
+struct ShmSlotHeader {
+    std::atomic<uint64_t> lock_;  // seqlock: 写之前加一(奇数), 写完再加一(偶数)
+    uint64_t seq_;                // 帧序号(从 0 开始连续), 消费者据此发现丢帧
+    int64_t pts_;                 // 显示时间(微秒, 与播放器的时钟一致), 未知时为 AV_NOPTS_VALUE
+    int32_t format_;              // AVPixelFormat
+    int32_t width_;
+    int32_t height_;
+    int32_t sar_num_;
+    int32_t sar_den_;
+    int32_t linesize_[4];
+    uint64_t offset_[4];  // 每个平面相对槽起始的偏移
+    uint64_t data_size_;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+              "shared memory atomics must be lock free");
+static_assert(sizeof(ShmRingHeader) <= kShmRingHeaderSize);
+
+// 发布方(播放器)的状态
+struct ShmRing {
+    std::string name_;
+    int fd_{-1};
+    uint8_t *base_{nullptr};  // 第一帧到来时才按帧大小映射
+    size_t size_{0};
+    size_t slot_data_size_{0};  // 每个槽能放下的图像数据字节数
+    int64_t nb_published_{0};
+    int64_t nb_skipped_{0};  // 放不下(分辨率变大)而没有发布的帧数
+};
+
+int CreateShmRing(ShmRing *ring, std::string const &name);
+
+int PublishShmFrame(ShmRing *ring, AVFrame const *frame, double pts);
+
+void UnlinkShmRing(ShmRing *ring);
+
+void DestroyShmRing(ShmRing *ring);
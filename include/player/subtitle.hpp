@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <player/ffmpeg.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct Frame;
+struct VideoState;
+
+// 正在显示(或等待结束)的一条字幕, 所有权从字幕帧队列转移过来
+struct ActiveSubtitle {
+    AVSubtitle sub_;
+    double start_{0};      // 开始显示的时间(秒, 和视频 pts 同一时间轴)
+    double end_{0};        // 结束时间, 没有给出时为 INFINITY(直到被下一条替换)
+    int64_t id_{0};        // 图形字幕在图集中的缓存键
+    int canvas_width_{0};  // 图形字幕的坐标系(解码器给出的画布大小, 为 0 时用视频大小)
+    int canvas_height_{0};
+};
+
+// 图集中一个字形: 填充和描边分别光栅化成白色, 绘制时用颜色调制上色
+struct SubtitleGlyph {
+    SDL_Rect fill_{0, 0, 0, 0};  // 在图集中的位置, 宽为 0 表示没有像素(空格等)
+    SDL_Rect outline_{0, 0, 0, 0};
+    int advance_{0};
+};
+
+// 一次绘制: 图集中的一块复制到窗口上的一个位置
+struct SubtitleQuad {
+    SDL_Rect src_;
+    SDL_Rect dst_;
+    SDL_Color color_;
+};
+
+// 字形和字幕位图的纹理图集: 只在插入新内容时上传对应的子区域, 装满时整个清空重建
+// 按行(shelf)分配: 每行高度取该行最高的一项, 一行放不下换下一行
+struct SubtitleAtlas {
+    SDL_Texture *texture_{nullptr};
+    int shelf_x_{0};
+    int shelf_y_{0};
+    int shelf_height_{0};
+    std::unordered_map<uint32_t, SubtitleGlyph> glyphs_;  // 码点 -> 字形(当前字号)
+    std::unordered_map<uint64_t, SDL_Rect> bitmaps_;      // (字幕 id, 第几个矩形) -> 位置
+    int64_t nb_uploads_{0};                               // 上传次数(每次插入一项)
+    int64_t nb_resets_{0};
+};
+
+// 字幕叠加层, 只由主线程(DisplayVideo)访问
+// 激活的字幕集合或视频显示区域变化时才重新排版, 其余时候每次显示只按缓存的 quads_ 从图集复制
+struct SubtitleOverlay {
+    bool visible_{true};  // t 键切换, 隐藏时仍然按时间消费字幕
+    std::deque<ActiveSubtitle> active_;
+    int64_t next_id_{0};
+    bool dirty_{false};  // 激活集合变了, 需要重新排版
+
+    std::string font_path_;  // 实际使用的字体文件(--sub-font 或找到的第一个系统字体)
+    TTF_Font *font_{nullptr};
+    TTF_Font *outline_font_{nullptr};  // 同一字体开启描边, 字形向左上偏移 outline_size_ 后和 font_ 对齐
+    int font_size_{0};
+    int outline_size_{0};
+    bool font_failed_{false};  // 字体打不开时只显示图形字幕, 不再重试
+
+    SDL_Rect layout_rect_{0, 0, 0, 0};  // 当前排版对应的视频显示区域
+    std::vector<SubtitleQuad> quads_;
+    SubtitleAtlas atlas_;
+};
+
+int SubtitleDecodeThread(void *arg);
+
+void DrawSubtitles(VideoState *video_state, Frame const *vp, SDL_Rect const *rect);
+
+void ToggleSubtitles(VideoState *video_state);
+
+void DestroySubtitleOverlay(SubtitleOverlay *overlay);
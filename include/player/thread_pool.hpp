@@ -0,0 +1,85 @@
+// 固定大小的线程池
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <latch>
+#include <memory>
+#include <player/mtx_queue.hpp>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+private:
+    MtxQueue<std::function<void()>> tasks_;  // 空任务表示工作线程退出
+    std::vector<std::thread> workers_;
+
+public:
+    // NOTE: hardware_concurrency() 取不到时返回 0, 至少开一个工作线程: 只 Submit 不等结果的调用方(如分段解码)
+    // 依赖工作线程执行任务, 没有工作线程会永远等下去
+    explicit ThreadPool(std::size_t nb_threads = std::max(std::thread::hardware_concurrency(), 1u)) {
+        for (std::size_t i{0}; i < nb_threads; ++i) {
+            workers_.emplace_back([this] {
+                while (std::function<void()> task = tasks_.Pop()) {
+                    task();
+                }
+            });
+        }
+    }
+
+    ~ThreadPool() {
+        for (std::size_t i{0}; i < workers_.size(); ++i) {
+            tasks_.Push(nullptr);
+        }
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+public:
+    void Submit(std::function<void()> task) { tasks_.Push(std::move(task)); }
+
+    // 把 fn(0) ... fn(n - 1) 分给线程池并行执行, 调用线程也参与, 全部完成后返回
+    template <typename F>
+    void ParallelFor(int n, F&& fn) {
+        if (n <= 1 || workers_.empty()) {
+            for (int i{0}; i < n; ++i) {
+                fn(i);
+            }
+            return;
+        }
+        // NOTE: 状态用 shared_ptr 持有: 晚到的工作线程可能在返回之后才被调度(此时只会取到 i >= n, 不再调用 fn)
+        struct State {
+            std::atomic<int> next{0};
+            std::latch done;
+            explicit State(int count) : done(count) {}
+        };
+        auto state = std::make_shared<State>(n);
+        auto run = [state, n, &fn] {
+            for (int i; (i = state->next++) < n;) {
+                fn(i);
+                state->done.count_down();
+            }
+        };
+        std::size_t helpers{std::min(static_cast<std::size_t>(n - 1), workers_.size())};
+        for (std::size_t i{0}; i < helpers; ++i) {
+            Submit(run);
+        }
+        run();
+        state->done.wait();
+    }
+
+    std::size_t Size() const { return workers_.size(); }
+};
+
+// 进程内共享的线程池(多个会话共用, 避免线程数随会话数膨胀)
+inline ThreadPool& SharedThreadPool() {
+    static ThreadPool pool;
+    return pool;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 播放管线中可以单独调整调度参数的线程
+enum class ThreadRole {
+    kRead,     // 读线程(解复用)
+    kDecode,   // 视频解码线程
+    kAudio,    // 音频回调(原始输出模式下为音频输出线程)
+    kPresent,  // 主线程的事件循环和视频刷新(原始输出模式下为视频输出线程)
+};
+
+constexpr int kNbThreadRoles = 4;
+
+// 一个线程的调度策略(--thread / --thread-config), 默认什么都不改
+struct ThreadPolicy {
+    std::vector<int> cpus_;    // 允许运行的 CPU, 为空表示不限制
+    int numa_node_{-1};        // 只在这个 NUMA 节点的 CPU 上运行并优先从它分配内存, 和 cpus_ 同时给出时取交集
+    std::optional<int> nice_;  // 线程的 nice 值(-20 ~ 19, 负值需要 CAP_SYS_NICE)
+    int fifo_priority_{0};     // SCHED_FIFO 优先级(1 ~ 99), 0 表示保持普通调度; 只允许音频和显示线程
+};
+
+using ThreadPolicies = std::array<ThreadPolicy, kNbThreadRoles>;
+
+int ParseThreadSpec(ThreadPolicies *policies, std::string_view spec, std::string_view separators);
+
+int LoadThreadConfig(ThreadPolicies *policies, std::string const &path);
+
+void ApplyThreadPolicy(ThreadRole role, ThreadPolicies const &policies);
+
+// 在按 role 的策略调整过的临时线程上执行 fn 并等它完成, fn 中创建的线程(比如 avcodec_open2 开的解码工作线程)
+// 继承这些设置; 策略为空时直接在调用线程执行
+void RunWithThreadPolicy(ThreadRole role, ThreadPolicies const &policies, std::function<void()> const &fn);
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <player/options.hpp>
+
+// 批量缩略图: 每个输入文件只解码关键帧, 缩放后拼成一张 JPEG/PNG 拼图(contact sheet)
+// 文件之间在共享线程池上并行, 不创建 SDL 窗口
+int RunThumbnails(PlayerOptions const &options);
+
+int WriteImageFile(AVFrame *frame, std::string const &path, bool png);
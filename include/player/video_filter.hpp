@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <player/ffmpeg.hpp>
+
+struct VideoState;
+
+// 解码和显示之间可选的 libavfilter 阶段(--vf), 例如 "yadif=deint=interlaced", "crop=1920:800",
+// "zscale=t=linear:npl=100,tonemap=hable,zscale=t=bt709:m=bt709:r=tv"
+// 在自己的线程上运行: 解码线程把帧放进 filter_frame_queue_ 就继续解码, 昂贵的滤镜不会占用解码的时间
+// 滤镜图开启了 libavfilter 的切片多线程; 输入帧的格式(分辨率、像素格式)变化时排空旧图再重建
+struct VideoFilter {
+    AVFilterGraph *graph_{nullptr};
+    AVFilterContext *src_{nullptr};   // buffer: 输入, 时间基为 AV_TIME_BASE_Q(时间戳已经加上条目偏移)
+    AVFilterContext *sink_{nullptr};  // buffersink: 输出
+    // 当前滤镜图的输入格式(建图失败时也记录, 格式再变之前不重试, 直接显示未经滤镜的帧)
+    int width_{0};
+    int height_{0};
+    int format_{AV_PIX_FMT_NONE};
+    double frame_duration_{0};  // 输入的帧时长(秒), 输出没有帧率时沿用
+    int64_t nb_builds_{0};
+};
+
+int QueueFilterFrame(VideoState *video_state, AVFrame *frame, double pts, double duration);
+
+int VideoFilterThread(void *arg);
@@ -1,9 +1,21 @@
 #pragma once
 
+#include <algorithm>
 #include <player/common.hpp>
 #include <player/const.hpp>
 #include <player/core.hpp>
+#include <player/pixel_convert.hpp>
+
+int QueuePicture(VideoState* video_state, AVFrame* src_frame, double pts, double duration, int64_t pos);
 
 int DecodeThread(void* arg);
 
+int RawVideoThread(void* arg);
+
+void RequestQuit(VideoState* video_state);
+
+void JoinVideoState(VideoState* video_state);
+
+void TogglePause(VideoState* video_state);
+
 void SdlEventLoop(VideoState* video_state);
\ No newline at end of file
@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <cmath>
+#include <player/audio_kernels.hpp>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PLAYER_X86 1
+#endif
+
+constexpr float kS16Scale = 32768.0f;
+
+static inline int16_t ClipS16(float x) {
+    // NOTE: 先在 float 域夹紧再取整, 与 SIMD 的 min/max + cvtps(就近舍入) 结果一致
+    x = std::fmin(std::fmax(x, -32768.0f), 32767.0f);
+    return static_cast<int16_t>(std::lrintf(x));
+}
+
+// ================== 标量实现 ==================
+
+static void FltpToS16Scalar(int16_t *dst, float const *const *src, int nb_channels, int nb_samples, float volume) {
+    float scale{volume * kS16Scale};
+    for (int i{0}; i < nb_samples; ++i) {
+        for (int c{0}; c < nb_channels; ++c) {
+            dst[i * nb_channels + c] = ClipS16(src[c][i] * scale);
+        }
+    }
+}
+
+static void ScaleS16Scalar(int16_t *buf, int nb_samples, float volume) {
+    for (int i{0}; i < nb_samples; ++i) {
+        buf[i] = ClipS16(buf[i] * volume);
+    }
+}
+
+static void MixS16Scalar(int16_t *dst, int16_t const *const *srcs, float const *gains, int nb_tracks, int nb_samples) {
+    for (int i{0}; i < nb_samples; ++i) {
+        float acc{0.0f};
+        for (int t{0}; t < nb_tracks; ++t) {
+            acc += srcs[t][i] * gains[t];
+        }
+        dst[i] = ClipS16(acc);
+    }
+}
+
+#ifdef PLAYER_X86
+// ================== SSE2 实现 ==================
+
+__attribute__((target("sse2"))) static inline __m128i FloatToS16Sse2(__m128 x, __m128 scale) {
+    x = _mm_min_ps(_mm_max_ps(_mm_mul_ps(x, scale), _mm_set1_ps(-32768.0f)), _mm_set1_ps(32767.0f));
+    return _mm_cvtps_epi32(x);
+}
+
+__attribute__((target("sse2"))) static void FltpToS16Sse2(int16_t *dst, float const *const *src, int nb_channels,
+                                                          int nb_samples, float volume) {
+    __m128 const scale = _mm_set1_ps(volume * kS16Scale);
+    int i{0};
+    if (nb_channels == 1) {
+        for (; i + 8 <= nb_samples; i += 8) {
+            __m128i a = FloatToS16Sse2(_mm_loadu_ps(src[0] + i), scale);
+            __m128i b = FloatToS16Sse2(_mm_loadu_ps(src[0] + i + 4), scale);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(a, b));
+        }
+    } else if (nb_channels == 2) {
+        // 最常见的 AAC / Opus 立体声: L0-3 R0-3 -> L0 R0 L1 R1 ... L3 R3
+        for (; i + 4 <= nb_samples; i += 4) {
+            __m128i l = FloatToS16Sse2(_mm_loadu_ps(src[0] + i), scale);
+            __m128i r = FloatToS16Sse2(_mm_loadu_ps(src[1] + i), scale);
+            __m128i lr = _mm_packs_epi32(_mm_unpacklo_epi32(l, r), _mm_unpackhi_epi32(l, r));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 2 * i), lr);
+        }
+    }
+    // 其余声道数(5.1 等)以及尾部走标量
+    if (i < nb_samples && nb_channels <= 8) {
+        float const *tail[8];
+        for (int c{0}; c < nb_channels; ++c) {
+            tail[c] = src[c] + i;
+        }
+        FltpToS16Scalar(dst + i * nb_channels, tail, nb_channels, nb_samples - i, volume);
+    } else if (i < nb_samples) {
+        FltpToS16Scalar(dst, src, nb_channels, nb_samples, volume);
+    }
+}
+
+__attribute__((target("sse2"))) static inline __m128 S16LoToFloatSse2(__m128i x) {
+    return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+}
+
+__attribute__((target("sse2"))) static inline __m128 S16HiToFloatSse2(__m128i x) {
+    return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16));
+}
+
+__attribute__((target("sse2"))) static void ScaleS16Sse2(int16_t *buf, int nb_samples, float volume) {
+    __m128 const scale = _mm_set1_ps(volume);
+    int i{0};
+    for (; i + 8 <= nb_samples; i += 8) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<__m128i const *>(buf + i));
+        __m128i lo = FloatToS16Sse2(S16LoToFloatSse2(x), scale);
+        __m128i hi = FloatToS16Sse2(S16HiToFloatSse2(x), scale);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(buf + i), _mm_packs_epi32(lo, hi));
+    }
+    ScaleS16Scalar(buf + i, nb_samples - i, volume);
+}
+
+__attribute__((target("sse2"))) static void MixS16Sse2(int16_t *dst, int16_t const *const *srcs, float const *gains,
+                                                       int nb_tracks, int nb_samples) {
+    __m128 const one = _mm_set1_ps(1.0f);
+    int i{0};
+    for (; i + 8 <= nb_samples; i += 8) {
+        __m128 lo = _mm_setzero_ps();
+        __m128 hi = _mm_setzero_ps();
+        for (int t{0}; t < nb_tracks; ++t) {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<__m128i const *>(srcs[t] + i));
+            __m128 gain = _mm_set1_ps(gains[t]);
+            lo = _mm_add_ps(lo, _mm_mul_ps(S16LoToFloatSse2(x), gain));
+            hi = _mm_add_ps(hi, _mm_mul_ps(S16HiToFloatSse2(x), gain));
+        }
+        __m128i packed = _mm_packs_epi32(FloatToS16Sse2(lo, one), FloatToS16Sse2(hi, one));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), packed);
+    }
+    if (i < nb_samples) {
+        int16_t const *tail[16];
+        if (nb_tracks <= 16) {
+            for (int t{0}; t < nb_tracks; ++t) {
+                tail[t] = srcs[t] + i;
+            }
+            MixS16Scalar(dst + i, tail, gains, nb_tracks, nb_samples - i);
+        } else {
+            MixS16Scalar(dst, srcs, gains, nb_tracks, nb_samples);
+        }
+    }
+}
+
+// ================== AVX2 实现 ==================
+
+__attribute__((target("avx2"))) static inline __m256i FloatToS16Avx2(__m256 x, __m256 scale) {
+    x = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(x, scale), _mm256_set1_ps(-32768.0f)), _mm256_set1_ps(32767.0f));
+    return _mm256_cvtps_epi32(x);
+}
+
+__attribute__((target("avx2"))) static void FltpToS16Avx2(int16_t *dst, float const *const *src, int nb_channels,
+                                                          int nb_samples, float volume) {
+    __m256 const scale = _mm256_set1_ps(volume * kS16Scale);
+    int i{0};
+    if (nb_channels == 1) {
+        for (; i + 16 <= nb_samples; i += 16) {
+            __m256i a = FloatToS16Avx2(_mm256_loadu_ps(src[0] + i), scale);
+            __m256i b = FloatToS16Avx2(_mm256_loadu_ps(src[0] + i + 8), scale);
+            // packs 按 128 位通道打包, 需要 permute4x64(0xD8) 恢复顺序
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), packed);
+        }
+    } else if (nb_channels == 2) {
+        for (; i + 8 <= nb_samples; i += 8) {
+            __m256i l = FloatToS16Avx2(_mm256_loadu_ps(src[0] + i), scale);
+            __m256i r = FloatToS16Avx2(_mm256_loadu_ps(src[1] + i), scale);
+            // 通道内交错后再打包, 结果恰好是 L0 R0 ... L7 R7, 不需要再 permute
+            __m256i lr = _mm256_packs_epi32(_mm256_unpacklo_epi32(l, r), _mm256_unpackhi_epi32(l, r));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 2 * i), lr);
+        }
+    }
+    if (i < nb_samples && nb_channels <= 8) {
+        float const *tail[8];
+        for (int c{0}; c < nb_channels; ++c) {
+            tail[c] = src[c] + i;
+        }
+        FltpToS16Sse2(dst + i * nb_channels, tail, nb_channels, nb_samples - i, volume);
+    } else if (i < nb_samples) {
+        FltpToS16Scalar(dst, src, nb_channels, nb_samples, volume);
+    }
+}
+
+__attribute__((target("avx2"))) static void ScaleS16Avx2(int16_t *buf, int nb_samples, float volume) {
+    __m256 const scale = _mm256_set1_ps(volume);
+    int i{0};
+    for (; i + 16 <= nb_samples; i += 16) {
+        __m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const *>(buf + i)));
+        __m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const *>(buf + i + 8)));
+        lo = FloatToS16Avx2(_mm256_cvtepi32_ps(lo), scale);
+        hi = FloatToS16Avx2(_mm256_cvtepi32_ps(hi), scale);
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(buf + i), packed);
+    }
+    ScaleS16Sse2(buf + i, nb_samples - i, volume);
+}
+
+__attribute__((target("avx2"))) static void MixS16Avx2(int16_t *dst, int16_t const *const *srcs, float const *gains,
+                                                       int nb_tracks, int nb_samples) {
+    __m256 const one = _mm256_set1_ps(1.0f);
+    int i{0};
+    for (; i + 16 <= nb_samples; i += 16) {
+        __m256 lo = _mm256_setzero_ps();
+        __m256 hi = _mm256_setzero_ps();
+        for (int t{0}; t < nb_tracks; ++t) {
+            __m256i x_lo = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const *>(srcs[t] + i)));
+            __m256i x_hi = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const *>(srcs[t] + i + 8)));
+            __m256 gain = _mm256_set1_ps(gains[t]);
+            lo = _mm256_add_ps(lo, _mm256_mul_ps(_mm256_cvtepi32_ps(x_lo), gain));
+            hi = _mm256_add_ps(hi, _mm256_mul_ps(_mm256_cvtepi32_ps(x_hi), gain));
+        }
+        __m256i packed = _mm256_packs_epi32(FloatToS16Avx2(lo, one), FloatToS16Avx2(hi, one));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+    if (i < nb_samples) {
+        int16_t const *tail[16];
+        if (nb_tracks <= 16) {
+            for (int t{0}; t < nb_tracks; ++t) {
+                tail[t] = srcs[t] + i;
+            }
+            MixS16Sse2(dst + i, tail, gains, nb_tracks, nb_samples - i);
+        } else {
+            MixS16Scalar(dst, srcs, gains, nb_tracks, nb_samples);
+        }
+    }
+}
+#endif
+
+// ================== 运行时分派 ==================
+
+static SimdLevel DetectSimdLevel() {
+#ifdef PLAYER_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::kAvx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SimdLevel::kSse2;
+    }
+#endif
+    return SimdLevel::kScalar;
+}
+
+AudioKernels GetAudioKernels(SimdLevel level) {
+    level = static_cast<SimdLevel>(std::min(static_cast<int>(level), static_cast<int>(DetectSimdLevel())));
+    switch (level) {
+#ifdef PLAYER_X86
+        case SimdLevel::kAvx2:
+            return AudioKernels{FltpToS16Avx2, ScaleS16Avx2, MixS16Avx2};
+        case SimdLevel::kSse2:
+            return AudioKernels{FltpToS16Sse2, ScaleS16Sse2, MixS16Sse2};
+#endif
+        default:
+            return AudioKernels{FltpToS16Scalar, ScaleS16Scalar, MixS16Scalar};
+    }
+}
+
+AudioKernels const &GetAudioKernels() {
+    static AudioKernels const kernels{GetAudioKernels(DetectSimdLevel())};
+    return kernels;
+}
+
+char const *SimdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::kAvx2:
+            return "avx2";
+        case SimdLevel::kSse2:
+            return "sse2";
+        default:
+            return "scalar";
+    }
+}
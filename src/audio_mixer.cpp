@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <cstring>
+#include <player/audio_kernels.hpp>
+#include <player/audio_mixer.hpp>
+#include <player/const.hpp>
+#include <player/memory_governor.hpp>
+
+int InitAudioMixer(AudioMixer *mixer, int sample_rate, AVChannelLayout const *ch_layout, int callback_bytes) {
+    mixer->sample_rate_ = sample_rate;
+    if (av_channel_layout_copy(&mixer->ch_layout_, ch_layout) < 0) {
+        av_log(nullptr, AV_LOG_ERROR, "av_channel_layout_copy failed\n");
+        return -1;
+    }
+    mixer->scratch_samples_ = callback_bytes / static_cast<int>(sizeof(int16_t));
+    return 0;
+}
+
+// 添加一个混音源, 必须在音频回调启动前调用
+MixerSource *AddMixerSource(AudioMixer *mixer, std::string const &name, float gain) {
+    if (static_cast<int>(mixer->sources_.size()) >= kMaxMixerSources) {
+        av_log(nullptr, AV_LOG_ERROR, "too many mixer sources (max %d)\n", kMaxMixerSources);
+        return nullptr;
+    }
+    auto source = std::make_unique<MixerSource>();
+    source->name_ = name;
+    source->gain_ = gain;
+    // 环形缓冲的容量就是这个源相对设备的最大延迟
+    int nb_channels{mixer->ch_layout_.nb_channels};
+    source->ring_.resize(static_cast<size_t>(kMixerBufferTime * mixer->sample_rate_) * nb_channels);
+    ChargeMemory(MemoryComponent::kAudio, static_cast<int64_t>(source->ring_.size() * sizeof(int16_t)));
+    mixer->sources_.push_back(std::move(source));
+    mixer->scratch_.resize(mixer->sources_.size() * mixer->scratch_samples_);
+    return mixer->sources_.back().get();
+}
+
+// 把一帧转成设备格式放进 convert_buffer_, 之后由 FlushMixerSource 写入环形缓冲
+int ConvertMixerFrame(AudioMixer const *mixer, MixerSource *source, AVFrame *frame) {
+    AudioKernels const &kernels{GetAudioKernels()};
+    int nb_channels{mixer->ch_layout_.nb_channels};
+    bool direct = frame->sample_rate == mixer->sample_rate_ &&
+                  !av_channel_layout_compare(&frame->ch_layout, &mixer->ch_layout_) &&
+                  (frame->format == AV_SAMPLE_FMT_FLTP || frame->format == AV_SAMPLE_FMT_FLT ||
+                   frame->format == AV_SAMPLE_FMT_S16);
+
+    // ================== 转换到设备格式 ==================
+    int nb_samples{0};  // 每个声道的样本数
+    if (direct) {
+        nb_samples = frame->nb_samples;
+        source->convert_buffer_.resize(static_cast<size_t>(nb_samples) * nb_channels);
+        int16_t *out{source->convert_buffer_.data()};
+        if (frame->format == AV_SAMPLE_FMT_FLTP) {
+            kernels.fltp_to_s16(out, reinterpret_cast<float const *const *>(frame->extended_data), nb_channels,
+                                nb_samples, 1.0f);
+        } else if (frame->format == AV_SAMPLE_FMT_FLT) {
+            float const *in = reinterpret_cast<float const *>(frame->data[0]);
+            kernels.fltp_to_s16(out, &in, 1, nb_samples * nb_channels, 1.0f);
+        } else {
+            memcpy(out, frame->data[0], source->convert_buffer_.size() * sizeof(int16_t));
+        }
+    } else {
+        if (!source->swr_context_) {
+            swr_alloc_set_opts2(&source->swr_context_, &mixer->ch_layout_, AV_SAMPLE_FMT_S16, mixer->sample_rate_,
+                                &frame->ch_layout, static_cast<AVSampleFormat>(frame->format), frame->sample_rate, 0,
+                                nullptr);
+            if (!source->swr_context_ || swr_init(source->swr_context_) < 0) {
+                av_log(nullptr, AV_LOG_ERROR, "%s: swr_init failed\n", source->name_.c_str());
+                swr_free(&source->swr_context_);
+                return -1;
+            }
+        }
+        int out_count{swr_get_out_samples(source->swr_context_, frame->nb_samples)};
+        source->convert_buffer_.resize(static_cast<size_t>(FFMAX(out_count, 0)) * nb_channels);
+        uint8_t *out{reinterpret_cast<uint8_t *>(source->convert_buffer_.data())};
+        nb_samples = swr_convert(source->swr_context_, &out, out_count,
+                                 const_cast<uint8_t const **>(frame->extended_data), frame->nb_samples);
+        if (nb_samples < 0) {
+            av_log(nullptr, AV_LOG_ERROR, "%s: swr_convert failed\n", source->name_.c_str());
+            return -1;
+        }
+    }
+
+    source->pending_pos_ = 0;
+    source->pending_end_ = static_cast<size_t>(nb_samples) * nb_channels;
+    return 0;
+}
+
+static size_t FreeMixerSpace(MixerSource const *source) {
+    // NOTE: read_pos_ 用 seq_cst 读, 和挂起前登记 space_waiting_ 构成 Dekker 式的同步(见 await_suspend)
+    return source->ring_.size() - static_cast<size_t>(source->write_pos_.load(std::memory_order_relaxed) -
+                                                      source->read_pos_.load());
+}
+
+// 把待写数据尽量写进环形缓冲, 从不阻塞
+// 返回 1 表示全部写完, 0 表示缓冲满(co_await WaitMixerSpace 后再调用), -1 表示混音器已中止
+int FlushMixerSource(MixerSource *source) {
+    if (source->abort_) {
+        return -1;
+    }
+    int16_t const *data{source->convert_buffer_.data()};
+    size_t capacity{source->ring_.size()};
+    uint64_t write_pos{source->write_pos_.load(std::memory_order_relaxed)};
+    size_t n{std::min(FreeMixerSpace(source), source->pending_end_ - source->pending_pos_)};
+    size_t pos{static_cast<size_t>(write_pos % capacity)};
+    size_t first{std::min(n, capacity - pos)};
+    memcpy(source->ring_.data() + pos, data + source->pending_pos_, first * sizeof(int16_t));
+    memcpy(source->ring_.data(), data + source->pending_pos_ + first, (n - first) * sizeof(int16_t));
+    source->write_pos_.store(write_pos + n, std::memory_order_release);
+    source->pending_pos_ += n;
+    if (source->pending_pos_ < source->pending_end_) {
+        // 攒够半个缓冲(或者剩下的全部)再恢复, 避免每次回调都切换一次协程
+        source->space_wanted_ = std::min(source->pending_end_ - source->pending_pos_, capacity / 2);
+        return 0;
+    }
+    return 1;
+}
+
+bool MixerSpaceAwaiter::await_ready() const {
+    return source_->abort_ || FreeMixerSpace(source_) >= source_->space_wanted_;
+}
+
+bool MixerSpaceAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    source_->space_waiter_ = handle;
+    source_->space_waiting_.store(true);
+    // 登记之后再检查一次: 回调可能在登记之前就读走了数据, 那样它看不到 space_waiting_, 不会唤醒我们
+    // 空间已经够了且抢先撤回了登记就不挂起; 撤回失败说明回调已经 Post, 挂起后由执行器恢复
+    // NOTE: 执行器只有一个线程, Post 进去的句柄要等这里返回后才会被恢复
+    if (await_ready() && source_->space_waiting_.exchange(false)) {
+        return false;
+    }
+    return true;
+}
+
+// 回调读走数据后调用: 挂起的生产者等到了足够的空间就交回执行器(只有一方能把 space_waiting_ 换成 false)
+static void WakeMixerSource(AudioMixer *mixer, MixerSource *source) {
+    if (source->space_waiting_.load() && FreeMixerSpace(source) >= source->space_wanted_ &&
+        source->space_waiting_.exchange(false)) {
+        mixer->executor_.Post(source->space_waiter_);
+    }
+}
+
+bool AnySoloMixerSource(AudioMixer const *mixer) {
+    return std::any_of(mixer->sources_.begin(), mixer->sources_.end(),
+                       [](std::unique_ptr<MixerSource> const &source) { return source->solo_.load(); });
+}
+
+// 从一个源的环形缓冲取 n 个样本到 dst, 不足的部分补静音并记一次欠载(只影响这一个源)
+static void ReadMixerSource(AudioMixer *mixer, MixerSource *source, int16_t *dst, size_t n) {
+    size_t capacity{source->ring_.size()};
+    uint64_t read_pos{source->read_pos_.load(std::memory_order_relaxed)};
+    uint64_t write_pos{source->write_pos_.load(std::memory_order_acquire)};
+    size_t available{std::min(static_cast<size_t>(write_pos - read_pos), n)};
+    size_t pos{static_cast<size_t>(read_pos % capacity)};
+    size_t first{std::min(available, capacity - pos)};
+    memcpy(dst, source->ring_.data() + pos, first * sizeof(int16_t));
+    memcpy(dst + first, source->ring_.data(), (available - first) * sizeof(int16_t));
+    if (available < n) {
+        memset(dst + available, 0, (n - available) * sizeof(int16_t));
+        if (!source->eof_) {
+            ++source->underruns_;
+        }
+    }
+    source->read_pos_.store(read_pos + available);  // seq_cst, 见 FreeMixerSpace
+    if (available > 0) {
+        WakeMixerSource(mixer, source);
+    }
+}
+
+// 在音频回调中调用: 把所有源按增益混进 stream(stream 中已经是主音轨的数据)
+// nb_samples 为所有声道的样本总数; 有源 solo 时只播放 solo 的源, 主音轨也静音
+// NOTE: 静音/未 solo 的源照样消费数据, 取消静音后立即是实时的声音
+void MixAudio(AudioMixer *mixer, int16_t *stream, int nb_samples) {
+    if (mixer->sources_.empty()) {
+        return;
+    }
+    AudioKernels const &kernels{GetAudioKernels()};
+    bool any_solo{AnySoloMixerSource(mixer)};
+    int nb_sources{static_cast<int>(mixer->sources_.size())};
+
+    for (int offset{0}; offset < nb_samples; offset += mixer->scratch_samples_) {
+        int n{std::min(mixer->scratch_samples_, nb_samples - offset)};
+        int16_t const *srcs[kMaxMixerSources + 1];
+        float gains[kMaxMixerSources + 1];
+        int nb_tracks{0};
+        if (!any_solo) {
+            srcs[nb_tracks] = stream + offset;
+            gains[nb_tracks++] = 1.0f;  // 主音轨的音量在格式转换时已经乘过
+        }
+        for (int i{0}; i < nb_sources; ++i) {
+            MixerSource *source{mixer->sources_[i].get()};
+            int16_t *scratch{mixer->scratch_.data() + static_cast<size_t>(i) * mixer->scratch_samples_};
+            ReadMixerSource(mixer, source, scratch, n);
+            if (source->muted_ || (any_solo && !source->solo_)) {
+                continue;
+            }
+            srcs[nb_tracks] = scratch;
+            gains[nb_tracks++] = source->gain_;
+        }
+        kernels.mix_s16(stream + offset, srcs, gains, nb_tracks, n);
+    }
+}
+
+// 恢复所有挂起在环形缓冲上的生产者, 之后的写入都返回 -1(之后可以 Shutdown 执行器)
+void AbortAudioMixer(AudioMixer *mixer) {
+    for (std::unique_ptr<MixerSource> &source : mixer->sources_) {
+        source->abort_ = true;
+        if (source->space_waiting_.exchange(false)) {
+            mixer->executor_.Post(source->space_waiter_);
+        }
+    }
+}
+
+void DestroyAudioMixer(AudioMixer *mixer) {
+    for (std::unique_ptr<MixerSource> &source : mixer->sources_) {
+        swr_free(&source->swr_context_);
+        ChargeMemory(MemoryComponent::kAudio, -static_cast<int64_t>(source->ring_.size() * sizeof(int16_t)));
+    }
+    mixer->sources_.clear();
+    mixer->scratch_.clear();
+    av_channel_layout_uninit(&mixer->ch_layout_);
+}
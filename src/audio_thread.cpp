@@ -1,74 +1,180 @@
+#include <player/audio_kernels.hpp>
 #include <player/audio_thread.hpp>
+#include <player/read_thread.hpp>
 
+// av_fast_malloc 的包装: audio_buffer1_ 不够大时重新分配, 并记到内存账上
+static int GrowAudioBuffer(VideoState* video_state, int size) {
+    int64_t old_size{video_state->audio_buffer1_ ? video_state->audio_buffer1_size_ : 0};
+    av_fast_malloc(&video_state->audio_buffer1_, &video_state->audio_buffer1_size_, size);
+    int64_t new_size{video_state->audio_buffer1_ ? video_state->audio_buffer1_size_ : 0};
+    ChargeMemory(MemoryComponent::kAudio, new_size - old_size);
+    return video_state->audio_buffer1_ ? 0 : AVERROR(ENOMEM);
+}
+
+// 释放 audio_buffer1_(调用时回调不能再读 audio_buffer_)
+void FreeAudioBuffer(VideoState* video_state) {
+    if (video_state->audio_buffer_ == video_state->audio_buffer1_) {
+        video_state->audio_buffer_ = nullptr;
+    }
+    if (video_state->audio_buffer1_) {
+        ChargeMemory(MemoryComponent::kAudio, -int64_t{video_state->audio_buffer1_size_});
+    }
+    av_freep(&video_state->audio_buffer1_);
+    video_state->audio_buffer1_size_ = 0;
+}
+
+// 换成读线程交接过来的解码器(当前条目排空后的下一个条目, 或者换轨), 音频设备不重开
+static int SwitchAudioDecoder(VideoState* video_state) {
+    std::optional<DecoderHandoff> handoff = video_state->audio_handoff_.TryPop();
+    if (!handoff) {
+        return -1;  // 播放列表结束
+    }
+    avcodec_free_context(&video_state->audio_codec_context_);
+    video_state->audio_codec_context_ = handoff->codec_context_;
+    video_state->audio_pts_offset_ = handoff->pts_offset_;
+    swr_free(&video_state->audio_swr_context_);  // 新条目的格式可能不同, 重新创建
+    FreeAudioBuffer(video_state);                 // 上一个条目的数据已经播完, 缓冲按新条目的帧大小重新分配
+    return 0;
+}
+
+// 低延迟模式: 队列中积压的音频超过目标延迟时丢掉最旧的包(音频包彼此独立, 可以直接丢)
+static void DropLateAudioPackets(VideoState* video_state) {
+    PacketQueue* q{&video_state->audio_packet_queue_};
+    double time_base{av_q2d(video_state->audio_codec_context_->pkt_timebase)};
+    while (PacketQueueDuration(q) * time_base > video_state->options_.target_latency_) {
+        if (GetPacketQueue(q, &video_state->audio_packet_, 0) <= 0) {
+            break;
+        }
+        av_packet_unref(&video_state->audio_packet_);
+        ++video_state->audio_packet_drops_;
+    }
+}
+
+// 解码出一段设备格式的 PCM(audio_buffer_), 返回字节数
+// 没有更多数据时返回: AVERROR_EOF 播放列表结束, AVERROR_EXIT 队列中止(退出), AVERROR(EAGAIN) 队列暂时为空(只在不阻塞时)
+// 其余负值是无法继续解码的错误; 损坏的包/帧只跳过, 不算错误
 int AudioDecodeFrame(VideoState* video_state) {
     int ret{-1};
+    AVFrame* frame{&video_state->audio_frame_};
     while (true) {
-        // 从队列中读取数据
-        ret = GetPacketQueue(&video_state->audio_packet_queue_, &video_state->audio_packet_, 0);
-        if (ret <= 0) {
-            av_log(nullptr, AV_LOG_ERROR, "GetPacketQueue failed\n");
-            break;
+        // 先取解码器中已有的帧
+        ret = avcodec_receive_frame(video_state->audio_codec_context_, frame);
+        if (ret == AVERROR_EOF) {
+            if (SwitchAudioDecoder(video_state) < 0) {
+                return AVERROR_EOF;
+            }
+            continue;
+        } else if (ret == AVERROR(EAGAIN)) {
+            // 解码器需要更多数据: 从队列中读取
+            // NOTE: 队列为空时返回 -1 让回调输出一段静音, 而不是在回调里空转; 原始输出线程则阻塞等待
+            if (video_state->options_.low_latency_) {
+                DropLateAudioPackets(video_state);
+            }
+            ret = GetPacketQueue(&video_state->audio_packet_queue_, &video_state->audio_packet_,
+                                 video_state->options_.raw_output_);
+            if (ret <= 0) {
+                return ret < 0 ? AVERROR_EXIT : AVERROR(EAGAIN);
+            }
+            // 换轨: 旧解码器中缓存的帧直接丢弃
+            if (IsFlushPacket(&video_state->audio_packet_)) {
+                av_packet_unref(&video_state->audio_packet_);
+                if (SwitchAudioDecoder(video_state) < 0) {
+                    avcodec_flush_buffers(video_state->audio_codec_context_);
+                }
+                continue;
+            }
+            // 空包表示当前条目结束: 送 nullptr 排空解码器中缓存的帧
+            bool drain = IsDrainPacket(&video_state->audio_packet_);
+            ret = avcodec_send_packet(video_state->audio_codec_context_, drain ? nullptr : &video_state->audio_packet_);
+            av_packet_unref(&video_state->audio_packet_);
+            if (ret < 0) {
+                // 损坏的包只影响它自己, 跳过继续解码后面的包
+                av_log(nullptr, AV_LOG_WARNING, "avcodec_send_packet failed, packet skipped\n");
+            }
+            continue;
+        } else if (ret < 0) {
+            av_log(nullptr, AV_LOG_WARNING, "avcodec_receive_frame failed, frame skipped\n");
+            continue;
         }
-        ret = avcodec_send_packet(video_state->audio_codec_context_, &video_state->audio_packet_);
-        av_packet_unref(&video_state->audio_packet_);
-        if (ret < 0) {
-            av_log(nullptr, AV_LOG_ERROR, "avcodec_send_packet failed\n");
-            return -1;
+
+        // 输出设备的格式(S16, 设备的采样率和声道布局)
+        // 采样率和声道布局都一致时只是采样格式转换, 直接走 SIMD 内核; 需要真正重采样时才用 swr
+        int nb_channels{video_state->audio_hw_ch_layout_.nb_channels};
+        float volume{video_state->muted_ ? 0.0f : video_state->volume_.load()};
+        bool direct = frame->sample_rate == video_state->audio_hw_sample_rate_ &&
+                      !av_channel_layout_compare(&frame->ch_layout, &video_state->audio_hw_ch_layout_) &&
+                      (frame->format == AV_SAMPLE_FMT_FLTP || frame->format == AV_SAMPLE_FMT_FLT ||
+                       frame->format == AV_SAMPLE_FMT_S16);
+        if (!direct && !video_state->audio_swr_context_) {
+            swr_alloc_set_opts2(&video_state->audio_swr_context_, &video_state->audio_hw_ch_layout_, AV_SAMPLE_FMT_S16,
+                                video_state->audio_hw_sample_rate_, &frame->ch_layout,
+                                static_cast<AVSampleFormat>(frame->format), frame->sample_rate, 0, nullptr);
+            if (!video_state->audio_swr_context_ || swr_init(video_state->audio_swr_context_) < 0) {
+                av_log(nullptr, AV_LOG_ERROR, "swr_init failed\n");
+                swr_free(&video_state->audio_swr_context_);
+                av_frame_unref(frame);
+                return AVERROR(EINVAL);
+            }
         }
-        while (ret >= 0) {
-            ret = avcodec_receive_frame(video_state->audio_codec_context_, &video_state->audio_frame_);
-            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-                break;
-            } else if (ret < 0) {
-                av_log(nullptr, AV_LOG_ERROR, "avcodec_receive_frame failed\n");
-                return -1;
+
+        AudioKernels const& kernels{GetAudioKernels()};
+        int data_size{0};
+        if (direct) {
+            data_size = av_samples_get_buffer_size(nullptr, nb_channels, frame->nb_samples, AV_SAMPLE_FMT_S16, 1);
+            if (GrowAudioBuffer(video_state, data_size) < 0) {
+                av_frame_unref(frame);
+                return AVERROR(ENOMEM);
             }
-            if (!video_state->audio_swr_context_) {
-                AVChannelLayout in_ch_layout, out_ch_layout;
-                av_channel_layout_copy(&in_ch_layout, &video_state->audio_codec_context_->ch_layout);
-                av_channel_layout_copy(&out_ch_layout, &in_ch_layout);
-
-                // 重采样
-                if (video_state->audio_codec_context_->sample_fmt != AV_SAMPLE_FMT_S16) {
-                    swr_alloc_set_opts2(&video_state->audio_swr_context_, &out_ch_layout, AV_SAMPLE_FMT_S16,
-                                        video_state->audio_codec_context_->sample_rate, &in_ch_layout,
-                                        video_state->audio_codec_context_->sample_fmt,
-                                        video_state->audio_codec_context_->sample_rate, 0, nullptr);
-                    swr_init(video_state->audio_swr_context_);
+            int16_t* out = reinterpret_cast<int16_t*>(video_state->audio_buffer1_);
+            if (frame->format == AV_SAMPLE_FMT_FLTP) {
+                kernels.fltp_to_s16(out, reinterpret_cast<float const* const*>(frame->extended_data), nb_channels,
+                                    frame->nb_samples, volume);
+            } else if (frame->format == AV_SAMPLE_FMT_FLT) {
+                // 交错 float 等价于单个平面
+                float const* in = reinterpret_cast<float const*>(frame->data[0]);
+                kernels.fltp_to_s16(out, &in, 1, frame->nb_samples * nb_channels, volume);
+            } else {
+                // 已经是设备格式, 直接拷贝
+                memcpy(out, frame->data[0], data_size);
+                if (volume != 1.0f) {
+                    kernels.scale_s16(out, frame->nb_samples * nb_channels, volume);
                 }
             }
-            int data_size{0};
-            if (video_state->audio_swr_context_) {
-                uint8_t* const* in = static_cast<uint8_t* const*>(video_state->audio_frame_.extended_data);
-                int in_count = video_state->audio_frame_.nb_samples;
-                uint8_t** out = &video_state->audio_buffer_;  // TODO: audio_buffer_ 内存泄漏问题
-                int out_count = video_state->audio_frame_.nb_samples + 256;
-
-                // 重采样后输出缓冲区大小
-                // = 2 * 2 * video_state->audio_frame_.nb_samples
-                int out_size = av_samples_get_buffer_size(nullptr, video_state->audio_frame_.ch_layout.nb_channels,
-                                                          out_count, AV_SAMPLE_FMT_S16, 0);
-                // 重新分配 audio_buffer_ 内存
-                av_fast_malloc(&video_state->audio_buffer_, &video_state->audio_buffer_size_, out_size);
-
-                // 重采样 -> 返回每个通道的样本数
-                int nb_ch_samples = swr_convert(video_state->audio_swr_context_, out, out_count, in, in_count);
-                data_size = nb_ch_samples * video_state->audio_frame_.ch_layout.nb_channels *
-                            av_get_bytes_per_sample(AV_SAMPLE_FMT_S16);
+        } else {
+            uint8_t* const* in = static_cast<uint8_t* const*>(frame->extended_data);
+            int in_count = frame->nb_samples;
+            uint8_t** out = &video_state->audio_buffer1_;
+            int out_count = (int64_t)frame->nb_samples * video_state->audio_hw_sample_rate_ / frame->sample_rate + 256;
+
+            // 重采样后输出缓冲区大小
+            int out_size = av_samples_get_buffer_size(nullptr, nb_channels, out_count, AV_SAMPLE_FMT_S16, 0);
+            // 重新分配 audio_buffer1_ 内存(不够大时才会重新分配)
+            if (GrowAudioBuffer(video_state, out_size) < 0) {
+                av_frame_unref(frame);
+                return AVERROR(ENOMEM);
             }
-            // HACK: 关键 计算音频时钟
-            if (!isnan(video_state->audio_frame_.pts)) {
-                video_state->audio_clock_ =
-                    video_state->audio_frame_.pts +
-                    (double)video_state->audio_frame_.nb_samples / video_state->audio_frame_.sample_rate;
-            } else {
-                video_state->audio_clock_ = NAN;
+
+            // 重采样 -> 返回每个通道的样本数
+            int nb_ch_samples = swr_convert(video_state->audio_swr_context_, out, out_count, in, in_count);
+            data_size = nb_ch_samples * nb_channels * av_get_bytes_per_sample(AV_SAMPLE_FMT_S16);
+            if (nb_ch_samples > 0 && volume != 1.0f) {
+                kernels.scale_s16(reinterpret_cast<int16_t*>(video_state->audio_buffer1_), nb_ch_samples * nb_channels,
+                                  volume);
             }
-            av_frame_unref(&video_state->audio_frame_);
-            return data_size;
         }
+        video_state->audio_buffer_ = video_state->audio_buffer1_;
+
+        // HACK: 关键 计算音频时钟(秒), 加上播放列表条目的偏移保证跨条目连续
+        if (frame->pts != AV_NOPTS_VALUE) {
+            video_state->audio_clock_ = frame->pts * av_q2d(video_state->audio_codec_context_->pkt_timebase) +
+                                        video_state->audio_pts_offset_ +
+                                        (double)frame->nb_samples / frame->sample_rate;
+        } else {
+            video_state->audio_clock_ = NAN;
+        }
+        av_frame_unref(frame);
+        return data_size;
     }
-    return 0;
 }
 
 /**
@@ -79,14 +185,26 @@ int AudioDecodeFrame(VideoState* video_state) {
  */
 void MyAudioCallback(void* userdata, uint8_t* stream, int len) {
     VideoState* video_state{(VideoState*)userdata};
+    // 回调线程由 SDL 创建, 只能在第一次回调时调整
+    if (!video_state->audio_thread_tuned_) {
+        ApplyThreadPolicy(ThreadRole::kAudio, video_state->options_.thread_policies_);
+        video_state->audio_thread_tuned_ = true;
+    }
+    if (video_state->auto_tune_.collecting_) {
+        int frame_bytes{video_state->audio_hw_ch_layout_.nb_channels * static_cast<int>(sizeof(int16_t))};
+        RecordAudioCallback(&video_state->auto_tune_,
+                            static_cast<double>(len) / frame_bytes / video_state->audio_hw_sample_rate_);
+    }
+    int16_t* mix_stream{reinterpret_cast<int16_t*>(stream)};
+    int mix_samples{len / static_cast<int>(sizeof(int16_t))};
     int remain_len = 0;
     while (len > 0) {
         // 缓冲区没有数据了
         if (video_state->audio_buffer_index_ >= video_state->audio_buffer_size_) {
             // 已经发送我们所有的数据，获取更多
             int decoded_audio_size = AudioDecodeFrame(video_state);
-            if (decoded_audio_size < 0) {  // 如果出错了，输出静音
-                video_state->audio_buffer_ = nullptr;
+            if (decoded_audio_size < 0) {  // 如果出错或者没有数据了，输出静音
+                video_state->audio_buffer_ = nullptr;  // NOTE: 只是不指向 audio_buffer1_, 不会泄漏
                 video_state->audio_buffer_size_ = kSdlAudioBufferSize;
             } else {
                 video_state->audio_buffer_size_ = decoded_audio_size;
@@ -107,9 +225,12 @@ void MyAudioCallback(void* userdata, uint8_t* stream, int len) {
         stream += remain_len;
         video_state->audio_buffer_index_ += remain_len;
     }
+    // 混入其他音频源(没有 --mix 时直接返回)
+    MixAudio(&video_state->audio_mixer_, mix_stream, mix_samples);
 }
 
 int OpenAudio(void* opaque, AVChannelLayout* wanted_channel_layout, int wanted_sample_rate) {
+    VideoState* video_state{static_cast<VideoState*>(opaque)};
     int wanted_nb_channels{wanted_channel_layout->nb_channels};
 
     // 设置音频参数
@@ -118,7 +239,7 @@ int OpenAudio(void* opaque, AVChannelLayout* wanted_channel_layout, int wanted_s
         .format = AUDIO_S16SYS,
         .channels = (uint8_t)wanted_nb_channels,
         .silence = 0,
-        .samples = kSdlAudioBufferSize,
+        .samples = static_cast<uint16_t>(video_state->options_.pipeline_.audio_buffer_size_),
         .callback = MyAudioCallback,
         .userdata = opaque,
     };
@@ -132,5 +253,217 @@ int OpenAudio(void* opaque, AVChannelLayout* wanted_channel_layout, int wanted_s
         av_log(nullptr, AV_LOG_ERROR, "SDL_OpenAudio failed\n");
         return -1;
     }
+
+    // 记录设备实际的格式, 之后所有条目都重采样到这个格式(切换条目不重开设备)
+    video_state->audio_hw_sample_rate_ = spec.freq;
+    video_state->audio_hw_buffer_samples_ = spec.samples;
+    av_channel_layout_uninit(&video_state->audio_hw_ch_layout_);
+    if (spec.channels == wanted_nb_channels) {
+        av_channel_layout_copy(&video_state->audio_hw_ch_layout_, wanted_channel_layout);
+    } else {
+        av_channel_layout_default(&video_state->audio_hw_ch_layout_, spec.channels);
+    }
     return spec.size;
-}
\ No newline at end of file
+}
+
+// 换一个缓冲大小重新打开音频设备(主线程调用), 设备格式不变, 解码/重采样/混音的状态都不受影响
+int ReopenAudio(VideoState* video_state, int samples) {
+    SDL_CloseAudio();                          // 等正在运行的回调返回
+    video_state->audio_thread_tuned_ = false;  // 新设备的回调在另一个线程
+    SDL_AudioSpec wanted_spec{};
+    wanted_spec.freq = video_state->audio_hw_sample_rate_;
+    wanted_spec.format = AUDIO_S16SYS;
+    wanted_spec.channels = static_cast<uint8_t>(video_state->audio_hw_ch_layout_.nb_channels);
+    wanted_spec.samples = static_cast<uint16_t>(samples);
+    wanted_spec.callback = MyAudioCallback;
+    wanted_spec.userdata = video_state;
+    // obtained 传 nullptr: SDL 保证回调拿到的就是这个格式(必要时在内部转换)
+    if (SDL_OpenAudio(&wanted_spec, nullptr) < 0) {
+        av_log(nullptr, AV_LOG_ERROR, "SDL_OpenAudio failed: %s\n", SDL_GetError());
+        return -1;
+    }
+    video_state->audio_hw_buffer_samples_ = samples;
+    if (!video_state->paused_) {
+        SDL_PauseAudio(0);
+    }
+    return 0;
+}
+
+// 原始输出模式不开音频设备: 按第一个条目解码器的采样率和声道布局输出 S16
+int OpenRawAudio(void* opaque, AVChannelLayout* wanted_channel_layout, int wanted_sample_rate) {
+    VideoState* video_state{static_cast<VideoState*>(opaque)};
+    video_state->audio_hw_sample_rate_ = wanted_sample_rate;
+    av_channel_layout_uninit(&video_state->audio_hw_ch_layout_);
+    if (av_channel_layout_copy(&video_state->audio_hw_ch_layout_, wanted_channel_layout) < 0) {
+        av_log(nullptr, AV_LOG_ERROR, "av_channel_layout_copy failed\n");
+        return -1;
+    }
+    return 0;
+}
+
+// 原始输出模式的音频线程: 代替音频回调拉取解码后的 PCM, 写不动时阻塞(不按时钟播放)
+int RawAudioThread(void* arg) {
+    VideoState* video_state{static_cast<VideoState*>(arg)};
+    RawSink* sink{&video_state->raw_audio_sink_};
+    ApplyThreadPolicy(ThreadRole::kAudio, video_state->options_.thread_policies_);
+    while (WaitRawOutputResumed(video_state)) {
+        int decoded_audio_size{AudioDecodeFrame(video_state)};
+        if (decoded_audio_size == AVERROR_EOF || decoded_audio_size == AVERROR_EXIT) {
+            break;  // 播放列表结束或队列中止
+        }
+        if (decoded_audio_size < 0) {
+            // 解码不下去了: 整个管线退出, 否则读线程会一直等这条不再被消费的音频队列
+            av_log(nullptr, AV_LOG_ERROR, "raw audio: decoding failed, stopping\n");
+            sink->error_ = -1;
+            RequestQuit(video_state);
+            break;
+        }
+        if (WriteRawAudio(sink, video_state->audio_buffer_, decoded_audio_size, video_state->audio_hw_sample_rate_,
+                          video_state->audio_hw_ch_layout_.nb_channels) < 0) {
+            sink->error_ = -1;
+            RequestQuit(video_state);
+            break;
+        }
+        // audio_clock_ 是这段数据结束处的时间
+        double bytes_per_sec{static_cast<double>(video_state->audio_hw_sample_rate_) *
+                             video_state->audio_hw_ch_layout_.nb_channels * sizeof(int16_t)};
+        double end_pts{video_state->audio_clock_};
+        MarkRawSinkTime(sink, end_pts - decoded_audio_size / bytes_per_sec, end_pts);
+    }
+    FinishRawOutputThread(video_state);
+    return 0;
+}
+// ================== Mixer ==================
+
+// 混音器中止后让阻塞在网络 IO 上的 avformat 调用尽快返回, 执行器线程才能退出
+static int MixSourceInterrupt(void* opaque) {
+    return static_cast<MixerSource*>(opaque)->abort_.load(std::memory_order_relaxed);
+}
+
+// 打开混音源的输入, 返回选中的音频流下标(其余流全部丢弃), 失败返回 -1
+static int OpenMixSourceInput(AVFormatContext** format_context, MixSourceOptions const& options,
+                              MixerSource* source) {
+    *format_context = avformat_alloc_context();
+    if (!*format_context) {
+        return -1;
+    }
+    (*format_context)->interrupt_callback = {MixSourceInterrupt, source};
+    if (avformat_open_input(format_context, options.url_.c_str(), nullptr, nullptr) < 0) {
+        av_log(nullptr, AV_LOG_ERROR, "avformat_open_input failed: %s\n", options.url_.c_str());
+        return -1;
+    }
+    if (avformat_find_stream_info(*format_context, nullptr) < 0) {
+        av_log(nullptr, AV_LOG_ERROR, "avformat_find_stream_info failed: %s\n", options.url_.c_str());
+        return -1;
+    }
+    int stream_idx{-1};
+    if (options.track_ < 0) {
+        stream_idx = av_find_best_stream(*format_context, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+    } else {
+        // 第 track_ 条音频流
+        for (uint32_t i{0}, nb_audio{0}; i < (*format_context)->nb_streams; ++i) {
+            if ((*format_context)->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO &&
+                static_cast<int>(nb_audio++) == options.track_) {
+                stream_idx = static_cast<int>(i);
+                break;
+            }
+        }
+    }
+    if (stream_idx < 0) {
+        av_log(nullptr, AV_LOG_ERROR, "%s: no audio track %d\n", options.url_.c_str(), options.track_);
+        return -1;
+    }
+    for (uint32_t i{0}; i < (*format_context)->nb_streams; ++i) {
+        (*format_context)->streams[i]->discard = static_cast<int>(i) == stream_idx ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+    }
+    return stream_idx;
+}
+
+// 混音源会话(协程): 解复用 + 解码一路音频, 写入混音器的环形缓冲
+// 缓冲满时挂起, 由音频回调的消费速度决定节奏, 执行器线程转去服务其他源;
+// 暂停时回调停止, 所有会话都挂起, 执行器线程睡眠(没有周期性的唤醒)
+// 打开输入和读包可能阻塞在网络上, 交给阻塞工作线程, 一个慢的源不会让其他源欠载
+static Task MixSourceSession(VideoState* video_state, MixerSource* source, MixSourceOptions options) {
+    Executor* executor{&video_state->audio_mixer_.executor_};
+    AVFormatContext* format_context{nullptr};
+    AVCodecContext* codec_context{nullptr};
+    AVPacket* packet{av_packet_alloc()};
+    AVFrame* frame{av_frame_alloc()};
+    int64_t underruns_reported{0};
+    int64_t report_time{0};
+
+    int stream_idx{-1};
+    co_await executor->Blocking([&] { stream_idx = OpenMixSourceInput(&format_context, options, source); });
+    if (stream_idx >= 0) {
+        codec_context = OpenCodecContext(format_context->streams[stream_idx], video_state->options_);
+    }
+    while (codec_context && !source->abort_) {
+        int ret{0};
+        co_await executor->Blocking([&] { ret = av_read_frame(format_context, packet); });
+        if (ret >= 0 && packet->stream_index != stream_idx) {
+            av_packet_unref(packet);
+            continue;
+        }
+        // 读到结尾时送 nullptr 排空解码器
+        ret = avcodec_send_packet(codec_context, ret >= 0 ? packet : nullptr);
+        av_packet_unref(packet);
+        if (ret < 0) {
+            break;
+        }
+        while ((ret = avcodec_receive_frame(codec_context, frame)) >= 0) {
+            ret = ConvertMixerFrame(&video_state->audio_mixer_, source, frame);
+            av_frame_unref(frame);
+            while (ret >= 0 && (ret = FlushMixerSource(source)) == 0) {
+                co_await WaitMixerSpace(source);
+            }
+            if (ret < 0) {
+                break;
+            }
+        }
+        if (ret != AVERROR(EAGAIN)) {
+            break;  // 排空完毕(EOF)、出错或者混音器已中止
+        }
+
+        // 欠载只影响这一个源, 每秒最多报告一次
+        int64_t underruns{source->underruns_};
+        int64_t now{av_gettime_relative()};
+        if (underruns != underruns_reported && now - report_time >= 1000000) {
+            av_log(nullptr, AV_LOG_WARNING, "mix source %s: %lld underruns\n", source->name_.c_str(),
+                   static_cast<long long>(underruns));
+            underruns_reported = underruns;
+            report_time = now;
+        }
+        co_await executor->Yield();  // 每个包之后让其他源也跑一跑(读包在工作线程上时也已经让出过)
+    }
+    source->eof_ = true;
+    av_log(nullptr, AV_LOG_INFO, "mix source %s finished\n", source->name_.c_str());
+
+    av_frame_free(&frame);
+    av_packet_free(&packet);
+    avcodec_free_context(&codec_context);
+    avformat_close_input(&format_context);
+}
+
+// 按设备格式初始化混音器并启动混音源的执行器, 必须在音频回调启动(SDL_PauseAudio(0))之前调用
+int StartMixSources(VideoState* video_state, int callback_bytes) {
+    std::vector<MixSourceOptions> const& mix_sources{video_state->options_.mix_sources_};
+    if (mix_sources.empty()) {
+        return 0;
+    }
+    AudioMixer* mixer{&video_state->audio_mixer_};
+    if (InitAudioMixer(mixer, video_state->audio_hw_sample_rate_, &video_state->audio_hw_ch_layout_,
+                       callback_bytes) < 0) {
+        return -1;
+    }
+    for (MixSourceOptions const& options : mix_sources) {
+        std::string name{options.track_ < 0 ? options.url_ : options.url_ + "#" + std::to_string(options.track_)};
+        MixerSource* source{AddMixerSource(mixer, name, options.gain_)};
+        if (!source) {
+            break;
+        }
+        mixer->executor_.Spawn(MixSourceSession(video_state, source, options));
+    }
+    mixer->executor_.Start();  // 不管有多少个源都只有这一个线程
+    video_state->audio_mixer_ready_ = true;
+    return 0;
+}
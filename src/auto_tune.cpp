@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <cmath>
+#include <player/audio_thread.hpp>
+#include <player/auto_tune.hpp>
+
+static uint32_t AutoTuneTimerCallback(uint32_t, void *opaque) {
+    SDL_Event event{};
+    event.type = kFFAutoTuneEvent;
+    event.user.data1 = opaque;
+    SDL_PushEvent(&event);  // 到主线程再调整(重开音频设备要在主线程)
+    return 0;
+}
+
+// 开始采集, kAutoTuneTime 之后由主线程的 FinishAutoTune 调整
+void StartAutoTune(VideoState *video_state) {
+    video_state->auto_tune_.collecting_ = true;
+    SDL_AddTimer(kAutoTuneTime, AutoTuneTimerCallback, video_state);
+}
+
+// 解码线程每解出一帧调用一次(只在采集期间)
+void RecordDecodeTime(AutoTune *tune, double decode_time, double frame_duration) {
+    std::lock_guard lk{tune->mtx_};
+    AutoTuneStats *stats{&tune->stats_};
+    ++stats->nb_frames_;
+    stats->decode_time_sum_ += decode_time;
+    stats->decode_time_sq_sum_ += decode_time * decode_time;
+    stats->decode_time_max_ = std::max(stats->decode_time_max_, decode_time);
+    if (frame_duration > 0) {
+        stats->frame_duration_ = frame_duration;
+    }
+}
+
+// 音频回调每次调用一次(只在采集期间), buffer_time 为这次回调要填的数据的时长
+void RecordAudioCallback(AutoTune *tune, double buffer_time) {
+    int64_t now{av_gettime_relative()};
+    std::lock_guard lk{tune->mtx_};
+    AutoTuneStats *stats{&tune->stats_};
+    // 刚开始时 SDL 连续回调几次把设备缓冲填满; 超过 1 秒的间隔是暂停造成的, 都不算抖动
+    double interval{(now - stats->last_callback_time_) / 1000000.0};
+    if (stats->nb_callbacks_++ >= 4 && interval < 1.0) {
+        stats->callback_lateness_max_ = std::max(stats->callback_lateness_max_, interval - buffer_time);
+    }
+    stats->last_callback_time_ = now;
+}
+
+// 解码最慢的一帧要 decode_time_max_, 这期间显示会用掉 decode_time_max_ / frame_duration_ 帧,
+// 队列里要预先准备好这么多帧, 再加上 keep_last 保留的正在显示的一帧
+static void TuneFrameQueue(VideoState *video_state, AutoTuneStats const &stats) {
+    FrameQueue *f{&video_state->video_frame_queue_};
+    double mean{stats.decode_time_sum_ / stats.nb_frames_};
+    double stddev{std::sqrt(std::max(0.0, stats.decode_time_sq_sum_ / stats.nb_frames_ - mean * mean))};
+    int ahead{std::max(1, static_cast<int>(std::ceil(stats.decode_time_max_ / stats.frame_duration_)))};
+    int depth{std::min(1 + ahead, f->capacity_)};
+    av_log(nullptr, AV_LOG_INFO,
+           "auto-tune: decode %.2f ms avg, %.2f ms stddev, %.2f ms max per %.2f ms frame -> frame queue %d -> %d\n",
+           mean * 1000, stddev * 1000, stats.decode_time_max_ * 1000, stats.frame_duration_ * 1000, f->max_size_,
+           depth);
+    if (mean > stats.frame_duration_) {
+        av_log(nullptr, AV_LOG_WARNING, "auto-tune: decoding is slower than real time, frames will be late anyway\n");
+    }
+    SetFrameQueueMaxSize(f, depth);
+}
+
+// 回调最晚会比预期晚 callback_lateness_max_, 一个缓冲的时长要能盖住它(留一倍余量)
+static void TuneAudioBuffer(VideoState *video_state, AutoTuneStats const &stats) {
+    int current{video_state->audio_hw_buffer_samples_};
+    double needed{2 * stats.callback_lateness_max_ * video_state->audio_hw_sample_rate_};
+    int samples{kLowLatencyAudioBufferSize};
+    while (samples < kAutoTuneMaxAudioBufferSize && samples < needed) {
+        samples *= 2;
+    }
+    av_log(nullptr, AV_LOG_INFO, "auto-tune: audio callbacks up to %.2f ms late -> audio buffer %d -> %d samples\n",
+           stats.callback_lateness_max_ * 1000, current, samples);
+    if (samples == current) {
+        return;
+    }
+    if (ReopenAudio(video_state, samples) < 0 && ReopenAudio(video_state, current) < 0) {
+        av_log(nullptr, AV_LOG_ERROR, "auto-tune: cannot reopen the audio device\n");
+    }
+}
+
+// 主线程收到 kFFAutoTuneEvent 时调用: 数据够了就按测量结果调整, 否则(暂停了或者还没开始播放)继续采集
+void FinishAutoTune(VideoState *video_state) {
+    AutoTune *tune{&video_state->auto_tune_};
+    bool has_video{video_state->video_stream_ != nullptr};
+    bool has_audio{video_state->audio_stream_ != nullptr && video_state->audio_hw_buffer_samples_ > 0};
+    AutoTuneStats stats;
+    {
+        std::lock_guard lk{tune->mtx_};
+        stats = tune->stats_;
+        if (!video_state->paused_ && (!has_video || stats.nb_frames_ >= kAutoTuneMinFrames) &&
+            (!has_audio || stats.nb_callbacks_ >= kAutoTuneMinCallbacks)) {
+            tune->collecting_ = false;
+        }
+    }
+    if (tune->collecting_) {
+        SDL_AddTimer(kAutoTuneTime, AutoTuneTimerCallback, video_state);
+        return;
+    }
+    if (has_video && stats.frame_duration_ > 0) {
+        TuneFrameQueue(video_state, stats);
+    }
+    if (has_audio) {
+        TuneAudioBuffer(video_state, stats);
+    }
+}
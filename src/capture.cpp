@@ -0,0 +1,327 @@
+#include <ctime>
+#include <player/capture.hpp>
+#include <player/scope_guard.hpp>
+#include <player/thumbnail.hpp>
+#include <player/video_thread.hpp>
+
+static void FreeClipPackets(std::vector<ClipPacket> *packets) {
+    for (ClipPacket &p : *packets) {
+        ChargeMemory(MemoryComponent::kPackets, -PacketMemorySize(p.packet_));
+        av_packet_free(&p.packet_);
+    }
+    packets->clear();
+}
+
+static void ClearClipRing(ClipRing *ring) {
+    for (std::vector<ClipPacket> &gop : ring->gops_) {
+        FreeClipPackets(&gop);
+    }
+    ring->gops_.clear();
+}
+
+// 开始记录一条新的流: 之前的包属于别的流参数, 全部丢掉
+static int ResetClipStream(ClipRing *ring, AVStream const *stream) {
+    bool video{stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO};
+    AVCodecParameters **par{video ? &ring->video_par_ : &ring->audio_par_};
+    ClearClipRing(ring);
+    (video ? ring->video_stream_ : ring->audio_stream_) = stream;
+    (video ? ring->video_time_base_ : ring->audio_time_base_) = stream->time_base;
+    if (!*par && !(*par = avcodec_parameters_alloc())) {
+        return AVERROR(ENOMEM);
+    }
+    return avcodec_parameters_copy(*par, stream->codecpar);
+}
+
+// 读线程调用: 包放进队列之前另外引用一份记到环形缓冲里
+void RecordClipPacket(ClipRing *ring, AVStream const *stream, AVPacket const *packet) {
+    if (ring->seconds_ <= 0 || !stream) {
+        return;
+    }
+    bool video{stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO};
+    std::lock_guard lk{ring->mtx_};
+    if (stream != (video ? ring->video_stream_ : ring->audio_stream_) && ResetClipStream(ring, stream) < 0) {
+        return;
+    }
+    AVPacket *clone{av_packet_clone(packet)};
+    if (!clone) {
+        return;
+    }
+    ChargeMemory(MemoryComponent::kPackets, PacketMemorySize(clone));
+
+    int64_t ts{packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts};
+    double time{ts != AV_NOPTS_VALUE ? ts * av_q2d(stream->time_base)
+                                     : (ring->gops_.empty() ? 0 : ring->gops_.back().back().time_)};
+    // 视频关键帧开始新的一组; 只有音频时每 kClipAudioGroupTime 秒一组
+    bool new_gop{ring->gops_.empty() || (video && (packet->flags & AV_PKT_FLAG_KEY)) ||
+                 (!ring->video_stream_ && time - ring->gops_.back().front().time_ >= kClipAudioGroupTime)};
+    if (new_gop) {
+        ring->gops_.emplace_back();
+    }
+    ring->gops_.back().push_back({clone, video, time});
+
+    // 第二组的开头也已经超出 seconds_ 了, 第一组整组都用不到
+    while (ring->gops_.size() > 1 && time - ring->gops_[1].front().time_ >= ring->seconds_) {
+        FreeClipPackets(&ring->gops_.front());
+        ring->gops_.pop_front();
+    }
+}
+
+void FreeClipRing(ClipRing *ring) {
+    std::lock_guard lk{ring->mtx_};
+    ClearClipRing(ring);
+    avcodec_parameters_free(&ring->video_par_);
+    avcodec_parameters_free(&ring->audio_par_);
+    ring->video_stream_ = nullptr;
+    ring->audio_stream_ = nullptr;
+}
+
+// ================== Worker ==================
+
+// 转换成图片编码器的格式(PNG 为 RGB24, JPEG 为全范围的 YUVJ420P), 按 SAR 拉伸成显示时的宽高比
+static int WriteScreenshot(AVFrame const *frame, std::string const &base_path, bool png) {
+    AVRational sar{frame->sample_aspect_ratio.num > 0 ? frame->sample_aspect_ratio : av_make_q(1, 1)};
+    int width{static_cast<int>(av_rescale(frame->width, sar.num, sar.den)) & ~1};
+    AVFrame *image{av_frame_alloc()};
+    if (!image) {
+        return AVERROR(ENOMEM);
+    }
+    image->format = png ? AV_PIX_FMT_RGB24 : AV_PIX_FMT_YUVJ420P;
+    image->width = FFMAX(width, 2);
+    image->height = frame->height;
+    int ret{av_frame_get_buffer(image, 0)};
+    SwsContext *sws_context{nullptr};
+    if (ret >= 0) {
+        sws_context = sws_getContext(frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+                                     image->width, image->height, static_cast<AVPixelFormat>(image->format),
+                                     SWS_BICUBIC, nullptr, nullptr, nullptr);
+        ret = sws_context ? 0 : -1;
+    }
+    if (ret >= 0) {
+        ret = sws_scale(sws_context, frame->data, frame->linesize, 0, frame->height, image->data, image->linesize) > 0
+                  ? 0
+                  : -1;
+    }
+    std::string path{base_path + (png ? ".png" : ".jpg")};
+    if (ret >= 0) {
+        ret = WriteImageFile(image, path, png);
+    }
+    if (ret < 0) {
+        av_log(nullptr, AV_LOG_ERROR, "screenshot: cannot write %s\n", path.c_str());
+    } else {
+        av_log(nullptr, AV_LOG_INFO, "screenshot: %s (%dx%d)\n", path.c_str(), image->width, image->height);
+    }
+    sws_freeContext(sws_context);
+    av_frame_free(&image);
+    return ret;
+}
+
+static AVStream *AddClipStream(AVFormatContext *format_context, AVCodecParameters const *par, AVRational time_base) {
+    AVStream *stream{avformat_new_stream(format_context, nullptr)};
+    if (!stream || avcodec_parameters_copy(stream->codecpar, par) < 0) {
+        return nullptr;
+    }
+    stream->codecpar->codec_tag = 0;  // 原容器的 tag 在新容器里不一定合法, 由复用器重新选择
+    stream->time_base = time_base;
+    return stream;
+}
+
+// 转封装环形缓冲中的包(不重新编码), 从第一个视频关键帧开始
+static int WriteClip(ClipRing *ring, std::string const &base_path) {
+    // 只在拷贝引用时持锁, 读线程最多被挡住这一会儿
+    std::vector<ClipPacket> packets;
+    AVCodecParameters *video_par{nullptr};
+    AVCodecParameters *audio_par{nullptr};
+    AVRational video_time_base;
+    AVRational audio_time_base;
+    {
+        std::lock_guard lk{ring->mtx_};
+        for (std::vector<ClipPacket> const &gop : ring->gops_) {
+            for (ClipPacket const &p : gop) {
+                if (AVPacket *clone = av_packet_clone(p.packet_)) {
+                    packets.push_back({clone, p.video_, p.time_});
+                }
+            }
+        }
+        if (ring->video_par_ && ring->video_stream_ && (video_par = avcodec_parameters_alloc())) {
+            avcodec_parameters_copy(video_par, ring->video_par_);
+        }
+        if (ring->audio_par_ && ring->audio_stream_ && (audio_par = avcodec_parameters_alloc())) {
+            avcodec_parameters_copy(audio_par, ring->audio_par_);
+        }
+        video_time_base = ring->video_time_base_;
+        audio_time_base = ring->audio_time_base_;
+    }
+
+    size_t start{0};
+    while (video_par && start < packets.size() &&
+           !(packets[start].video_ && (packets[start].packet_->flags & AV_PKT_FLAG_KEY))) {
+        ++start;
+    }
+    int ret{-1};
+    AVFormatContext *format_context{nullptr};
+    std::string path;
+    ScopeGuard cleanup{[&] {
+        if (ret < 0 && !path.empty()) {
+            av_log(nullptr, AV_LOG_ERROR, "clip: cannot write %s\n", path.c_str());
+        }
+        if (format_context) {
+            avio_closep(&format_context->pb);
+            avformat_free_context(format_context);
+        }
+        for (ClipPacket &p : packets) {
+            av_packet_free(&p.packet_);
+        }
+        avcodec_parameters_free(&video_par);
+        avcodec_parameters_free(&audio_par);
+    }};
+    if (start >= packets.size()) {
+        av_log(nullptr, AV_LOG_WARNING, "clip: no keyframe recorded yet\n");
+        return ret;
+    }
+    double start_time{packets[start].time_};
+
+    // MP4 放不下的编码格式(比如 PCM 音频、一些老的视频编码)改用 MKV
+    AVOutputFormat const *mp4{av_guess_format("mp4", nullptr, nullptr)};
+    bool use_mp4{mp4 && (!video_par || avformat_query_codec(mp4, video_par->codec_id, FF_COMPLIANCE_NORMAL) == 1) &&
+                 (!audio_par || avformat_query_codec(mp4, audio_par->codec_id, FF_COMPLIANCE_NORMAL) == 1)};
+    path = base_path + (use_mp4 ? ".mp4" : ".mkv");
+    if (avformat_alloc_output_context2(&format_context, nullptr, use_mp4 ? "mp4" : "matroska", path.c_str()) < 0) {
+        return ret;
+    }
+    AVStream *video_stream{nullptr};
+    AVStream *audio_stream{nullptr};
+    if ((video_par && !(video_stream = AddClipStream(format_context, video_par, video_time_base))) ||
+        (audio_par && !(audio_stream = AddClipStream(format_context, audio_par, audio_time_base)))) {
+        return ret;
+    }
+    if (avio_open(&format_context->pb, path.c_str(), AVIO_FLAG_WRITE) < 0 ||
+        avformat_write_header(format_context, nullptr) < 0) {
+        return ret;
+    }
+
+    ret = 0;
+    int nb_written{0};
+    for (size_t i{start}; i < packets.size() && ret >= 0; ++i) {
+        ClipPacket &p{packets[i]};
+        AVStream *out{p.video_ ? video_stream : audio_stream};
+        if (!out || p.time_ < start_time) {
+            continue;  // 关键帧之前的音频包
+        }
+        AVRational time_base{p.video_ ? video_time_base : audio_time_base};
+        // 时间戳从 0 开始(关键帧的 dts 为 0, 有 B 帧时 pts 略大于 0)
+        int64_t offset{av_rescale_q(std::llrint(start_time * AV_TIME_BASE), AV_TIME_BASE_Q, time_base)};
+        if (p.packet_->pts != AV_NOPTS_VALUE) {
+            p.packet_->pts -= offset;
+        }
+        if (p.packet_->dts != AV_NOPTS_VALUE) {
+            p.packet_->dts -= offset;
+        }
+        av_packet_rescale_ts(p.packet_, time_base, out->time_base);
+        p.packet_->stream_index = out->index;
+        p.packet_->pos = -1;
+        ret = av_interleaved_write_frame(format_context, p.packet_);
+        ++nb_written;
+    }
+    if (ret >= 0) {
+        ret = av_write_trailer(format_context);
+    }
+    if (ret >= 0) {
+        av_log(nullptr, AV_LOG_INFO, "clip: %s (%.1f s, %d packets)\n", path.c_str(),
+               packets.back().time_ - start_time, nb_written);
+    }
+    return ret;
+}
+
+// 截图/剪辑线程: 按顺序处理任务, 收到 kStop 时之前的任务都已经写完
+static int CaptureThread(void *arg) {
+    VideoState *video_state{static_cast<VideoState *>(arg)};
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_LOW);  // 编码和写文件不和解码/显示抢 CPU
+    bool png{video_state->options_.capture_format_ == "png"};
+    while (true) {
+        CaptureJob job{video_state->capture_jobs_.Pop()};
+        if (job.kind_ == CaptureKind::kStop) {
+            break;
+        }
+        if (job.kind_ == CaptureKind::kScreenshot) {
+            WriteScreenshot(job.frame_, job.path_, png);
+            av_frame_free(&job.frame_);
+        } else {
+            WriteClip(&video_state->clip_ring_, job.path_);
+        }
+    }
+    return 0;
+}
+
+// ================== Request ==================
+
+// 输出路径(不含扩展名): <capture_dir>/<prefix>-YYYYmmdd-HHMMSS-mmm
+static std::string CapturePath(VideoState const *video_state, char const *prefix) {
+    int64_t now{av_gettime()};
+    time_t seconds{static_cast<time_t>(now / 1000000)};
+    tm local{};
+    localtime_r(&seconds, &local);
+    char name[64];
+    size_t len{strftime(name, sizeof(name), "-%Y%m%d-%H%M%S", &local)};
+    snprintf(name + len, sizeof(name) - len, "-%03d", static_cast<int>(now / 1000 % 1000));
+    return video_state->options_.capture_dir_ + "/" + prefix + name;
+}
+
+// 第一次请求时启动线程(只由主线程调用)
+static int StartCaptureThread(VideoState *video_state) {
+    if (!video_state->capture_tid_) {
+        video_state->capture_tid_ = SDL_CreateThread(CaptureThread, "capture_thread", video_state);
+        if (!video_state->capture_tid_) {
+            av_log(nullptr, AV_LOG_ERROR, "SDL_CreateThread failed\n");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int PushCaptureJob(VideoState *video_state, CaptureJob job) {
+    if (StartCaptureThread(video_state) < 0) {
+        av_frame_free(&job.frame_);
+        return -1;
+    }
+    // 不阻塞显示线程: 积压太多时丢掉这次请求
+    AVFrame *frame{job.frame_};
+    if (!video_state->capture_jobs_.TryPush(std::move(job))) {
+        av_log(nullptr, AV_LOG_WARNING, "capture: %d requests pending, dropping this one\n", kMaxPendingCaptures);
+        av_frame_free(&frame);
+        return -1;
+    }
+    return 0;
+}
+
+// 截取正在显示的一帧: 在显示线程上只增加这一帧的引用计数, 转换和编码都在截图线程上
+int RequestScreenshot(VideoState *video_state) {
+    Frame *vp{video_state->video_stream_ ? PeekLastFrameQueue(&video_state->video_frame_queue_) : nullptr};
+    if (!vp) {
+        av_log(nullptr, AV_LOG_WARNING, "screenshot: no frame displayed yet\n");
+        return -1;
+    }
+    AVFrame *frame{av_frame_clone(vp->frame_)};
+    if (!frame) {
+        return AVERROR(ENOMEM);
+    }
+    return PushCaptureJob(video_state, {CaptureKind::kScreenshot, frame, vp->pts_, CapturePath(video_state, "shot")});
+}
+
+// 保存最近 --clip-seconds 秒: 包的拷贝和转封装都在剪辑线程上
+int RequestClip(VideoState *video_state) {
+    if (video_state->clip_ring_.seconds_ <= 0) {
+        av_log(nullptr, AV_LOG_WARNING, "clip: not recording, start with --clip-seconds <n>\n");
+        return -1;
+    }
+    return PushCaptureJob(video_state, {CaptureKind::kClip, nullptr, 0, CapturePath(video_state, "clip")});
+}
+
+// JoinVideoState 调用: 等已经提交的任务都写完再退出
+void StopCaptureThread(VideoState *video_state) {
+    if (!video_state->capture_tid_) {
+        return;
+    }
+    video_state->capture_jobs_.Push(CaptureJob{});  // kind_ 默认就是 kStop
+    SDL_WaitThread(video_state->capture_tid_, nullptr);
+    video_state->capture_tid_ = nullptr;
+}
@@ -24,7 +24,9 @@ int PutPacketQueueInternal(PacketQueue *q, AVPacket *pkt) {
         return ret;
     }
     ++q->nb_packets_;
-    q->size_ += pkt1.pkt->size + sizeof(pkt1);
+    int64_t bytes{PacketMemorySize(pkt1.pkt) + static_cast<int64_t>(sizeof(pkt1))};
+    q->size_ += bytes;
+    ChargeMemory(MemoryComponent::kPackets, bytes);
     q->duration_ += pkt1.pkt->duration;
     q->cv_.notify_one();  // 通知等待的线程
     return 0;
@@ -49,17 +51,38 @@ int PutPacketQueue(PacketQueue *q, AVPacket *pkt) {
     return ret;
 }
 
+// 放入一个空包: 通知解码器当前条目结束, 需要排空解码器中剩余的帧
+// flags 带 AV_PKT_FLAG_DISCARD 时表示换轨: 丢弃解码器中缓存的帧而不是排空
+int PutNullPacketQueue(PacketQueue *q, int stream_index, int flags) {
+    AVPacket *pkt{av_packet_alloc()};
+    if (!pkt) {
+        return AVERROR(ENOMEM);
+    }
+    pkt->stream_index = stream_index;
+    pkt->flags = flags;
+    int ret = PutPacketQueue(q, pkt);
+    av_packet_free(&pkt);
+    return ret;
+}
+
 int GetPacketQueue(PacketQueue *q, AVPacket *pkt, int block) {
     std::unique_lock lk{q->mtx_};
     MyAVPacketList pkt1;
     int ret;
     for (;;) {
+        if (q->abort_request_) {
+            ret = -1;
+            break;
+        }
         if (av_fifo_read(q->pkt_list_, &pkt1, 1) >= 0) {
             --q->nb_packets_;
-            q->size_ -= pkt1.pkt->size + sizeof(pkt1);
+            int64_t bytes{PacketMemorySize(pkt1.pkt) + static_cast<int64_t>(sizeof(pkt1))};
+            q->size_ -= bytes;
+            ChargeMemory(MemoryComponent::kPackets, -bytes);
             q->duration_ -= pkt1.pkt->duration;
             av_packet_move_ref(pkt, pkt1.pkt);
             av_packet_free(&pkt1.pkt);
+            q->cv_notfull_.notify_one();  // 通知读线程可以继续读
             ret = 1;
             break;
         } else if (!block) {
@@ -72,15 +95,38 @@ int GetPacketQueue(PacketQueue *q, AVPacket *pkt, int block) {
     return ret;
 }
 
+// 阻塞直到队列占用不超过 max_size(由消费者取走数据时唤醒, 不轮询)
+int WaitPacketQueueNotFull(PacketQueue *q, int max_size) {
+    std::unique_lock lk{q->mtx_};
+    q->cv_notfull_.wait(lk, [&] { return q->size_ <= max_size || q->abort_request_; });
+    return q->abort_request_ ? -1 : 0;
+}
+
+// 队列中所有包的总时长(包的时间基), 生产者同时在写, 必须持锁读
+int64_t PacketQueueDuration(PacketQueue *q) {
+    std::lock_guard lk{q->mtx_};
+    return q->duration_;
+}
+
 void FlushPacketQueue(PacketQueue *q) {
     std::unique_lock lk{q->mtx_};
     MyAVPacketList pkt1;
     while (av_fifo_read(q->pkt_list_, &pkt1, 1) >= 0) {
         av_packet_free(&pkt1.pkt);
     }
+    ChargeMemory(MemoryComponent::kPackets, -q->size_);
     q->nb_packets_ = 0;
     q->size_ = 0;
     q->duration_ = 0;
+    q->cv_notfull_.notify_one();
+}
+
+// 中止队列: 唤醒所有阻塞在队列上的线程, 之后的 Get 都返回 -1
+void AbortPacketQueue(PacketQueue *q) {
+    std::unique_lock lk{q->mtx_};
+    q->abort_request_ = 1;
+    q->cv_.notify_all();
+    q->cv_notfull_.notify_all();
 }
 
 void DestoryPacketQueue(PacketQueue *q) {
@@ -88,13 +134,17 @@ void DestoryPacketQueue(PacketQueue *q) {
     av_fifo_freep2(&q->pkt_list_);
 }
 
-int InitFrameQueue(FrameQueue *f, PacketQueue *pktq, int max_size, int keep_last) {
+int InitFrameQueue(FrameQueue *f, PacketQueue *pktq, int max_size, int capacity, int keep_last) {
     int i;
     memset(f, 0, sizeof(FrameQueue));
     f->pktq_ = pktq;
-    f->max_size_ = FFMIN(max_size, kFrameQueueSize);
+    f->capacity_ = FFMAX(capacity, max_size);
+    f->max_size_ = max_size;
     f->keep_last_ = !!keep_last;
-    for (i = 0; i < f->max_size_; i++) {
+    if (!(f->queue_ = static_cast<Frame *>(av_calloc(f->capacity_, sizeof(Frame))))) {
+        return AVERROR(ENOMEM);
+    }
+    for (i = 0; i < f->capacity_; i++) {
         // 为 FrameQueue 中的 max_size 个 Frame 分配内存
         if (!(f->queue_[i].frame_ = av_frame_alloc())) {
             return AVERROR(ENOMEM);
@@ -103,16 +153,28 @@ int InitFrameQueue(FrameQueue *f, PacketQueue *pktq, int max_size, int keep_last
     return 0;
 }
 
-// Frame *FrameQueuePeekReadable(FrameQueue *f) {
-//     std::unique_lock lk{f->mtx_};
-//     f->cv_notempty_.wait(lk, [&] { return f->size_ - f->rindex_shown_ > 0; });
-//     return &f->queue_[(f->rindex_ + f->rindex_shown_) % f->max_size_];
-// }
+// peek 出一个还没读过的帧，此函数可能会阻塞。
+// 关联的 PacketQueue 被中止, 或者生产者已结束且没有剩余的帧时返回 nullptr
+Frame *PeekReadableFrameQueue(FrameQueue *f) {
+    std::unique_lock lk{f->mtx_};
+    f->cv_notempty_.wait(lk, [&] { return f->size_ - f->rindex_shown_ > 0 || f->eof_ || f->pktq_->abort_request_; });
+    if (f->pktq_->abort_request_ || f->size_ - f->rindex_shown_ <= 0) {
+        return nullptr;
+    }
+    return &f->queue_[(f->rindex_ + f->rindex_shown_) % f->capacity_];
+}
 
 // peek 出一个可以写的 Frame，此函数可能会阻塞。
+// 关联的 PacketQueue 被中止时返回 nullptr
 Frame *PeekWritableFrameQueue(FrameQueue *f) {
     std::unique_lock lk{f->mtx_};
-    f->cv_notfull_.wait(lk, [&] { return f->size_ < f->max_size_; });
+    // 内存紧张时队列变浅(GovernedFrameQueueSize), 每消费一帧都会重新检查
+    f->cv_notfull_.wait(lk, [&] {
+        return f->size_ < GovernedFrameQueueSize(f->max_size_) || f->pktq_->abort_request_;
+    });
+    if (f->pktq_->abort_request_) {
+        return nullptr;
+    }
     return &f->queue_[f->windex_];
 }
 
@@ -126,8 +188,10 @@ void MoveReadIndex(FrameQueue *f) {
         f->rindex_shown_ = 1;
         return;
     }
+    ChargeMemory(MemoryComponent::kFrames, -FrameMemorySize(f->queue_[f->rindex_].frame_));
     av_frame_unref(f->queue_[f->rindex_].frame_);
-    if (++f->rindex_ == f->max_size_) {
+    avsubtitle_free(&f->queue_[f->rindex_].sub_);  // 字幕队列之外的 sub_ 总是空的
+    if (++f->rindex_ == f->capacity_) {
         f->rindex_ = 0;
     }
     --f->size_;
@@ -137,7 +201,8 @@ void MoveReadIndex(FrameQueue *f) {
 // 偏移写索引 windex
 void MoveWriteIndex(FrameQueue *f) {
     std::unique_lock lk{f->mtx_};
-    if (++f->windex_ == f->max_size_) {
+    ChargeMemory(MemoryComponent::kFrames, FrameMemorySize(f->queue_[f->windex_].frame_));
+    if (++f->windex_ == f->capacity_) {
         f->windex_ = 0;
     }
     ++f->size_;
@@ -149,5 +214,38 @@ void MoveWriteIndex(FrameQueue *f) {
 Frame *PeekFrameQueue(FrameQueue *f) {
     // HACK: 读取索引 + 读取索引偏移
     std::unique_lock lk{f->mtx_};
-    return &f->queue_[(f->rindex_ + f->rindex_shown_) % f->max_size_];
+    return &f->queue_[(f->rindex_ + f->rindex_shown_) % f->capacity_];
+}
+
+// 正在显示的一帧(keep_last 保留的那一帧), 还没有显示过任何帧时返回 nullptr
+Frame *PeekLastFrameQueue(FrameQueue *f) {
+    std::unique_lock lk{f->mtx_};
+    return f->rindex_shown_ ? &f->queue_[f->rindex_] : nullptr;
+}
+
+// 还没有显示过的帧数(keep_last 时保留的上一帧不算)
+int NbRemainingFrameQueue(FrameQueue *f) {
+    std::unique_lock lk{f->mtx_};
+    return f->size_ - f->rindex_shown_;
+}
+
+// 唤醒阻塞在 FrameQueue 上的线程(配合 AbortPacketQueue 使用)
+void SignalFrameQueue(FrameQueue *f) {
+    std::unique_lock lk{f->mtx_};
+    f->cv_notfull_.notify_all();
+    f->cv_notempty_.notify_all();
+}
+
+// 生产者已结束: 读完剩余的帧后 PeekReadableFrameQueue 返回 nullptr
+void FinishFrameQueue(FrameQueue *f) {
+    std::unique_lock lk{f->mtx_};
+    f->eof_ = 1;
+    f->cv_notempty_.notify_all();
+}
+
+// 播放中调整队列深度(不超过 capacity_): 变深时唤醒等待的生产者, 变浅时生产者等到帧数降下来再写
+void SetFrameQueueMaxSize(FrameQueue *f, int max_size) {
+    std::unique_lock lk{f->mtx_};
+    f->max_size_ = FFMIN(max_size, f->capacity_);
+    f->cv_notfull_.notify_all();
 }
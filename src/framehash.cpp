@@ -0,0 +1,193 @@
+#include <xxhash.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <player/framehash.hpp>
+#include <player/playlist.hpp>
+#include <player/read_thread.hpp>
+#include <player/segment_decode.hpp>
+#include <player/thread_pool.hpp>
+#include <string>
+#include <vector>
+
+// 攒一批帧(引用, 不拷贝数据), 在线程池上并行计算哈希, 再按原顺序输出
+// NOTE: 哈希不在解码线程上做: 视频由 GOP 并行的解码线程产出, 这里是重排序后的消费者线程
+struct FrameHashBatch {
+    int stream_index_;
+    AVMediaType media_type_;
+    std::vector<AVFrame *> frames_;
+    std::vector<std::string> lines_;
+};
+
+// 视频按行哈希有效像素(不含 linesize 的对齐填充), 音频哈希每个平面的有效样本
+static std::string HashFrame(int stream_index, AVMediaType media_type, AVFrame const *frame) {
+    XXH3_state_t *state{XXH3_createState()};
+    if (!state) {
+        return {};
+    }
+    XXH3_64bits_reset(state);
+    int64_t size{0};
+    if (media_type == AVMEDIA_TYPE_VIDEO) {
+        AVPixFmtDescriptor const *desc{av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame->format))};
+        for (int plane{0}; plane < 4 && frame->data[plane]; ++plane) {
+            int row_bytes{av_image_get_linesize(static_cast<AVPixelFormat>(frame->format), frame->width, plane)};
+            bool chroma{plane == 1 || plane == 2};
+            int height{chroma ? AV_CEIL_RSHIFT(frame->height, desc->log2_chroma_h) : frame->height};
+            if ((desc->flags & AV_PIX_FMT_FLAG_PAL) && plane == 1) {  // 调色板
+                row_bytes = AVPALETTE_SIZE;
+                height = 1;
+            }
+            for (int y{0}; y < height; ++y) {
+                XXH3_64bits_update(state, frame->data[plane] + static_cast<ptrdiff_t>(y) * frame->linesize[plane],
+                                   row_bytes);
+            }
+            size += static_cast<int64_t>(row_bytes) * height;
+        }
+    } else {
+        int nb_channels{frame->ch_layout.nb_channels};
+        bool planar{av_sample_fmt_is_planar(static_cast<AVSampleFormat>(frame->format)) != 0};
+        int plane_bytes{frame->nb_samples * av_get_bytes_per_sample(static_cast<AVSampleFormat>(frame->format)) *
+                        (planar ? 1 : nb_channels)};
+        for (int plane{0}; plane < (planar ? nb_channels : 1); ++plane) {
+            XXH3_64bits_update(state, frame->extended_data[plane], plane_bytes);
+            size += plane_bytes;
+        }
+    }
+    uint64_t hash{XXH3_64bits_digest(state)};
+    XXH3_freeState(state);
+
+    char line[128];
+    snprintf(line, sizeof(line), "%d, %10" PRId64 ", %10" PRId64 ", %8" PRId64 ", %016" PRIx64 "\n", stream_index,
+             frame->best_effort_timestamp, frame->duration, size, hash);
+    return line;
+}
+
+static void FlushFrameHashBatch(FrameHashBatch *batch) {
+    int n{static_cast<int>(batch->frames_.size())};
+    batch->lines_.resize(n);
+    SharedThreadPool().ParallelFor(n, [batch](int i) {
+        batch->lines_[i] = HashFrame(batch->stream_index_, batch->media_type_, batch->frames_[i]);
+    });
+    for (int i{0}; i < n; ++i) {
+        fputs(batch->lines_[i].c_str(), stdout);
+        av_frame_free(&batch->frames_[i]);
+    }
+    batch->frames_.clear();
+}
+
+static int AddFrameHashBatch(FrameHashBatch *batch, AVFrame *frame) {
+    AVFrame *clone{av_frame_clone(frame)};  // 只增加引用计数
+    if (!clone) {
+        return AVERROR(ENOMEM);
+    }
+    batch->frames_.push_back(clone);
+    if (static_cast<int>(batch->frames_.size()) >= kFrameHashBatch) {
+        FlushFrameHashBatch(batch);
+    }
+    return 0;
+}
+
+// 顺序解码音频流(音频解码很便宜, 不分段)
+static int DecodeAudio(std::string const &file_name, PlayerOptions const &options, FrameHashBatch *batch) {
+    int ret{-1};
+    MediaItem item;
+    if (OpenMediaItem(&item, file_name, options) < 0) {
+        return -1;
+    }
+    if (item.video_stream_idx_ >= 0) {
+        item.format_context_->streams[item.video_stream_idx_]->discard = AVDISCARD_ALL;
+    }
+    item.audio_codec_context_ = OpenCodecContext(item.format_context_->streams[item.audio_stream_idx_], options);
+    AVPacket *packet{av_packet_alloc()};
+    AVFrame *frame{av_frame_alloc()};
+    if (item.audio_codec_context_ && packet && frame) {
+        bool eof{false};
+        while (!eof) {
+            if (av_read_frame(item.format_context_, packet) < 0) {
+                eof = true;
+                avcodec_send_packet(item.audio_codec_context_, nullptr);
+            } else if (packet->stream_index == item.audio_stream_idx_) {
+                avcodec_send_packet(item.audio_codec_context_, packet);
+            }
+            av_packet_unref(packet);
+            while ((ret = avcodec_receive_frame(item.audio_codec_context_, frame)) >= 0) {
+                ret = AddFrameHashBatch(batch, frame);
+                av_frame_unref(frame);
+                if (ret < 0) {
+                    eof = true;
+                    break;
+                }
+            }
+        }
+        FlushFrameHashBatch(batch);
+        ret = ret == AVERROR_EOF ? 0 : ret;
+    }
+    av_frame_free(&frame);
+    av_packet_free(&packet);
+    CloseMediaItem(&item);
+    return ret < 0 ? -1 : 0;
+}
+
+// 输出一个文件的头部, 返回选中的视频/音频流下标
+static int PrintFrameHashHeader(std::string const &file_name, PlayerOptions const &options, int *video_stream_idx,
+                                int *audio_stream_idx) {
+    MediaItem item;
+    if (OpenMediaItem(&item, file_name, options) < 0) {
+        return -1;
+    }
+    *video_stream_idx = item.video_stream_idx_;
+    *audio_stream_idx = item.audio_stream_idx_;
+    printf("#file: %s\n#hash: XXH3_64\n", file_name.c_str());
+    for (int idx : {item.video_stream_idx_, item.audio_stream_idx_}) {
+        if (idx < 0) {
+            continue;
+        }
+        AVStream const *stream{item.format_context_->streams[idx]};
+        AVCodecParameters const *codec_params{stream->codecpar};
+        printf("#tb %d: %d/%d\n", idx, stream->time_base.num, stream->time_base.den);
+        printf("#media_type %d: %s\n", idx, av_get_media_type_string(codec_params->codec_type));
+        printf("#codec_id %d: %s\n", idx, avcodec_get_name(codec_params->codec_id));
+        if (codec_params->codec_type == AVMEDIA_TYPE_VIDEO) {
+            printf("#dimensions %d: %dx%d\n", idx, codec_params->width, codec_params->height);
+        } else {
+            printf("#sample_rate %d: %d\n", idx, codec_params->sample_rate);
+            printf("#channels %d: %d\n", idx, codec_params->ch_layout.nb_channels);
+        }
+    }
+    printf("#stream#, pts, duration, size, hash\n");
+    CloseMediaItem(&item);
+    return 0;
+}
+
+int RunFrameHash(PlayerOptions const &options) {
+    int nb_failed{0};
+    for (std::string const &file_name : options.playlist_) {
+        int64_t start_time{av_gettime_relative()};
+        int video_stream_idx{-1};
+        int audio_stream_idx{-1};
+        if (PrintFrameHashHeader(file_name, options, &video_stream_idx, &audio_stream_idx) < 0) {
+            ++nb_failed;
+            continue;
+        }
+
+        // 视频: GOP 并行解码, 按 pts 顺序到这里, 成批并行哈希
+        int ret{0};
+        if (video_stream_idx >= 0) {
+            FrameHashBatch batch{video_stream_idx, AVMEDIA_TYPE_VIDEO, {}, {}};
+            auto consumer = [&batch](AVFrame *frame) { return AddFrameHashBatch(&batch, frame); };
+            ret = SegmentDecode(file_name, options, consumer);
+            FlushFrameHashBatch(&batch);
+        }
+        if (ret >= 0 && audio_stream_idx >= 0) {
+            FrameHashBatch batch{audio_stream_idx, AVMEDIA_TYPE_AUDIO, {}, {}};
+            ret = DecodeAudio(file_name, options, &batch);
+        }
+        fflush(stdout);
+        if (ret < 0) {
+            ++nb_failed;
+        }
+        av_log(nullptr, AV_LOG_INFO, "framehash %s: %s, %.2f s\n", file_name.c_str(), ret < 0 ? "failed" : "done",
+               (av_gettime_relative() - start_time) / 1000000.0);
+    }
+    return nb_failed ? -1 : 0;
+}
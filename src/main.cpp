@@ -1,6 +1,10 @@
 #include <fmt/core.h>
 
+#include <player/framehash.hpp>
+#include <player/raw_output.hpp>
 #include <player/read_thread.hpp>
+#include <player/segment_decode.hpp>
+#include <player/thumbnail.hpp>
 #include <string>
 
 SDL_Window* window = nullptr;
@@ -13,12 +17,27 @@ int main(int argc, char* argv[]) {
     // av_log_set_level(AV_LOG_DEBUG);
     av_log_set_level(AV_LOG_INFO);
 
-    if (argc < 2) {
-        av_log(nullptr, AV_LOG_ERROR, "Usage: %s <file>\n", argv[0]);
+    // 多个文件按顺序无缝播放
+    PlayerOptions options;
+    if (ParseOptions(&options, argc, argv) < 0) {
         return -1;
     }
+    SetMemoryLimit(options.memory_limit_);  // 所有会话共用一份内存记账
 
-    std::string input_file{argv[1]};
+    // 批量缩略图 / 离线分析: 不初始化 SDL, 处理完直接退出
+    if (options.thumbnails_) {
+        return RunThumbnails(options) < 0 ? -1 : 0;
+    }
+    if (options.framehash_) {
+        return RunFrameHash(options) < 0 ? -1 : 0;
+    }
+    if (options.analyze_) {
+        return RunAnalysis(options) < 0 ? -1 : 0;
+    }
+    // 原始输出: 同样不初始化 SDL(只用到它的线程), 解码结果写到文件/管道
+    if (options.raw_output_) {
+        return RunRawOutput(options) < 0 ? -1 : 0;
+    }
 
     int sdl_init_flags = SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_TIMER;
     if (SDL_Init(sdl_init_flags)) {
@@ -36,7 +55,7 @@ int main(int argc, char* argv[]) {
         return -1;
     }
 
-    VideoState* video_state = OpenStream(input_file);
+    VideoState* video_state = OpenStream(options);
 
     if (!video_state) {
         av_log(nullptr, AV_LOG_ERROR, "OpenStream failed\n");
@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <cmath>
+#include <player/const.hpp>
+#include <player/memory_governor.hpp>
+#include <string>
+
+constexpr char const *kMemoryComponentNames[kNbMemoryComponents]{"packets", "frames", "audio"};
+
+MemoryGovernor &GetMemoryGovernor() {
+    static MemoryGovernor governor;
+    return governor;
+}
+
+void SetMemoryLimit(int64_t limit) {
+    GetMemoryGovernor().limit_ = limit;
+}
+
+static void UpdatePeak(std::atomic<int64_t> *peak, int64_t value) {
+    int64_t old{peak->load(std::memory_order_relaxed)};
+    while (value > old && !peak->compare_exchange_weak(old, value, std::memory_order_relaxed)) {
+    }
+}
+
+// 记账: bytes 为正表示占用, 为负表示释放
+void ChargeMemory(MemoryComponent component, int64_t bytes) {
+    MemoryGovernor &governor{GetMemoryGovernor()};
+    int idx{static_cast<int>(component)};
+    int64_t current{governor.current_[idx].fetch_add(bytes, std::memory_order_relaxed) + bytes};
+    int64_t total{governor.total_.fetch_add(bytes, std::memory_order_relaxed) + bytes};
+    UpdatePeak(&governor.peak_[idx], current);
+    UpdatePeak(&governor.total_peak_, total);
+    if (!governor.limit_) {
+        return;
+    }
+    if (total > governor.limit_ && !governor.over_limit_.exchange(true)) {
+        av_log(nullptr, AV_LOG_WARNING,
+               "memory: %.1f MiB over the %.1f MiB limit, shrinking read-ahead and frame queues\n", total / 1048576.0,
+               governor.limit_ / 1048576.0);
+    } else if (total < governor.limit_ * kMemorySoftLimit && governor.over_limit_.exchange(false)) {
+        av_log(nullptr, AV_LOG_INFO, "memory: back to %.1f MiB, read-ahead restored\n", total / 1048576.0);
+    }
+}
+
+// 一个包实际占用的内存: AVPacket 本身、引用的缓冲区(含填充)和附带数据
+// NOTE: 只算 pkt->size 的话, 缓冲区比数据大(解复用器预分配)时会被明显低估
+int64_t PacketMemorySize(AVPacket const *pkt) {
+    int64_t size{static_cast<int64_t>(sizeof(AVPacket))};
+    size += pkt->buf ? static_cast<int64_t>(pkt->buf->size) : pkt->size;
+    for (int i{0}; i < pkt->side_data_elems; ++i) {
+        size += pkt->side_data[i].size;
+    }
+    return size;
+}
+
+// 一帧实际占用的内存: 所有引用的缓冲区(含行对齐的填充)
+int64_t FrameMemorySize(AVFrame const *frame) {
+    int64_t size{0};
+    for (AVBufferRef *buf : frame->buf) {
+        if (buf) {
+            size += buf->size;
+        }
+    }
+    for (int i{0}; i < frame->nb_extended_buf; ++i) {
+        size += frame->extended_buf[i]->size;
+    }
+    return size;
+}
+
+// 占用超过上限的 kMemorySoftLimit 之后, 预读量和帧队列深度随占用线性收缩, 到达上限时收缩到最小值
+static double MemoryScale() {
+    MemoryGovernor &governor{GetMemoryGovernor()};
+    if (!governor.limit_) {
+        return 1.0;
+    }
+    double usage{static_cast<double>(governor.total_.load(std::memory_order_relaxed)) / governor.limit_};
+    return std::clamp((1.0 - usage) / (1.0 - kMemorySoftLimit), 0.0, 1.0);
+}
+
+// 读线程的预读上限(每个 PacketQueue 的字节数), 最少保留 kMemoryMinQueueSize 保证解码不断粮
+int GovernedQueueSize(int max_size) {
+    return std::max(std::min(kMemoryMinQueueSize, max_size), static_cast<int>(max_size * MemoryScale()));
+}
+
+// 帧队列深度, 最少 2(keep_last 保留的一帧加上一帧待显示)
+int GovernedFrameQueueSize(int max_size) {
+    return std::max(std::min(2, max_size), static_cast<int>(std::lround(max_size * MemoryScale())));
+}
+
+void ReportMemoryUsage() {
+    MemoryGovernor &governor{GetMemoryGovernor()};
+    for (int i{0}; i < kNbMemoryComponents; ++i) {
+        av_log(nullptr, AV_LOG_INFO, "memory %-8s: %8.1f MiB current, %8.1f MiB peak\n", kMemoryComponentNames[i],
+               governor.current_[i] / 1048576.0, governor.peak_[i] / 1048576.0);
+    }
+    av_log(nullptr, AV_LOG_INFO, "memory total   : %8.1f MiB current, %8.1f MiB peak, limit %s\n",
+           governor.total_ / 1048576.0, governor.total_peak_ / 1048576.0,
+           governor.limit_ ? (std::to_string(governor.limit_ / 1048576) + " MiB").c_str() : "none");
+}
@@ -0,0 +1,334 @@
+#include <player/ffmpeg.hpp>
+#include <player/options.hpp>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+
+static void PrintUsage(char const* program) {
+    av_log(nullptr, AV_LOG_ERROR,
+           "Usage: %s [options] <file> [file ...]\n"
+           "  --low-latency          live input profile: no buffering, tiny queues, drop late frames\n"
+           "  --target-latency <ms>  latency to hold in low-latency mode (default %d ms)\n"
+           "  --mix <url>            mix the audio of another input into the output (F1-F8: mute, Shift: solo)\n"
+           "  --mix-track <n>        mix the n-th audio track (from 0) of the first input\n"
+           "  --mix-gain <gain>      gain of the last --mix / --mix-track source (default 1.0)\n"
+           "  --thumbnails           headless batch mode: write a keyframe contact sheet per input file\n"
+           "  --thumb-count <n>      thumbnails per file (default %d)\n"
+           "  --thumb-width <px>     width of each thumbnail (default %d)\n"
+           "  --thumb-format <fmt>   contact sheet format: jpg or png (default jpg)\n"
+           "  --output-dir <dir>     where to write contact sheets (default .)\n"
+           "  --analyze              headless offline decode: split files at keyframes and decode GOPs in parallel\n"
+           "  --framehash            write an xxh3 hash of every decoded video/audio frame to stdout\n"
+           "  --raw-video <path>     headless: write decoded video as y4m (raw yuv420p for *.yuv), - for stdout\n"
+           "  --raw-audio <path>     headless: write decoded audio as s16 pcm (wav for *.wav), - for stdout\n"
+           "  --shm <name>           also publish decoded frames to a shared-memory ring at /dev/shm/<name>\n"
+           "  --thread <spec>        tune a thread: read|decode|audio|present[:cpus=0-3,8][:numa=<node>][:nice=<n>]\n"
+           "                         [:fifo=<prio>] (fifo only for audio and present)\n"
+           "  --thread-config <file> read --thread specs from a file, one per line, fields separated by spaces\n"
+           "  --set <key>=<value>    override a pipeline setting: picture_queue_size, frame_queue_capacity,\n"
+           "                         max_queue_size, audio_buffer_size, max_sync_threshold, no_sync_threshold,\n"
+           "                         screen_width, screen_height\n"
+           "  --config <file>        read pipeline settings from a file, one key=value per line\n"
+           "  --auto-tune            measure the first seconds of playback, then size the frame queue and audio\n"
+           "                         buffer for the lowest latency that does not glitch\n"
+           "  --vf <filters>         run decoded video through a libavfilter graph on its own thread, e.g.\n"
+           "                         yadif=deint=interlaced, crop=1920:800, zscale=t=linear,tonemap=hable,...\n"
+           "  --vf-threads <n>       slice threads for the --vf graph (default: one per cpu)\n"
+           "  --no-subs              do not decode or show subtitles (t toggles them during playback)\n"
+           "  --sub-font <file>      font for text subtitles (default: the first CJK/sans font found)\n"
+           "  --capture-dir <dir>    where screenshots (s key) and clips (c key) are written (default .)\n"
+           "  --capture-format <fmt> screenshot format: png or jpg (default png)\n"
+           "  --clip-seconds <n>     keep the last n seconds of packets so c saves them as mp4 without re-encoding\n"
+           "  --memory-limit <MiB>   cap packet/frame/audio buffer memory; read-ahead and frame queues shrink\n"
+           "                         as usage approaches it (press i to print usage)\n",
+           program, static_cast<int>(kDefaultTargetLatency * 1000), kDefaultThumbnailCount, kDefaultThumbnailWidth);
+}
+
+// 设置一项管线参数, 取值不合法时返回 -1
+static int SetPipelineValue(PipelineConfig* config, std::string_view key, std::string const& value) {
+    char* end{nullptr};
+    errno = 0;
+    double number{std::strtod(value.c_str(), &end)};
+    if (value.empty() || *end || errno || !std::isfinite(number)) {
+        return -1;
+    }
+    // 超出 int 范围的值转换成 int 是未定义行为, 先检查范围再转换
+    bool is_int{number >= INT_MIN && number <= INT_MAX && number == std::trunc(number)};
+    int integer{is_int ? static_cast<int>(number) : 0};
+    if (key == "picture_queue_size" && is_int && integer >= 2) {
+        config->picture_queue_size_ = integer;
+    } else if (key == "frame_queue_capacity" && is_int && integer >= 2 && integer <= 256) {
+        config->frame_queue_capacity_ = integer;
+    } else if (key == "max_queue_size" && is_int && integer > 0) {
+        config->max_queue_size_ = integer;
+    } else if (key == "audio_buffer_size" && is_int && integer >= 64 && integer <= 32768 &&
+               !(integer & (integer - 1))) {
+        config->audio_buffer_size_ = integer;
+    } else if (key == "max_sync_threshold" && number > 0) {
+        config->max_sync_threshold_ = number;
+    } else if (key == "no_sync_threshold" && number > 0) {
+        config->no_sync_threshold_ = number;
+    } else if (key == "screen_width" && is_int && integer > 0) {
+        config->screen_width_ = integer;
+    } else if (key == "screen_height" && is_int && integer > 0) {
+        config->screen_height_ = integer;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+static std::string_view TrimSpace(std::string_view s) {
+    size_t first{s.find_first_not_of(" \t\r")};
+    if (first == std::string_view::npos) {
+        return {};
+    }
+    return s.substr(first, s.find_last_not_of(" \t\r") - first + 1);
+}
+
+// 解析 "key=value"(两边可以有空白)
+static int ParsePipelineSetting(PipelineConfig* config, std::string_view setting) {
+    size_t eq{setting.find('=')};
+    std::string_view key{TrimSpace(setting.substr(0, eq))};
+    std::string value{eq == std::string_view::npos ? "" : TrimSpace(setting.substr(eq + 1))};
+    if (SetPipelineValue(config, key, value) < 0) {
+        av_log(nullptr, AV_LOG_ERROR, "invalid pipeline setting: %.*s\n", static_cast<int>(setting.size()),
+               setting.data());
+        return -1;
+    }
+    return 0;
+}
+
+// 读取管线配置文件: 每行一个 key=value, # 之后为注释
+static int LoadPipelineConfig(PipelineConfig* config, std::string const& path) {
+    std::ifstream file{path};
+    if (!file) {
+        av_log(nullptr, AV_LOG_ERROR, "cannot open config %s: %s\n", path.c_str(), strerror(errno));
+        return -1;
+    }
+    std::string line;
+    for (int line_no{1}; std::getline(file, line); ++line_no) {
+        std::string_view setting{line};
+        setting = setting.substr(0, setting.find('#'));
+        if (!TrimSpace(setting).empty() && ParsePipelineSetting(config, setting) < 0) {
+            av_log(nullptr, AV_LOG_ERROR, "%s:%d: bad config line\n", path.c_str(), line_no);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int ParseOptions(PlayerOptions* options, int argc, char* argv[]) {
+    for (int i{1}; i < argc; ++i) {
+        std::string_view arg{argv[i]};
+        if (arg == "--low-latency") {
+            options->low_latency_ = true;
+        } else if (arg == "--target-latency") {
+            if (++i >= argc) {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+            options->target_latency_ = std::atof(argv[i]) / 1000.0;
+            if (options->target_latency_ <= 0) {
+                av_log(nullptr, AV_LOG_ERROR, "invalid --target-latency: %s\n", argv[i]);
+                return -1;
+            }
+        } else if (arg == "--mix" || arg == "--mix-track") {
+            if (++i >= argc) {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+            MixSourceOptions mix_source;
+            if (arg == "--mix") {
+                mix_source.url_ = argv[i];
+            } else {
+                mix_source.track_ = std::atoi(argv[i]);  // url 在解析完后填成第一个输入
+            }
+            options->mix_sources_.push_back(mix_source);
+        } else if (arg == "--mix-gain") {
+            if (++i >= argc || options->mix_sources_.empty()) {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+            options->mix_sources_.back().gain_ = static_cast<float>(std::atof(argv[i]));
+        } else if (arg == "--analyze") {
+            options->analyze_ = true;
+        } else if (arg == "--framehash") {
+            options->framehash_ = true;
+            options->analyze_ = true;
+        } else if (arg == "--raw-video" || arg == "--raw-audio") {
+            if (++i >= argc) {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+            (arg == "--raw-video" ? options->raw_video_path_ : options->raw_audio_path_) = argv[i];
+            options->raw_output_ = true;
+        } else if (arg == "--shm") {
+            if (++i >= argc || !argv[i][0]) {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+            options->shm_name_ = argv[i];
+        } else if (arg == "--set" || arg == "--config") {
+            if (++i >= argc) {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+            // 和 --thread 一样按命令行顺序生效
+            int ret{arg == "--set" ? ParsePipelineSetting(&options->pipeline_, argv[i])
+                                   : LoadPipelineConfig(&options->pipeline_, argv[i])};
+            if (ret < 0) {
+                return -1;
+            }
+        } else if (arg == "--auto-tune") {
+            options->auto_tune_ = true;
+        } else if (arg == "--vf") {
+            if (++i >= argc) {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+            options->video_filters_ = argv[i];
+        } else if (arg == "--vf-threads") {
+            if (++i >= argc || std::atoi(argv[i]) <= 0) {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+            options->filter_threads_ = std::atoi(argv[i]);
+        } else if (arg == "--no-subs") {
+            options->subtitles_ = false;
+        } else if (arg == "--sub-font") {
+            if (++i >= argc) {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+            options->subtitle_font_ = argv[i];
+        } else if (arg == "--capture-dir") {
+            if (++i >= argc) {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+            options->capture_dir_ = argv[i];
+        } else if (arg == "--capture-format") {
+            if (++i >= argc || (std::string_view{argv[i]} != "jpg" && std::string_view{argv[i]} != "png")) {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+            options->capture_format_ = argv[i];
+        } else if (arg == "--clip-seconds") {
+            if (++i >= argc || std::atof(argv[i]) <= 0) {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+            options->clip_seconds_ = std::atof(argv[i]);
+        } else if (arg == "--memory-limit") {
+            if (++i >= argc || std::atoi(argv[i]) <= 0) {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+            options->memory_limit_ = int64_t{std::atoi(argv[i])} * 1024 * 1024;
+        } else if (arg == "--thread" || arg == "--thread-config") {
+            if (++i >= argc) {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+            // 按命令行顺序生效, 后面的设置覆盖前面的
+            int ret{arg == "--thread" ? ParseThreadSpec(&options->thread_policies_, argv[i], ":")
+                                      : LoadThreadConfig(&options->thread_policies_, argv[i])};
+            if (ret < 0) {
+                return -1;
+            }
+        } else if (arg == "--thumbnails") {
+            options->thumbnails_ = true;
+        } else if (arg == "--thumb-count" || arg == "--thumb-width") {
+            if (++i >= argc || std::atoi(argv[i]) <= 0) {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+            (arg == "--thumb-count" ? options->thumbnail_count_ : options->thumbnail_width_) = std::atoi(argv[i]);
+        } else if (arg == "--thumb-format") {
+            if (++i >= argc || (std::string_view{argv[i]} != "jpg" && std::string_view{argv[i]} != "png")) {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+            options->thumbnail_format_ = argv[i];
+        } else if (arg == "--output-dir") {
+            if (++i >= argc) {
+                PrintUsage(argv[0]);
+                return -1;
+            }
+            options->output_dir_ = argv[i];
+        } else if (arg.starts_with("--")) {
+            av_log(nullptr, AV_LOG_ERROR, "unknown option: %s\n", argv[i]);
+            PrintUsage(argv[0]);
+            return -1;
+        } else {
+            options->playlist_.emplace_back(arg);
+        }
+    }
+    if (options->playlist_.empty()) {
+        PrintUsage(argv[0]);
+        return -1;
+    }
+    for (MixSourceOptions& mix_source : options->mix_sources_) {
+        if (mix_source.url_.empty()) {
+            mix_source.url_ = options->playlist_.front();
+        }
+    }
+    if (static_cast<int>(options->mix_sources_.size()) > kMaxMixerSources) {
+        av_log(nullptr, AV_LOG_ERROR, "at most %d --mix sources\n", kMaxMixerSources);
+        return -1;
+    }
+    // 批量缩略图/离线分析处理的是文件, 不需要直播配置
+    if ((options->thumbnails_ || options->analyze_) && options->low_latency_) {
+        av_log(nullptr, AV_LOG_WARNING, "--low-latency is ignored in offline modes\n");
+        options->low_latency_ = false;
+    }
+    if (options->raw_output_) {
+        if (options->raw_video_path_ == "-" && options->raw_audio_path_ == "-") {
+            av_log(nullptr, AV_LOG_ERROR, "--raw-video and --raw-audio cannot both write to stdout\n");
+            return -1;
+        }
+        if (!options->mix_sources_.empty()) {
+            av_log(nullptr, AV_LOG_WARNING, "--mix is ignored with raw output\n");
+            options->mix_sources_.clear();
+        }
+    }
+    // 没有显式设置的管线参数取当前模式的默认值
+    PipelineConfig* pipeline{&options->pipeline_};
+    if (!pipeline->picture_queue_size_) {
+        pipeline->picture_queue_size_ = options->low_latency_ ? kLowLatencyPictureQueueSize : kVideoPictureQueueSize;
+    }
+    if (!pipeline->max_queue_size_) {
+        pipeline->max_queue_size_ = options->low_latency_ ? kLowLatencyMaxQueueSize : kMaxQueueSize;
+    }
+    if (!pipeline->audio_buffer_size_) {
+        pipeline->audio_buffer_size_ = options->low_latency_ ? kLowLatencyAudioBufferSize : kSdlAudioBufferSize;
+    }
+    if (pipeline->picture_queue_size_ > pipeline->frame_queue_capacity_) {
+        av_log(nullptr, AV_LOG_ERROR, "picture_queue_size %d exceeds frame_queue_capacity %d\n",
+               pipeline->picture_queue_size_, pipeline->frame_queue_capacity_);
+        return -1;
+    }
+    if (options->auto_tune_ && (options->thumbnails_ || options->analyze_ || options->raw_output_)) {
+        av_log(nullptr, AV_LOG_WARNING, "--auto-tune only applies to playback, ignoring it\n");
+        options->auto_tune_ = false;
+    }
+    if (!options->video_filters_.empty() && (options->thumbnails_ || options->analyze_)) {
+        av_log(nullptr, AV_LOG_WARNING, "--vf is ignored in offline modes\n");
+        options->video_filters_.clear();
+    }
+    // 字幕只在窗口里显示
+    if (options->thumbnails_ || options->analyze_ || options->raw_output_) {
+        options->subtitles_ = false;
+    }
+    // 直播流没有结尾, 只播放第一个输入
+    if (options->low_latency_ && options->playlist_.size() > 1) {
+        av_log(nullptr, AV_LOG_WARNING, "--low-latency plays a single live input, ignoring the rest\n");
+        options->playlist_.resize(1);
+    }
+    return 0;
+}
@@ -0,0 +1,405 @@
+#include <player/pixel_convert.hpp>
+#include <player/thread_pool.hpp>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PLAYER_X86 1
+#endif
+
+constexpr int kMinSliceHeight = 16;  // 条带太薄时线程调度的开销比转换本身还大
+
+// ================== 标量实现 ==================
+
+// 10 位 -> 8 位(四舍五入, 饱和到 255)
+static void Shift10To8Scalar(uint8_t *dst, uint16_t const *src, int n) {
+    for (int i{0}; i < n; ++i) {
+        dst[i] = static_cast<uint8_t>(FFMIN((src[i] + 2) >> 2, 255));
+    }
+}
+
+// 两行 10 位取平均再转 8 位(4:2:2 -> 4:2:0 的色度)
+static void Average10To8Scalar(uint8_t *dst, uint16_t const *src0, uint16_t const *src1, int n) {
+    for (int i{0}; i < n; ++i) {
+        int avg = (src0[i] + src1[i] + 1) >> 1;
+        dst[i] = static_cast<uint8_t>(FFMIN((avg + 2) >> 2, 255));
+    }
+}
+
+// 两行 8 位取平均(4:2:2 -> 4:2:0 的色度)
+static void Average8Scalar(uint8_t *dst, uint8_t const *src0, uint8_t const *src1, int n) {
+    for (int i{0}; i < n; ++i) {
+        dst[i] = static_cast<uint8_t>((src0[i] + src1[i] + 1) >> 1);
+    }
+}
+
+// P010 亮度: 有效数据在高 10 位, 取高 8 位
+static void P010LumaScalar(uint8_t *dst, uint16_t const *src, int n) {
+    for (int i{0}; i < n; ++i) {
+        dst[i] = static_cast<uint8_t>(FFMIN((src[i] + 0x80) >> 8, 255));
+    }
+}
+
+// P010 色度: UV 交错, 拆成 U/V 两个平面
+static void P010ChromaScalar(uint8_t *dst_u, uint8_t *dst_v, uint16_t const *src, int n) {
+    for (int i{0}; i < n; ++i) {
+        dst_u[i] = static_cast<uint8_t>(FFMIN((src[2 * i] + 0x80) >> 8, 255));
+        dst_v[i] = static_cast<uint8_t>(FFMIN((src[2 * i + 1] + 0x80) >> 8, 255));
+    }
+}
+
+#ifdef PLAYER_X86
+// ================== SSE4 实现 ==================
+
+__attribute__((target("sse4.1"))) static void Shift10To8Sse4(uint8_t *dst, uint16_t const *src, int n) {
+    __m128i const round = _mm_set1_epi16(2);
+    int i{0};
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i + 8));
+        a = _mm_srli_epi16(_mm_adds_epu16(a, round), 2);
+        b = _mm_srli_epi16(_mm_adds_epu16(b, round), 2);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(a, b));
+    }
+    Shift10To8Scalar(dst + i, src + i, n - i);
+}
+
+__attribute__((target("sse4.1"))) static void Average10To8Sse4(uint8_t *dst, uint16_t const *src0,
+                                                               uint16_t const *src1, int n) {
+    __m128i const round = _mm_set1_epi16(2);
+    int i{0};
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_avg_epu16(_mm_loadu_si128(reinterpret_cast<__m128i const *>(src0 + i)),
+                                  _mm_loadu_si128(reinterpret_cast<__m128i const *>(src1 + i)));
+        __m128i b = _mm_avg_epu16(_mm_loadu_si128(reinterpret_cast<__m128i const *>(src0 + i + 8)),
+                                  _mm_loadu_si128(reinterpret_cast<__m128i const *>(src1 + i + 8)));
+        a = _mm_srli_epi16(_mm_adds_epu16(a, round), 2);
+        b = _mm_srli_epi16(_mm_adds_epu16(b, round), 2);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(a, b));
+    }
+    Average10To8Scalar(dst + i, src0 + i, src1 + i, n - i);
+}
+
+__attribute__((target("sse4.1"))) static void Average8Sse4(uint8_t *dst, uint8_t const *src0, uint8_t const *src1,
+                                                           int n) {
+    int i{0};
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src0 + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src1 + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_avg_epu8(a, b));
+    }
+    Average8Scalar(dst + i, src0 + i, src1 + i, n - i);
+}
+
+__attribute__((target("sse4.1"))) static void P010LumaSse4(uint8_t *dst, uint16_t const *src, int n) {
+    __m128i const round = _mm_set1_epi16(0x80);
+    int i{0};
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + i + 8));
+        a = _mm_srli_epi16(_mm_adds_epu16(a, round), 8);
+        b = _mm_srli_epi16(_mm_adds_epu16(b, round), 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(a, b));
+    }
+    P010LumaScalar(dst + i, src + i, n - i);
+}
+
+__attribute__((target("sse4.1"))) static void P010ChromaSse4(uint8_t *dst_u, uint8_t *dst_v, uint16_t const *src,
+                                                             int n) {
+    __m128i const round = _mm_set1_epi16(0x80);
+    // UVUV... -> UUUUUUUU VVVVVVVV
+    __m128i const deinterleave = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+    int i{0};
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + 2 * i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + 2 * i + 8));
+        a = _mm_srli_epi16(_mm_adds_epu16(a, round), 8);
+        b = _mm_srli_epi16(_mm_adds_epu16(b, round), 8);
+        __m128i uv = _mm_shuffle_epi8(_mm_packus_epi16(a, b), deinterleave);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dst_u + i), uv);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dst_v + i), _mm_unpackhi_epi64(uv, uv));
+    }
+    P010ChromaScalar(dst_u + i, dst_v + i, src + 2 * i, n - i);
+}
+
+// ================== AVX2 实现 ==================
+// NOTE: packus 按 128 位通道打包, 结果的 64 位块顺序是 a0 b0 a1 b1, 需要 permute4x64(0xD8) 恢复顺序
+
+__attribute__((target("avx2"))) static void Shift10To8Avx2(uint8_t *dst, uint16_t const *src, int n) {
+    __m256i const round = _mm256_set1_epi16(2);
+    int i{0};
+    for (; i + 32 <= n; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(src + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(src + i + 16));
+        a = _mm256_srli_epi16(_mm256_adds_epu16(a, round), 2);
+        b = _mm256_srli_epi16(_mm256_adds_epu16(b, round), 2);
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), packed);
+    }
+    Shift10To8Sse4(dst + i, src + i, n - i);
+}
+
+__attribute__((target("avx2"))) static void Average10To8Avx2(uint8_t *dst, uint16_t const *src0,
+                                                             uint16_t const *src1, int n) {
+    __m256i const round = _mm256_set1_epi16(2);
+    int i{0};
+    for (; i + 32 <= n; i += 32) {
+        __m256i a = _mm256_avg_epu16(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(src0 + i)),
+                                     _mm256_loadu_si256(reinterpret_cast<__m256i const *>(src1 + i)));
+        __m256i b = _mm256_avg_epu16(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(src0 + i + 16)),
+                                     _mm256_loadu_si256(reinterpret_cast<__m256i const *>(src1 + i + 16)));
+        a = _mm256_srli_epi16(_mm256_adds_epu16(a, round), 2);
+        b = _mm256_srli_epi16(_mm256_adds_epu16(b, round), 2);
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), packed);
+    }
+    Average10To8Sse4(dst + i, src0 + i, src1 + i, n - i);
+}
+
+__attribute__((target("avx2"))) static void Average8Avx2(uint8_t *dst, uint8_t const *src0, uint8_t const *src1,
+                                                         int n) {
+    int i{0};
+    for (; i + 32 <= n; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(src0 + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(src1 + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_avg_epu8(a, b));
+    }
+    Average8Sse4(dst + i, src0 + i, src1 + i, n - i);
+}
+
+__attribute__((target("avx2"))) static void P010LumaAvx2(uint8_t *dst, uint16_t const *src, int n) {
+    __m256i const round = _mm256_set1_epi16(0x80);
+    int i{0};
+    for (; i + 32 <= n; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(src + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(src + i + 16));
+        a = _mm256_srli_epi16(_mm256_adds_epu16(a, round), 8);
+        b = _mm256_srli_epi16(_mm256_adds_epu16(b, round), 8);
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), packed);
+    }
+    P010LumaSse4(dst + i, src + i, n - i);
+}
+
+__attribute__((target("avx2"))) static void P010ChromaAvx2(uint8_t *dst_u, uint8_t *dst_v, uint16_t const *src,
+                                                           int n) {
+    __m256i const round = _mm256_set1_epi16(0x80);
+    __m256i const deinterleave = _mm256_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15,  //
+                                                  0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+    int i{0};
+    for (; i + 16 <= n; i += 16) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(src + 2 * i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(src + 2 * i + 16));
+        a = _mm256_srli_epi16(_mm256_adds_epu16(a, round), 8);
+        b = _mm256_srli_epi16(_mm256_adds_epu16(b, round), 8);
+        // 打包并恢复顺序后每个 128 位通道内是 UVUV..., 通道内拆开得到 U0-7 V0-7 | U8-15 V8-15
+        __m256i uv = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+        uv = _mm256_shuffle_epi8(uv, deinterleave);
+        // 再交换中间两个 64 位块: U0-15 | V0-15
+        uv = _mm256_permute4x64_epi64(uv, 0xD8);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst_u + i), _mm256_castsi256_si128(uv));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst_v + i), _mm256_extracti128_si256(uv, 1));
+    }
+    P010ChromaSse4(dst_u + i, dst_v + i, src + 2 * i, n - i);
+}
+#endif
+
+// ================== 运行时分派 ==================
+
+struct ConvertKernels {
+    void (*shift10_to_8)(uint8_t *, uint16_t const *, int);
+    void (*average10_to_8)(uint8_t *, uint16_t const *, uint16_t const *, int);
+    void (*average8)(uint8_t *, uint8_t const *, uint8_t const *, int);
+    void (*p010_luma)(uint8_t *, uint16_t const *, int);
+    void (*p010_chroma)(uint8_t *, uint8_t *, uint16_t const *, int);
+};
+
+static ConvertKernels const &GetConvertKernels() {
+    static ConvertKernels const kernels = [] {
+#ifdef PLAYER_X86
+        if (__builtin_cpu_supports("avx2")) {
+            return ConvertKernels{Shift10To8Avx2, Average10To8Avx2, Average8Avx2, P010LumaAvx2, P010ChromaAvx2};
+        }
+        if (__builtin_cpu_supports("sse4.1")) {
+            return ConvertKernels{Shift10To8Sse4, Average10To8Sse4, Average8Sse4, P010LumaSse4, P010ChromaSse4};
+        }
+#endif
+        return ConvertKernels{Shift10To8Scalar, Average10To8Scalar, Average8Scalar, P010LumaScalar,
+                              P010ChromaScalar};
+    }();
+    return kernels;
+}
+
+// ================== 条带转换 ==================
+
+template <typename T>
+static T const *Row(AVFrame const *frame, int plane, int y) {
+    return reinterpret_cast<T const *>(frame->data[plane] + static_cast<ptrdiff_t>(y) * frame->linesize[plane]);
+}
+
+static uint8_t *Row(AVFrame *frame, int plane, int y) {
+    return frame->data[plane] + static_cast<ptrdiff_t>(y) * frame->linesize[plane];
+}
+
+// 有 SIMD 快速路径的格式
+static bool HasFastPath(int format) {
+    return format == AV_PIX_FMT_YUV420P10LE || format == AV_PIX_FMT_P010LE || format == AV_PIX_FMT_YUV422P ||
+           format == AV_PIX_FMT_YUVJ422P || format == AV_PIX_FMT_YUV422P10LE;
+}
+
+// 转换 [y0, y1) 行(y0 为偶数), 输出 YUV420P
+static void ConvertSliceFast(AVFrame const *src, AVFrame *dst, int y0, int y1) {
+    ConvertKernels const &k{GetConvertKernels()};
+    int width{src->width};
+    int chroma_width{(src->width + 1) / 2};
+    int chroma_y0{y0 / 2};
+    int chroma_y1{(y1 + 1) / 2};
+
+    switch (src->format) {
+        case AV_PIX_FMT_YUV420P10LE:
+            for (int y{y0}; y < y1; ++y) {
+                k.shift10_to_8(Row(dst, 0, y), Row<uint16_t>(src, 0, y), width);
+            }
+            for (int y{chroma_y0}; y < chroma_y1; ++y) {
+                k.shift10_to_8(Row(dst, 1, y), Row<uint16_t>(src, 1, y), chroma_width);
+                k.shift10_to_8(Row(dst, 2, y), Row<uint16_t>(src, 2, y), chroma_width);
+            }
+            break;
+        case AV_PIX_FMT_P010LE:
+            for (int y{y0}; y < y1; ++y) {
+                k.p010_luma(Row(dst, 0, y), Row<uint16_t>(src, 0, y), width);
+            }
+            for (int y{chroma_y0}; y < chroma_y1; ++y) {
+                k.p010_chroma(Row(dst, 1, y), Row(dst, 2, y), Row<uint16_t>(src, 1, y), chroma_width);
+            }
+            break;
+        case AV_PIX_FMT_YUV422P:
+        case AV_PIX_FMT_YUVJ422P:
+            for (int y{y0}; y < y1; ++y) {
+                memcpy(Row(dst, 0, y), Row<uint8_t>(src, 0, y), width);
+            }
+            // 4:2:2 -> 4:2:0: 相邻两行色度取平均
+            for (int y{chroma_y0}; y < chroma_y1; ++y) {
+                int y_next{FFMIN(2 * y + 1, src->height - 1)};
+                for (int plane{1}; plane <= 2; ++plane) {
+                    k.average8(Row(dst, plane, y), Row<uint8_t>(src, plane, 2 * y), Row<uint8_t>(src, plane, y_next),
+                               chroma_width);
+                }
+            }
+            break;
+        case AV_PIX_FMT_YUV422P10LE:
+            for (int y{y0}; y < y1; ++y) {
+                k.shift10_to_8(Row(dst, 0, y), Row<uint16_t>(src, 0, y), width);
+            }
+            for (int y{chroma_y0}; y < chroma_y1; ++y) {
+                int y_next{FFMIN(2 * y + 1, src->height - 1)};
+                for (int plane{1}; plane <= 2; ++plane) {
+                    k.average10_to_8(Row(dst, plane, y), Row<uint16_t>(src, plane, 2 * y),
+                                     Row<uint16_t>(src, plane, y_next), chroma_width);
+                }
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// 其他格式: 每个条带当作一张独立的小图交给 sws_scale
+static int ConvertSliceSws(PixelConverter *converter, int slice, AVFrame const *src, AVFrame *dst, int y0, int y1) {
+    AVPixFmtDescriptor const *desc{av_pix_fmt_desc_get(static_cast<AVPixelFormat>(src->format))};
+    int height{y1 - y0};
+    SwsContext *&sws_context{converter->sws_contexts_[slice]};
+    sws_context =
+        sws_getCachedContext(sws_context, src->width, height, static_cast<AVPixelFormat>(src->format), src->width,
+                             height, AV_PIX_FMT_YUV420P, SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!sws_context) {
+        return -1;
+    }
+
+    uint8_t const *src_data[4]{};
+    for (int c{0}; c < desc->nb_components; ++c) {
+        int plane{desc->comp[c].plane};
+        int shift{(c == 1 || c == 2) ? desc->log2_chroma_h : 0};  // 只有色度分量会纵向下采样
+        src_data[plane] = src->data[plane] + static_cast<ptrdiff_t>(y0 >> shift) * src->linesize[plane];
+    }
+    uint8_t *dst_data[4]{Row(dst, 0, y0), Row(dst, 1, y0 / 2), Row(dst, 2, y0 / 2), nullptr};
+    int dst_linesize[4]{dst->linesize[0], dst->linesize[1], dst->linesize[2], 0};
+    return sws_scale(sws_context, src_data, src->linesize, 0, height, dst_data, dst_linesize) > 0 ? 0 : -1;
+}
+
+bool NeedPixelConvert(int format) { return format != AV_PIX_FMT_YUV420P && format != AV_PIX_FMT_YUVJ420P; }
+
+int ConvertFrame(PixelConverter *converter, AVFrame const *src, AVFrame *dst) {
+    int ret{-1};
+    AVPixFmtDescriptor const *desc{av_pix_fmt_desc_get(static_cast<AVPixelFormat>(src->format))};
+    if (!desc || (desc->flags & AV_PIX_FMT_FLAG_HWACCEL)) {
+        av_log(nullptr, AV_LOG_ERROR, "unsupported pixel format: %d\n", src->format);
+        return -1;
+    }
+
+    int64_t start_time{av_gettime_relative()};
+
+    dst->format = AV_PIX_FMT_YUV420P;
+    dst->width = src->width;
+    dst->height = src->height;
+    ret = av_frame_get_buffer(dst, 0);
+    if (ret < 0) {
+        return ret;
+    }
+    av_frame_copy_props(dst, src);
+
+    // 条带高度取偶数, 保证色度行和亮度行对齐; 调色板格式的 data[1] 不是图像平面, 不能切
+    ThreadPool &pool{SharedThreadPool()};
+    bool fast{HasFastPath(src->format)};
+    int nb_slices{FFMAX(1, FFMIN(static_cast<int>(pool.Size()) + 1, src->height / kMinSliceHeight))};
+    if (!fast && (desc->flags & AV_PIX_FMT_FLAG_PAL)) {
+        nb_slices = 1;
+    }
+    int slice_height{FFALIGN((src->height + nb_slices - 1) / nb_slices, 2)};
+    nb_slices = (src->height + slice_height - 1) / slice_height;
+
+    if (converter->src_format_ != src->format || static_cast<int>(converter->sws_contexts_.size()) < nb_slices) {
+        FreePixelConverter(converter);
+        converter->sws_contexts_.resize(nb_slices, nullptr);
+        converter->src_format_ = src->format;
+    }
+
+    std::atomic<int> failed{0};
+    pool.ParallelFor(nb_slices, [&](int slice) {
+        int y0{slice * slice_height};
+        int y1{FFMIN(src->height, y0 + slice_height)};
+        if (fast) {
+            ConvertSliceFast(src, dst, y0, y1);
+        } else if (ConvertSliceSws(converter, slice, src, dst, y0, y1) < 0) {
+            ++failed;
+        }
+    });
+    if (failed) {
+        av_log(nullptr, AV_LOG_ERROR, "sws_scale failed: %s\n", desc->name);
+        av_frame_unref(dst);
+        return -1;
+    }
+
+    // 统计每帧转换耗时, 每秒输出一次
+    int64_t now{av_gettime_relative()};
+    int64_t elapsed{now - start_time};
+    ++converter->nb_frames_;
+    converter->total_time_ += elapsed;
+    converter->max_time_ = FFMAX(converter->max_time_, elapsed);
+    av_log(nullptr, AV_LOG_DEBUG, "pixel convert %s -> yuv420p: %.2f ms\n", desc->name, elapsed / 1000.0);
+    if (now - converter->report_time_ >= 1000000) {
+        converter->report_time_ = now;
+        av_log(nullptr, AV_LOG_INFO, "pixel convert %s -> yuv420p (%s, %d slices): avg %.2f ms, max %.2f ms\n",
+               desc->name, fast ? "simd" : "sws", nb_slices, converter->total_time_ / 1000.0 / converter->nb_frames_,
+               converter->max_time_ / 1000.0);
+    }
+    return 0;
+}
+
+void FreePixelConverter(PixelConverter *converter) {
+    for (SwsContext *&sws_context : converter->sws_contexts_) {
+        sws_freeContext(sws_context);
+        sws_context = nullptr;
+    }
+    converter->sws_contexts_.clear();
+    converter->src_format_ = AV_PIX_FMT_NONE;
+}
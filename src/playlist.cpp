@@ -0,0 +1,166 @@
+#include <player/playlist.hpp>
+#include <player/read_thread.hpp>
+
+// 打开解复用器并选出音视频流(不打开解码器)
+// 播放器的输入用这个中断回调(opaque 为 VideoState): 退出时阻塞在网络 IO 上的读取立即返回
+int QuitInterrupt(void *opaque) {
+    return static_cast<VideoState *>(opaque)->quit_.load();
+}
+
+int OpenMediaItem(MediaItem *item, std::string const &file_name, PlayerOptions const &options,
+                  AVIOInterruptCB interrupt_callback) {
+    int ret{-1};
+
+    item->file_name_ = file_name;
+
+    item->format_context_ = avformat_alloc_context();
+    if (!item->format_context_) {
+        return AVERROR(ENOMEM);
+    }
+    item->format_context_->interrupt_callback = interrupt_callback;
+    AVDictionary *format_opts{nullptr};
+    if (options.low_latency_) {
+        // 直播低延迟: 最小探测量, 不分析时长, 解复用器不缓冲
+        item->format_context_->flags |= AVFMT_FLAG_NOBUFFER;
+        av_dict_set(&format_opts, "probesize", "32", 0);
+        av_dict_set(&format_opts, "analyzeduration", "0", 0);
+    }
+    ret = avformat_open_input(&item->format_context_, file_name.c_str(), nullptr, &format_opts);
+    av_dict_free(&format_opts);
+    if (ret < 0) {
+        av_log(nullptr, AV_LOG_ERROR, "avformat_open_input failed: %s\n", file_name.c_str());
+        return -1;
+    }
+
+    ret = avformat_find_stream_info(item->format_context_, nullptr);
+    if (ret < 0) {
+        av_log(nullptr, AV_LOG_ERROR, "avformat_find_stream_info failed: %s\n", file_name.c_str());
+        avformat_close_input(&item->format_context_);
+        return -1;
+    }
+
+    // 查找音频流和视频流(音频优先选和视频相关的)
+    item->video_stream_idx_ = av_find_best_stream(item->format_context_, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    item->audio_stream_idx_ =
+        av_find_best_stream(item->format_context_, AVMEDIA_TYPE_AUDIO, -1, item->video_stream_idx_, nullptr, 0);
+    item->video_stream_idx_ = FFMAX(item->video_stream_idx_, -1);
+    item->audio_stream_idx_ = FFMAX(item->audio_stream_idx_, -1);
+    // 字幕流只在有视频时才有意义
+    item->subtitle_stream_idx_ = -1;
+    if (options.subtitles_ && item->video_stream_idx_ >= 0) {
+        item->subtitle_stream_idx_ =
+            av_find_best_stream(item->format_context_, AVMEDIA_TYPE_SUBTITLE, -1, item->video_stream_idx_, nullptr, 0);
+        item->subtitle_stream_idx_ = FFMAX(item->subtitle_stream_idx_, -1);
+    }
+
+    // 不用的流让解复用器直接跳过, 不再读出来再丢掉
+    for (uint32_t i{0}; i < item->format_context_->nb_streams; ++i) {
+        int idx = static_cast<int>(i);
+        item->format_context_->streams[i]->discard =
+            (idx == item->video_stream_idx_ || idx == item->audio_stream_idx_ || idx == item->subtitle_stream_idx_)
+                ? AVDISCARD_DEFAULT
+                : AVDISCARD_ALL;
+    }
+    return 0;
+}
+
+void CloseMediaItem(MediaItem *item) {
+    for (AVPacket *pkt : item->primed_packets_) {
+        av_packet_free(&pkt);
+    }
+    item->primed_packets_.clear();
+    avcodec_free_context(&item->video_codec_context_);
+    avcodec_free_context(&item->audio_codec_context_);
+    avcodec_free_context(&item->subtitle_codec_context_);
+    avformat_close_input(&item->format_context_);
+    item->video_stream_idx_ = -1;
+    item->audio_stream_idx_ = -1;
+    item->subtitle_stream_idx_ = -1;
+}
+
+// 打开并预热一个条目: 解码器全部打开, 开头的包预先读出, 切换时不需要等 IO
+static int PrimeMediaItem(VideoState *video_state, MediaItem *item, std::string const &file_name) {
+    if (OpenMediaItem(item, file_name, video_state->options_, {QuitInterrupt, video_state}) < 0) {
+        return -1;
+    }
+    // 只保留当前管线在用的流: 没有打开视频/音频的话下一个条目的对应流也忽略
+    if (video_state->video_stream_idx_ < 0 && item->video_stream_idx_ >= 0) {
+        item->format_context_->streams[item->video_stream_idx_]->discard = AVDISCARD_ALL;
+        item->video_stream_idx_ = -1;
+    }
+    if (video_state->audio_stream_idx_ < 0 && item->audio_stream_idx_ >= 0) {
+        item->format_context_->streams[item->audio_stream_idx_]->discard = AVDISCARD_ALL;
+        item->audio_stream_idx_ = -1;
+    }
+    // 当前管线没有字幕线程时不读字幕; 条目之间字幕的有无可以不同, 不算布局不同
+    if (!video_state->subtitle_tid_ && item->subtitle_stream_idx_ >= 0) {
+        item->format_context_->streams[item->subtitle_stream_idx_]->discard = AVDISCARD_ALL;
+        item->subtitle_stream_idx_ = -1;
+    }
+    if ((video_state->video_stream_idx_ >= 0 && item->video_stream_idx_ < 0) ||
+        (video_state->audio_stream_idx_ >= 0 && item->audio_stream_idx_ < 0)) {
+        av_log(nullptr, AV_LOG_WARNING, "%s: stream layout differs from current item, skip\n", file_name.c_str());
+        CloseMediaItem(item);
+        return -1;
+    }
+
+    if (item->video_stream_idx_ >= 0) {
+        item->video_codec_context_ = OpenCodecContext(item->format_context_->streams[item->video_stream_idx_],
+                                                       video_state->options_);
+        if (!item->video_codec_context_) {
+            CloseMediaItem(item);
+            return -1;
+        }
+    }
+    if (item->audio_stream_idx_ >= 0) {
+        item->audio_codec_context_ = OpenCodecContext(item->format_context_->streams[item->audio_stream_idx_],
+                                                       video_state->options_);
+        if (!item->audio_codec_context_) {
+            CloseMediaItem(item);
+            return -1;
+        }
+    }
+
+    if (item->subtitle_stream_idx_ >= 0) {
+        item->subtitle_codec_context_ = OpenCodecContext(item->format_context_->streams[item->subtitle_stream_idx_],
+                                                          video_state->options_);
+        if (!item->subtitle_codec_context_) {
+            // 字幕打不开不影响播放这个条目
+            item->format_context_->streams[item->subtitle_stream_idx_]->discard = AVDISCARD_ALL;
+            item->subtitle_stream_idx_ = -1;
+        }
+    }
+
+    // 预先读出开头的包
+    while (static_cast<int>(item->primed_packets_.size()) < kPlaylistPrimePackets) {
+        AVPacket *pkt{av_packet_alloc()};
+        if (!pkt || av_read_frame(item->format_context_, pkt) < 0) {
+            av_packet_free(&pkt);
+            break;
+        }
+        if (pkt->stream_index != item->video_stream_idx_ && pkt->stream_index != item->audio_stream_idx_ &&
+            pkt->stream_index != item->subtitle_stream_idx_) {
+            av_packet_free(&pkt);
+            continue;
+        }
+        item->primed_packets_.push_back(pkt);
+    }
+    return 0;
+}
+
+// 预加载线程: 从当前条目之后找到第一个能打开的条目, 结果存入 next_item_
+int PreloadThread(void *arg) {
+    VideoState *video_state = static_cast<VideoState *>(arg);
+
+    for (size_t i{video_state->playlist_index_ + 1}; i < video_state->playlist_.size(); ++i) {
+        if (video_state->quit_) {
+            break;
+        }
+        if (PrimeMediaItem(video_state, &video_state->next_item_, video_state->playlist_[i]) == 0) {
+            video_state->next_item_index_ = i;
+            av_log(nullptr, AV_LOG_INFO, "preloaded playlist item %zu: %s\n", i, video_state->playlist_[i].c_str());
+            return 0;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,346 @@
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <csignal>
+#include <cstring>
+#include <player/raw_output.hpp>
+#include <player/read_thread.hpp>
+#include <vector>
+
+static char const kY4mFrameHeader[] = "FRAME\n";  // 静态常量, 可以直接 vmsplice
+
+static bool HasSuffix(std::string const &path, char const *suffix) {
+    size_t n{strlen(suffix)};
+    return path.size() >= n && path.compare(path.size() - n, n, suffix) == 0;
+}
+
+// 按扩展名选择格式: 视频 .yuv 为裸 YUV, 其余(包括 "-")为 Y4M; 音频 .wav 带 WAV 头, 其余为裸 PCM
+int OpenRawSink(RawSink *sink, std::string const &path, AVMediaType type) {
+    sink->path_ = path;
+    if (type == AVMEDIA_TYPE_VIDEO) {
+        sink->format_ = HasSuffix(path, ".yuv") ? RawFormat::kYuv : RawFormat::kY4m;
+    } else {
+        sink->format_ = HasSuffix(path, ".wav") ? RawFormat::kWav : RawFormat::kPcm;
+    }
+    // NOTE: 命名管道会阻塞到对端以读方式打开为止
+    sink->fd_ = path == "-" ? STDOUT_FILENO : open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (sink->fd_ < 0) {
+        av_log(nullptr, AV_LOG_ERROR, "open %s failed: %s\n", path.c_str(), strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    sink->is_pipe_ = type == AVMEDIA_TYPE_VIDEO && fstat(sink->fd_, &st) == 0 && S_ISFIFO(st.st_mode);
+    if (sink->is_pipe_) {
+        // 管道越大, 每次唤醒下游能读走的数据越多; 超过系统上限时保持原来的大小
+        fcntl(sink->fd_, F_SETPIPE_SZ, kRawPipeSize);
+        sink->pipe_size_ = fcntl(sink->fd_, F_GETPIPE_SZ);
+        if (sink->pipe_size_ <= 0) {
+            sink->is_pipe_ = false;
+        }
+    }
+    av_log(nullptr, AV_LOG_INFO, "raw %s output: %s (%s)\n", av_get_media_type_string(type),
+           path == "-" ? "stdout" : path.c_str(),
+           sink->is_pipe_ ? "pipe, vmsplice" : (type == AVMEDIA_TYPE_VIDEO ? "writev" : "write"));
+    return 0;
+}
+
+// 批量写出 iov(可能分多次, 每次最多 IOV_MAX 项), 处理部分写入
+// splice 时页面只是挂进管道, 调用者负责在数据被读走之前保持缓冲区不变
+static int WriteIovecs(RawSink *sink, std::vector<iovec> *iov, bool splice) {
+    size_t index{0};
+    while (index < iov->size()) {
+        int count{static_cast<int>(std::min(iov->size() - index, static_cast<size_t>(IOV_MAX)))};
+        ssize_t n{splice ? vmsplice(sink->fd_, iov->data() + index, count, 0)
+                         : writev(sink->fd_, iov->data() + index, count)};
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (splice && (errno == EINVAL || errno == ENOSYS)) {
+                // 不支持 vmsplice(比如被 seccomp 禁用), 之后都退回 writev
+                av_log(nullptr, AV_LOG_WARNING, "%s: vmsplice unavailable, falling back to writev\n",
+                       sink->path_.c_str());
+                sink->is_pipe_ = false;
+                splice = false;
+                continue;
+            }
+            av_log(nullptr, AV_LOG_ERROR, "write %s failed: %s\n", sink->path_.c_str(), strerror(errno));
+            return -1;
+        }
+        sink->bytes_written_ += n;
+        // 跳过已经写完的项, 最后一项可能只写了一部分
+        size_t done{static_cast<size_t>(n)};
+        while (index < iov->size() && done >= (*iov)[index].iov_len) {
+            done -= (*iov)[index].iov_len;
+            ++index;
+        }
+        if (done > 0) {
+            (*iov)[index].iov_base = static_cast<uint8_t *>((*iov)[index].iov_base) + done;
+            (*iov)[index].iov_len -= done;
+        }
+    }
+    return 0;
+}
+
+static int WriteAll(RawSink *sink, void const *data, size_t size) {
+    std::vector<iovec> iov{{const_cast<void *>(data), size}};
+    return WriteIovecs(sink, &iov, false);
+}
+
+// 管道里最多还有 pipe_size_ 字节没被读走, 之前写出的帧都已经被下游读完, 可以释放
+static void ReleasePinnedFrames(RawSink *sink) {
+    while (!sink->pinned_frames_.empty() &&
+           sink->bytes_written_ - sink->pinned_frames_.front().second >= static_cast<uint64_t>(sink->pipe_size_)) {
+        av_frame_free(&sink->pinned_frames_.front().first);
+        sink->pinned_frames_.pop_front();
+    }
+}
+
+// 一个平面的有效数据: 没有行对齐填充时整个平面是一项, 否则每行一项(跳过填充, 不拷贝)
+static void AppendPlane(std::vector<iovec> *iov, uint8_t *data, int linesize, int row_bytes, int rows) {
+    if (linesize == row_bytes) {
+        iov->push_back({data, static_cast<size_t>(row_bytes) * rows});
+        return;
+    }
+    for (int y{0}; y < rows; ++y) {
+        iov->push_back({data + static_cast<ptrdiff_t>(y) * linesize, static_cast<size_t>(row_bytes)});
+    }
+}
+
+// 写一帧视频(解码线程已经统一转换成 YUV420P)
+int WriteRawVideoFrame(RawSink *sink, AVFrame const *frame, AVRational frame_rate) {
+    if (frame->format != AV_PIX_FMT_YUV420P) {
+        av_log(nullptr, AV_LOG_ERROR, "%s: unexpected pixel format %s\n", sink->path_.c_str(),
+               av_get_pix_fmt_name(static_cast<AVPixelFormat>(frame->format)));
+        return -1;
+    }
+    if (!sink->header_written_) {
+        sink->width_ = frame->width;
+        sink->height_ = frame->height;
+        if (sink->format_ == RawFormat::kY4m) {
+            if (frame_rate.num <= 0 || frame_rate.den <= 0) {
+                frame_rate = av_make_q(25, 1);
+            }
+            AVRational sar{frame->sample_aspect_ratio.num > 0 ? frame->sample_aspect_ratio : av_make_q(0, 0)};
+            char header[128];
+            int len{snprintf(header, sizeof(header), "YUV4MPEG2 W%d H%d F%d:%d Ip A%d:%d C420jpeg\n", frame->width,
+                             frame->height, frame_rate.num, frame_rate.den, sar.num, sar.den)};
+            if (WriteAll(sink, header, len) < 0) {
+                return -1;
+            }
+        }
+        sink->header_written_ = true;
+    }
+    if (frame->width != sink->width_ || frame->height != sink->height_) {
+        if (sink->format_ == RawFormat::kY4m) {
+            av_log(nullptr, AV_LOG_ERROR, "%s: resolution changed to %dx%d, y4m cannot follow\n",
+                   sink->path_.c_str(), frame->width, frame->height);
+            return -1;
+        }
+        av_log(nullptr, AV_LOG_WARNING, "%s: resolution changed %dx%d -> %dx%d\n", sink->path_.c_str(),
+               sink->width_, sink->height_, frame->width, frame->height);
+        sink->width_ = frame->width;
+        sink->height_ = frame->height;
+    }
+
+    std::vector<iovec> iov;
+    iov.reserve(3 + frame->height * 2);
+    if (sink->format_ == RawFormat::kY4m) {
+        iov.push_back({const_cast<char *>(kY4mFrameHeader), sizeof(kY4mFrameHeader) - 1});
+    }
+    int chroma_width{(frame->width + 1) >> 1};
+    int chroma_height{(frame->height + 1) >> 1};
+    AppendPlane(&iov, frame->data[0], frame->linesize[0], frame->width, frame->height);
+    AppendPlane(&iov, frame->data[1], frame->linesize[1], chroma_width, chroma_height);
+    AppendPlane(&iov, frame->data[2], frame->linesize[2], chroma_width, chroma_height);
+
+    // 只有引用计数的帧才能在写出后继续持有缓冲区, 否则只能拷贝进管道
+    bool splice{sink->is_pipe_ && frame->buf[0]};
+    if (WriteIovecs(sink, &iov, splice) < 0) {
+        return -1;
+    }
+    if (splice) {
+        AVFrame *pinned{av_frame_clone(frame)};  // 只增加引用计数
+        if (!pinned) {
+            return AVERROR(ENOMEM);
+        }
+        sink->pinned_frames_.emplace_back(pinned, sink->bytes_written_);
+    }
+    ReleasePinnedFrames(sink);
+    ++sink->nb_frames_;
+    return 0;
+}
+
+static void PutLe16(uint8_t *p, uint16_t v) {
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+static void PutLe32(uint8_t *p, uint32_t v) {
+    PutLe16(p, v & 0xffff);
+    PutLe16(p + 2, v >> 16);
+}
+
+// 流式 WAV 头: 长度未知时写 0xFFFFFFFF(大多数读取端按读到结尾处理), 可 seek 时关闭前再补上
+static void FillWavHeader(uint8_t header[44], int sample_rate, int nb_channels, uint32_t data_size) {
+    int block_align{nb_channels * static_cast<int>(sizeof(int16_t))};
+    memcpy(header, "RIFF", 4);
+    PutLe32(header + 4, data_size == UINT32_MAX ? UINT32_MAX : data_size + 36);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    PutLe32(header + 16, 16);
+    PutLe16(header + 20, 1);  // PCM
+    PutLe16(header + 22, nb_channels);
+    PutLe32(header + 24, sample_rate);
+    PutLe32(header + 28, sample_rate * block_align);
+    PutLe16(header + 32, block_align);
+    PutLe16(header + 34, 16);
+    memcpy(header + 36, "data", 4);
+    PutLe32(header + 40, data_size);
+}
+
+// 写一段 S16 交错 PCM(音频缓冲区会被下一帧复用, 所以这里总是拷贝进内核, 不 vmsplice)
+int WriteRawAudio(RawSink *sink, uint8_t const *data, int size, int sample_rate, int nb_channels) {
+    if (!sink->header_written_) {
+        if (sink->format_ == RawFormat::kWav) {
+            uint8_t header[44];
+            FillWavHeader(header, sample_rate, nb_channels, UINT32_MAX);
+            if (WriteAll(sink, header, sizeof(header)) < 0) {
+                return -1;
+            }
+        }
+        sink->width_ = sample_rate;  // 音频借用这两个字段记录格式, 关闭时补 WAV 头
+        sink->height_ = nb_channels;
+        sink->header_written_ = true;
+    }
+    if (size <= 0) {
+        return 0;
+    }
+    if (WriteAll(sink, data, size) < 0) {
+        return -1;
+    }
+    sink->nb_frames_ += size / (nb_channels * static_cast<int>(sizeof(int16_t)));
+    return 0;
+}
+
+// 输出线程每写出一段数据调用一次, 记录首次输出的时间和已输出数据覆盖的时间范围
+void MarkRawSinkTime(RawSink *sink, double start_pts, double end_pts) {
+    if (!sink->first_write_time_) {
+        sink->first_write_time_ = av_gettime_relative();
+        sink->first_pts_ = start_pts;
+    }
+    sink->end_pts_ = end_pts;
+}
+
+void CloseRawSink(RawSink *sink) {
+    for (std::pair<AVFrame *, uint64_t> &pinned : sink->pinned_frames_) {
+        av_frame_free(&pinned.first);
+    }
+    sink->pinned_frames_.clear();
+    if (sink->fd_ < 0) {
+        return;
+    }
+    // 普通文件: 补上 WAV 头里的长度
+    if (sink->format_ == RawFormat::kWav && sink->header_written_ && lseek(sink->fd_, 0, SEEK_CUR) > 0) {
+        uint64_t data_size{sink->bytes_written_ - 44};
+        uint8_t header[44];
+        FillWavHeader(header, sink->width_, sink->height_,
+                      static_cast<uint32_t>(std::min<uint64_t>(data_size, UINT32_MAX - 36)));
+        if (pwrite(sink->fd_, header, sizeof(header), 0) != sizeof(header)) {
+            av_log(nullptr, AV_LOG_WARNING, "%s: failed to update wav header\n", sink->path_.c_str());
+        }
+    }
+    close(sink->fd_);
+    sink->fd_ = -1;
+}
+
+// 启动一个原始输出线程, 计入 raw_sinks_running_(由读线程在打开流时调用)
+int StartRawOutputThread(VideoState *video_state, RawSink *sink, SDL_ThreadFunction fn, char const *name) {
+    {
+        std::lock_guard lk{video_state->state_mtx_};
+        ++video_state->raw_sinks_running_;
+    }
+    sink->tid_ = SDL_CreateThread(fn, name, video_state);
+    if (!sink->tid_) {
+        av_log(nullptr, AV_LOG_ERROR, "SDL_CreateThread failed\n");
+        FinishRawOutputThread(video_state);
+        return -1;
+    }
+    return 0;
+}
+
+// 原始输出线程结束(写完或出错)时调用
+void FinishRawOutputThread(VideoState *video_state) {
+    {
+        std::lock_guard lk{video_state->state_mtx_};
+        --video_state->raw_sinks_running_;
+    }
+    video_state->state_cv_.notify_all();
+}
+
+// 暂停时原始输出线程睡在这里, 不写也不再拉取数据, 上游随之阻塞在已满的队列上; 返回 false 表示退出
+bool WaitRawOutputResumed(VideoState *video_state) {
+    std::unique_lock lk{video_state->state_mtx_};
+    video_state->state_cv_.wait(lk, [&] { return !video_state->paused_ || video_state->quit_; });
+    return !video_state->quit_;
+}
+
+static void ReportRawSink(RawSink const *sink, char const *unit, int64_t start_time, double elapsed) {
+    if (sink->fd_ < 0) {
+        return;
+    }
+    av_log(nullptr, AV_LOG_INFO, "raw output %s: %lld %s, %.1f MiB, %.1f MiB/s, first output after %.1f ms\n",
+           sink->path_.c_str(), static_cast<long long>(sink->nb_frames_), unit, sink->bytes_written_ / 1048576.0,
+           sink->bytes_written_ / 1048576.0 / FFMAX(elapsed, 1e-6),
+           sink->first_write_time_ ? (sink->first_write_time_ - start_time) / 1000.0 : NAN);
+}
+
+// 两路输出覆盖的媒体时间区间的起点和终点最多差多少(秒), 只输出了一路时返回 NAN
+// NOTE: 这是覆盖范围是否一致(有没有丢掉开头/结尾), 不是播放时的音视频同步: 原始输出不按时钟输出, 没有同步可言
+double RawOutputSpanMismatch(VideoState const *video_state) {
+    RawSink const *video{&video_state->raw_video_sink_};
+    RawSink const *audio{&video_state->raw_audio_sink_};
+    if (!video->first_write_time_ || !audio->first_write_time_) {
+        return NAN;
+    }
+    return std::max(std::abs(video->first_pts_ - audio->first_pts_), std::abs(video->end_pts_ - audio->end_pts_));
+}
+
+// 无窗口的解码服务: 复用播放器的读线程/解码线程, 输出线程代替显示和音频设备
+int RunRawOutput(PlayerOptions const &options) {
+    signal(SIGPIPE, SIG_IGN);  // 下游关闭管道时 write 返回 EPIPE, 而不是直接杀掉进程
+    int64_t start_time{av_gettime_relative()};
+    VideoState *video_state{OpenStream(options)};
+    if (!video_state) {
+        av_log(nullptr, AV_LOG_ERROR, "OpenStream failed\n");
+        return -1;
+    }
+
+    // 等读线程打开音视频流, 再等所有输出线程写完(或者有一路出错而退出)
+    {
+        std::unique_lock lk{video_state->state_mtx_};
+        video_state->state_cv_.wait(lk, [&] {
+            return video_state->quit_ || (video_state->streams_opened_ && video_state->raw_sinks_running_ == 0);
+        });
+    }
+    RequestQuit(video_state);
+    JoinVideoState(video_state);
+
+    double elapsed{(av_gettime_relative() - start_time) / 1000000.0};
+    ReportRawSink(&video_state->raw_video_sink_, "frames", start_time, elapsed);
+    ReportRawSink(&video_state->raw_audio_sink_, "samples", start_time, elapsed);
+    double span_mismatch{RawOutputSpanMismatch(video_state)};
+    if (!std::isnan(span_mismatch)) {
+        av_log(nullptr, AV_LOG_INFO, "raw output a/v span mismatch: %.1f ms\n", span_mismatch * 1000);
+    }
+    ReportMemoryUsage();
+    int ret{video_state->raw_video_sink_.error_ < 0 || video_state->raw_audio_sink_.error_ < 0 ? -1 : 0};
+    CloseRawSink(&video_state->raw_video_sink_);
+    CloseRawSink(&video_state->raw_audio_sink_);
+    return ret;
+}
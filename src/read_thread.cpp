@@ -1,13 +1,24 @@
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <player/read_thread.hpp>
+#include <player/scope_guard.hpp>
 
 int OpenStreamComponent(VideoState* video_state, uint32_t stream_index);
 
-VideoState* OpenStream(std::string const& file_name) {
+VideoState* OpenStream(PlayerOptions const& options) {
     int ret{0};
 
     VideoState* video_state = new VideoState();
 
-    video_state->file_name_ = file_name;
+    video_state->options_ = options;
+    video_state->playlist_ = options.playlist_;
+    video_state->file_name_ = options.playlist_.front();
+    video_state->max_queue_size_ = options.pipeline_.max_queue_size_;
+    video_state->clip_ring_.seconds_ = options.raw_output_ ? 0 : options.clip_seconds_;  // 只有播放时能按键剪辑
 
     // 初始化 Video PacketQueue
     ret = InitPacketQueue(&video_state->video_packet_queue_);
@@ -23,14 +34,56 @@ VideoState* OpenStream(std::string const& file_name) {
         return nullptr;
     }
 
+    // 初始化字幕队列(没有字幕流时一直为空, 显示端照常检查)
+    ret = InitPacketQueue(&video_state->subtitle_packet_queue_);
+    if (ret >= 0) {
+        ret = InitFrameQueue(&video_state->subtitle_frame_queue_, &video_state->subtitle_packet_queue_,
+                             kSubtitleQueueSize, kSubtitleQueueSize, 0);
+    }
+    if (ret < 0) {
+        av_log(nullptr, AV_LOG_ERROR, "Init Subtitle Queue failed\n");
+        return nullptr;
+    }
+
     // 初始化 Video FrameQueue
-    ret =
-        InitFrameQueue(&video_state->video_frame_queue_, &video_state->video_packet_queue_, kVideoPictureQueueSize, 1);
+    ret = InitFrameQueue(&video_state->video_frame_queue_, &video_state->video_packet_queue_,
+                         options.pipeline_.picture_queue_size_, options.pipeline_.frame_queue_capacity_, 1);
     if (ret < 0) {
         av_log(nullptr, AV_LOG_ERROR, "Init Video FrameQueue failed\n");
         return nullptr;
     }
 
+    // 滤镜阶段的输入队列(显示端不从这里取帧, 不需要 keep_last)
+    if (!options.video_filters_.empty()) {
+        ret = InitFrameQueue(&video_state->filter_frame_queue_, &video_state->video_packet_queue_, kFilterQueueSize,
+                             kFilterQueueSize, 0);
+        if (ret < 0) {
+            av_log(nullptr, AV_LOG_ERROR, "Init Filter FrameQueue failed\n");
+            return nullptr;
+        }
+    }
+
+    // 原始输出: 先打开输出(命名管道会阻塞到对端打开为止)
+    if (!options.raw_video_path_.empty() &&
+        OpenRawSink(&video_state->raw_video_sink_, options.raw_video_path_, AVMEDIA_TYPE_VIDEO) < 0) {
+        return nullptr;
+    }
+    if (!options.raw_audio_path_.empty() &&
+        OpenRawSink(&video_state->raw_audio_sink_, options.raw_audio_path_, AVMEDIA_TYPE_AUDIO) < 0) {
+        return nullptr;
+    }
+
+    // 直播模式下读线程可能睡在 poll 上等文件增长, 退出时用它唤醒
+    if (options.low_latency_ && (video_state->quit_fd_ = eventfd(0, EFD_CLOEXEC)) < 0) {
+        av_log(nullptr, AV_LOG_ERROR, "eventfd failed: %s\n", strerror(errno));
+        return nullptr;
+    }
+
+    // 共享内存帧环: 先创建名字, 第一帧到来时再按帧大小映射
+    if (!options.shm_name_.empty() && CreateShmRing(&video_state->shm_ring_, options.shm_name_) < 0) {
+        return nullptr;
+    }
+
     // 开启读线程
     video_state->read_tid_ = SDL_CreateThread(ReadThread, "ReadThread", video_state);
     if (!video_state->read_tid_) {
@@ -38,55 +91,278 @@ VideoState* OpenStream(std::string const& file_name) {
         return nullptr;
     }
 
-    RefreshSchedule(video_state, 40);  // HACK: 注释后没有视频了
+    // 原始输出模式没有窗口, 由输出线程取帧
+    if (!options.raw_output_) {
+        RefreshSchedule(video_state, 40);  // HACK: 注释后没有视频了
+    }
+    if (options.auto_tune_) {
+        StartAutoTune(video_state);
+    }
 
     return video_state;
 }
 
+// 把包放进对应流的队列, 其他流的包直接释放
+static void PutStreamPacket(VideoState* video_state, AVPacket* packet) {
+    if (packet->stream_index == video_state->video_stream_idx_) {
+        RecordClipPacket(&video_state->clip_ring_, video_state->video_stream_, packet);
+        PutPacketQueue(&video_state->video_packet_queue_, packet);  // 保存视频包
+    } else if (packet->stream_index == video_state->audio_stream_idx_) {
+        RecordClipPacket(&video_state->clip_ring_, video_state->audio_stream_, packet);
+        PutPacketQueue(&video_state->audio_packet_queue_, packet);  // 保存音频包
+    } else if (packet->stream_index == video_state->subtitle_stream_idx_) {
+        PutPacketQueue(&video_state->subtitle_packet_queue_, packet);  // 保存字幕包
+    } else {
+        av_packet_unref(packet);  // 既不是音频流, 也不是视频流, 释放包
+    }
+}
+
+// 更新当前条目读到的最大结束时间(秒, 未加偏移)
+static void UpdateItemEndTime(VideoState* video_state, AVPacket* packet, double* item_end_time) {
+    if (packet->pts == AV_NOPTS_VALUE || (packet->stream_index != video_state->video_stream_idx_ &&
+                                          packet->stream_index != video_state->audio_stream_idx_)) {
+        return;
+    }
+    AVRational time_base{video_state->format_context_->streams[packet->stream_index]->time_base};
+    *item_end_time = FFMAX(*item_end_time, (packet->pts + packet->duration) * av_q2d(time_base));
+}
+
+// 当前条目是否已经读到最后 kPlaylistPreloadTime 秒(时长未知时总是返回 true, 尽早预加载)
+static bool NearItemEnd(AVFormatContext* format_context, double item_end_time) {
+    if (format_context->duration == AV_NOPTS_VALUE || format_context->duration <= 0) {
+        return true;
+    }
+    double start_time =
+        format_context->start_time == AV_NOPTS_VALUE ? 0 : format_context->start_time / (double)AV_TIME_BASE;
+    double duration = format_context->duration / (double)AV_TIME_BASE;
+    return item_end_time >= start_time + duration - kPlaylistPreloadTime;
+}
+
+static void StartPreload(VideoState* video_state) {
+    if (video_state->preload_tid_ || video_state->playlist_index_ + 1 >= video_state->playlist_.size()) {
+        return;
+    }
+    video_state->preload_tid_ = SDL_CreateThread(PreloadThread, "PreloadThread", video_state);
+    if (!video_state->preload_tid_) {
+        av_log(nullptr, AV_LOG_ERROR, "SDL_CreateThread failed\n");
+    }
+}
+
+// 当前条目读完后切换到预加载好的下一个条目: 解码器交接 + 空包排空, 音频设备不重开
+// 返回 -1 表示播放列表结束
+static int SwitchToNextItem(VideoState* video_state, double* item_pts_offset, double* item_end_time) {
+    StartPreload(video_state);  // 条目太短的话可能还没开始预加载
+    if (!video_state->preload_tid_) {
+        return -1;
+    }
+    int status{-1};
+    SDL_WaitThread(video_state->preload_tid_, &status);
+    video_state->preload_tid_ = nullptr;
+    if (status < 0) {
+        return -1;
+    }
+
+    MediaItem* next{&video_state->next_item_};
+    AVFormatContext* old_format_context{video_state->format_context_};
+
+    // 下一个条目的时间戳接在当前条目之后
+    int64_t next_start_time{next->format_context_->start_time};
+    double next_pts_offset{*item_pts_offset + *item_end_time -
+                           (next_start_time == AV_NOPTS_VALUE ? 0 : next_start_time / (double)AV_TIME_BASE)};
+
+    // 先交接解码器再放空包: 解码器排空当前条目后按顺序取到对应的交接
+    if (next->video_stream_idx_ >= 0) {
+        AVStream* stream{next->format_context_->streams[next->video_stream_idx_]};
+        video_state->video_handoff_.Push({next->video_codec_context_, stream->avg_frame_rate, next_pts_offset});
+        PutNullPacketQueue(&video_state->video_packet_queue_, video_state->video_stream_idx_, 0);
+        video_state->video_stream_ = stream;
+    }
+    if (next->audio_stream_idx_ >= 0) {
+        AVStream* stream{next->format_context_->streams[next->audio_stream_idx_]};
+        video_state->audio_handoff_.Push({next->audio_codec_context_, stream->avg_frame_rate, next_pts_offset});
+        PutNullPacketQueue(&video_state->audio_packet_queue_, video_state->audio_stream_idx_, 0);
+        video_state->audio_stream_ = stream;
+    }
+    // 字幕线程在运行就总是交接(下一个条目没有字幕时交接空解码器, 旧条目的字幕解码器随之释放)
+    if (video_state->subtitle_tid_) {
+        video_state->subtitle_handoff_.Push({next->subtitle_codec_context_, {0, 1}, next_pts_offset});
+        PutNullPacketQueue(&video_state->subtitle_packet_queue_, video_state->subtitle_stream_idx_, 0);
+        video_state->subtitle_stream_ =
+            next->subtitle_stream_idx_ >= 0 ? next->format_context_->streams[next->subtitle_stream_idx_] : nullptr;
+    }
+    next->video_codec_context_ = nullptr;  // 所有权已交给解码线程
+    next->audio_codec_context_ = nullptr;
+    next->subtitle_codec_context_ = nullptr;
+
+    video_state->format_context_ = next->format_context_;
+    video_state->video_stream_idx_ = next->video_stream_idx_;
+    video_state->audio_stream_idx_ = next->audio_stream_idx_;
+    video_state->subtitle_stream_idx_ = next->subtitle_stream_idx_;
+    video_state->playlist_index_ = video_state->next_item_index_;
+    next->format_context_ = nullptr;
+
+    *item_pts_offset = next_pts_offset;
+    *item_end_time = 0;
+
+    // 预读的包先送入队列
+    for (AVPacket* pkt : next->primed_packets_) {
+        UpdateItemEndTime(video_state, pkt, item_end_time);
+        PutStreamPacket(video_state, pkt);
+        av_packet_free(&pkt);
+    }
+    next->primed_packets_.clear();
+    CloseMediaItem(next);
+
+    avformat_close_input(&old_format_context);
+
+    av_log(nullptr, AV_LOG_INFO, "switch to playlist item %zu: %s (offset %.3f s)\n", video_state->playlist_index_,
+           video_state->playlist_[video_state->playlist_index_].c_str(), next_pts_offset);
+    return 0;
+}
+
+// 切换到第 steps 个同类型的流: 只重开受影响的解码器, 另一路不受影响
+static void CycleTrack(VideoState* video_state, AVMediaType type, int steps, double item_pts_offset) {
+    AVFormatContext* format_context{video_state->format_context_};
+    bool is_video{type == AVMEDIA_TYPE_VIDEO};
+    int current{is_video ? video_state->video_stream_idx_ : video_state->audio_stream_idx_};
+    if (current < 0) {
+        return;
+    }
+
+    int next{current};
+    int nb_streams{static_cast<int>(format_context->nb_streams)};
+    for (int i{1}; i < nb_streams && steps > 0; ++i) {
+        AVStream* stream{format_context->streams[(current + i) % nb_streams]};
+        if (stream->codecpar->codec_type == type && !(stream->disposition & AV_DISPOSITION_ATTACHED_PIC)) {
+            next = stream->index;
+            --steps;
+        }
+    }
+    if (next == current) {
+        av_log(nullptr, AV_LOG_INFO, "no other %s track\n", av_get_media_type_string(type));
+        return;
+    }
+
+    AVStream* stream{format_context->streams[next]};
+    AVCodecContext* codec_context{OpenCodecContext(stream, video_state->options_)};
+    if (!codec_context) {
+        return;
+    }
+
+    // 旧流交给解复用器丢弃, 新流开始读
+    format_context->streams[current]->discard = AVDISCARD_ALL;
+    stream->discard = AVDISCARD_DEFAULT;
+
+    PacketQueue* q{is_video ? &video_state->video_packet_queue_ : &video_state->audio_packet_queue_};
+    MtxQueue<DecoderHandoff>* handoff{is_video ? &video_state->video_handoff_ : &video_state->audio_handoff_};
+
+    // 旧轨的包没用了; 队列里如果还有条目结束的空包, 对应的交接也一起作废
+    FlushPacketQueue(q);
+    while (std::optional<DecoderHandoff> stale = handoff->TryPop()) {
+        avcodec_free_context(&stale->codec_context_);
+    }
+    handoff->Push({codec_context, stream->avg_frame_rate, item_pts_offset});
+    PutNullPacketQueue(q, next, AV_PKT_FLAG_DISCARD);
+
+    if (is_video) {
+        video_state->video_stream_idx_ = next;
+        video_state->video_stream_ = stream;
+    } else {
+        video_state->audio_stream_idx_ = next;
+        video_state->audio_stream_ = stream;
+    }
+    av_log(nullptr, AV_LOG_INFO, "switch %s track: stream %d -> %d\n", av_get_media_type_string(type), current, next);
+}
+
+// 音视频流已经打开(或放弃打开), 原始输出模式据此判断还有哪些输出线程要等
+static void SignalStreamsOpened(VideoState* video_state) {
+    {
+        std::lock_guard lk{video_state->state_mtx_};
+        video_state->streams_opened_ = true;
+    }
+    video_state->state_cv_.notify_all();
+}
+
+// 低延迟模式下读到本地文件的结尾: 用 inotify 睡到文件被写入(或者退出), 不轮询
+// 返回 0 表示可以重新读了; 不是本地文件或 inotify 不可用时返回 -1, 由调用方按 kLiveRetryDelay 重试
+static int WaitFileGrowth(VideoState* video_state, AVFormatContext* format_context) {
+    char const* protocol{avio_find_protocol_name(format_context->url)};
+    if (!format_context->pb || !protocol || strcmp(protocol, "file") != 0) {
+        return -1;
+    }
+    char const* path{format_context->url};
+    if (strncmp(path, "file:", 5) == 0) {
+        path += 5;
+    }
+    int fd{inotify_init1(IN_CLOEXEC)};
+    if (fd < 0) {
+        return -1;
+    }
+    ScopeGuard close_fd{[fd] { close(fd); }};
+    if (inotify_add_watch(fd, path, IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF) < 0) {
+        return -1;
+    }
+    // 读到结尾和开始监视之间可能已经写入了新数据, 这种写入不会再有通知
+    struct stat st {};
+    if (stat(path, &st) == 0 && st.st_size > format_context->pb->pos) {
+        return 0;
+    }
+    pollfd fds[2]{{fd, POLLIN, 0}, {video_state->quit_fd_, POLLIN, 0}};
+    while (poll(fds, 2, -1) < 0 && errno == EINTR) {
+    }
+    ++video_state->wakeup_count_;
+    return 0;
+}
+
 int ReadThread(void* arg) {
     int ret{-1};
 
     VideoState* video_state = static_cast<VideoState*>(arg);
+    ApplyThreadPolicy(ThreadRole::kRead, video_state->options_.thread_policies_);
 
-    AVFormatContext* format_context{nullptr};
-    ret = avformat_open_input(&format_context, video_state->file_name_.c_str(), nullptr, nullptr);
+    MediaItem item;
+    ret = OpenMediaItem(&item, video_state->file_name_, video_state->options_, {QuitInterrupt, video_state});
     if (ret < 0) {
-        av_log(nullptr, AV_LOG_ERROR, "avformat_open_input failed\n");
+        SignalStreamsOpened(video_state);
         return -1;
     }
 
+    AVFormatContext* format_context{item.format_context_};
     video_state->format_context_ = format_context;  // NOTE: 不能close, 否则悬空指针
+    video_state->video_stream_idx_ = item.video_stream_idx_;
+    video_state->audio_stream_idx_ = item.audio_stream_idx_;
+    video_state->subtitle_stream_idx_ = item.subtitle_stream_idx_;
 
-    ret = avformat_find_stream_info(format_context, nullptr);
-    if (ret < 0) {
-        av_log(nullptr, AV_LOG_ERROR, "avformat_find_stream_info failed\n");
-        return -1;
-    }
-
-    // 查找音频流和视频流
-    for (uint32_t i{0}; i < format_context->nb_streams; ++i) {
-        AVStream* stream = format_context->streams[i];
-        AVCodecParameters* codecpar = stream->codecpar;
-        if (codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-            video_state->video_stream_idx_ = i;
-        } else if (codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
-            video_state->audio_stream_idx_ = i;
-        }
-    }
     // 打开视频流
     // 重设视频窗口大小(这样最好, 防止分辨率不对)
-    AVStream* stream{format_context->streams[video_state->video_stream_idx_]};
-    AVCodecParameters* codec_params{stream->codecpar};
-    AVRational sar{av_guess_sample_aspect_ratio(format_context, stream, nullptr)};
-    if (codec_params->width) {
-        // TODO: set default window size
-        SetDefaultWindowSize(codec_params->width, codec_params->height, sar);
+    if (video_state->video_stream_idx_ >= 0) {
+        AVStream* stream{format_context->streams[video_state->video_stream_idx_]};
+        AVCodecParameters* codec_params{stream->codecpar};
+        AVRational sar{av_guess_sample_aspect_ratio(format_context, stream, nullptr)};
+        if (codec_params->width) {
+            // TODO: set default window size
+            SetDefaultWindowSize(codec_params->width, codec_params->height, sar);
+        }
     }
 
     // 视频解码线程
-    OpenStreamComponent(video_state, video_state->video_stream_idx_);
+    if (OpenStreamComponent(video_state, video_state->video_stream_idx_) < 0) {
+        video_state->video_stream_idx_ = -1;  // 没有消费者, 不要往队列里放包
+    }
     // 音频解码线程
-    OpenStreamComponent(video_state, video_state->audio_stream_idx_);
+    if (OpenStreamComponent(video_state, video_state->audio_stream_idx_) < 0) {
+        video_state->audio_stream_idx_ = -1;
+    }
+    // 字幕解码线程(只在视频打开时)
+    bool subtitle_opened{video_state->subtitle_stream_idx_ >= 0 && video_state->video_stream_idx_ >= 0 &&
+                         OpenStreamComponent(video_state, video_state->subtitle_stream_idx_) >= 0};
+    if (!subtitle_opened) {
+        video_state->subtitle_stream_idx_ = -1;
+    }
+    SignalStreamsOpened(video_state);
+
+    double item_pts_offset{0};  // 当前条目的时间戳偏移(秒)
+    double item_end_time{0};    // 当前条目读到的最大结束时间(秒, 未加偏移)
 
     AVPacket* packet{av_packet_alloc()};
 
@@ -96,36 +372,90 @@ int ReadThread(void* arg) {
             return -1;
         }
 
-        // 限制队列大小
-        if (video_state->audio_packet_queue_.size_ > kMaxQueueSize ||
-            video_state->video_packet_queue_.size_ > kMaxQueueSize) {
-            SDL_Delay(10);  // 如果队列满了, 等待 10 ms, 等消费者消费
+        // 暂停: 阻塞直到恢复或退出
+        if (video_state->paused_) {
+            av_read_pause(format_context);  // 网络流通知服务端暂停
+            std::unique_lock lk{video_state->state_mtx_};
+            video_state->state_cv_.wait(lk, [&] { return !video_state->paused_ || video_state->quit_; });
+            lk.unlock();
+            av_read_play(format_context);
+            ++video_state->wakeup_count_;
+            continue;
+        }
+
+        // 用户切换音视频轨
+        if (int steps = video_state->video_track_requests_.exchange(0)) {
+            CycleTrack(video_state, AVMEDIA_TYPE_VIDEO, steps, item_pts_offset);
+        }
+        if (int steps = video_state->audio_track_requests_.exchange(0)) {
+            CycleTrack(video_state, AVMEDIA_TYPE_AUDIO, steps, item_pts_offset);
+        }
+
+        // 限制队列大小(内存紧张时由 GovernedQueueSize 收缩预读量)
+        int queue_limit{GovernedQueueSize(video_state->max_queue_size_)};
+        if (video_state->audio_packet_queue_.size_ > queue_limit) {
+            WaitPacketQueueNotFull(&video_state->audio_packet_queue_, queue_limit);  // 等消费者消费
+            ++video_state->wakeup_count_;
+            continue;
+        }
+        if (video_state->video_packet_queue_.size_ > queue_limit) {
+            WaitPacketQueueNotFull(&video_state->video_packet_queue_, queue_limit);
+            ++video_state->wakeup_count_;
             continue;
         }
 
-        // 读取包
+        // 读取包(网络流没有数据时阻塞在协议层, 退出时由中断回调打断)
         ret = av_read_frame(format_context, packet);
+        if (ret < 0 && video_state->quit_) {
+            continue;  // 被中断回调打断: 回到循环开头退出, 不要切到下一个条目
+        }
+        if (ret < 0 && video_state->options_.low_latency_ && (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) &&
+            !(format_context->pb && format_context->pb->error)) {
+            // 直播流(或还在增长的文件)暂时没有数据: 本地文件等 inotify 通知, 网络流隔一小段时间重试
+            if (format_context->pb) {
+                format_context->pb->eof_reached = 0;
+            }
+            if (WaitFileGrowth(video_state, format_context) < 0) {
+                SDL_Delay(kLiveRetryDelay);
+            }
+            continue;
+        }
         if (ret < 0) {
-            if (format_context->pb->error == 0) {
-                SDL_Delay(100);  // 没有错误, 等待用户输入
-                continue;
-            } else {
+            // 当前条目读完(或出错): 无缝切换到下一个条目, 播放列表结束则不再读取
+            if (SwitchToNextItem(video_state, &item_pts_offset, &item_end_time) < 0) {
                 break;
             }
+            format_context = video_state->format_context_;
+            continue;
         }
 
-        // 保存包至队列
-        if (packet->stream_index == video_state->video_stream_idx_) {
-            PutPacketQueue(&video_state->video_packet_queue_, packet);  // 保存视频包
-        } else if (packet->stream_index == video_state->audio_stream_idx_) {
-            PutPacketQueue(&video_state->audio_packet_queue_, packet);  // 保存音频包
-        } else {
-            av_packet_unref(packet);  // 既不是音频流, 也不是视频流, 释放包
+        // 低延迟模式: 记录包被读到的时间, 由解码器带到帧上, 显示时得到端到端延迟
+        if (video_state->options_.low_latency_) {
+            packet->opaque = reinterpret_cast<void*>(static_cast<intptr_t>(av_gettime_relative()));
         }
+
+        // 当前条目进入最后几秒, 后台预加载下一个条目
+        UpdateItemEndTime(video_state, packet, &item_end_time);
+        if (!video_state->preload_tid_ && NearItemEnd(format_context, item_end_time)) {
+            StartPreload(video_state);
+        }
+
+        // 保存包至队列
+        PutStreamPacket(video_state, packet);
+    }
+
+    // 播放列表结束: 放空包让解码器吐出缓存的最后几帧
+    if (video_state->video_stream_idx_ >= 0) {
+        PutNullPacketQueue(&video_state->video_packet_queue_, video_state->video_stream_idx_, 0);
     }
-    // 等待用户关闭窗口(接收到一个 quit 消息)
-    while (!video_state->quit_) {
-        SDL_Delay(100);
+    if (video_state->audio_stream_idx_ >= 0) {
+        PutNullPacketQueue(&video_state->audio_packet_queue_, video_state->audio_stream_idx_, 0);
+    }
+
+    // 等待用户关闭窗口(接收到一个 quit 消息), 阻塞等待而不是轮询
+    {
+        std::unique_lock lk{video_state->state_mtx_};
+        video_state->state_cv_.wait(lk, [&] { return video_state->quit_.load(); });
     }
 
     // 释放资源
@@ -135,42 +465,80 @@ int ReadThread(void* arg) {
     return 0;
 }
 
-int OpenStreamComponent(VideoState* video_state, uint32_t stream_index) {
+// 查找并打开流的解码器, 失败返回 nullptr
+AVCodecContext* OpenCodecContext(AVStream* stream, PlayerOptions const& options) {
     int ret = -1;
 
-    AVFormatContext* format_context{video_state->format_context_};
-    if (stream_index >= format_context->nb_streams) {
-        av_log(nullptr, AV_LOG_ERROR, "stream_index out of range\n");
-        return -1;
-    }
-    AVStream* stream{format_context->streams[stream_index]};
     AVCodecParameters* codec_params{stream->codecpar};
 
     // 查找 decoder
     AVCodec const* codec{avcodec_find_decoder(codec_params->codec_id)};
     if (!codec) {
         av_log(nullptr, AV_LOG_ERROR, "avcodec_find_decoder failed\n");
-        return -1;
+        return nullptr;
     }
 
     // 创建 codec context
-    AVCodecContext* codec_context{avcodec_alloc_context3(codec)};  // HACK: 不能轻易释放, 否则内存泄漏
+    AVCodecContext* codec_context{avcodec_alloc_context3(codec)};
     if (!codec_context) {
         av_log(nullptr, AV_LOG_ERROR, "avcodec_alloc_context3 failed\n");
-        return -1;
+        return nullptr;
     }
 
     // 拷贝 params -> codec context
     ret = avcodec_parameters_to_context(codec_context, codec_params);
     if (ret < 0) {
         av_log(nullptr, AV_LOG_ERROR, "avcodec_parameters_to_context failed\n");
-        return -1;
+        avcodec_free_context(&codec_context);
+        return nullptr;
+    }
+    // 解码出的帧的 pts 以包的时间基为单位, 解码线程据此换算成秒(不再依赖 AVStream)
+    codec_context->pkt_timebase = stream->time_base;
+    if (options.low_latency_) {
+        // 不做帧重排缓冲; 把包的 opaque(读到的时间)带到帧上
+        codec_context->flags |= AV_CODEC_FLAG_LOW_DELAY | AV_CODEC_FLAG_COPY_OPAQUE;
+    }
+    if (options.thumbnails_ || options.analyze_) {
+        codec_context->thread_count = 1;  // 离线模式按文件/GOP 并行, 解码器内部不再开线程
     }
 
     // 绑定 codec & codec context
-    ret = avcodec_open2(codec_context, codec, nullptr);
+    // NOTE: 解码器的帧/切片线程在 avcodec_open2 里创建, 而这里通常在读线程(或预加载线程)上,
+    // 视频解码器放到按解码线程策略调整过的线程上打开, 让工作线程和解码线程用同一组 CPU/nice/内存节点
+    if (codec_params->codec_type == AVMEDIA_TYPE_VIDEO) {
+        RunWithThreadPolicy(ThreadRole::kDecode, options.thread_policies_,
+                            [&] { ret = avcodec_open2(codec_context, codec, nullptr); });
+    } else {
+        ret = avcodec_open2(codec_context, codec, nullptr);
+    }
     if (ret < 0) {
         av_log(nullptr, AV_LOG_ERROR, "avcodec_open2 failed\n");
+        avcodec_free_context(&codec_context);
+        return nullptr;
+    }
+    return codec_context;
+}
+
+int OpenStreamComponent(VideoState* video_state, uint32_t stream_index) {
+    int ret = -1;
+
+    AVFormatContext* format_context{video_state->format_context_};
+    if (stream_index >= format_context->nb_streams) {
+        av_log(nullptr, AV_LOG_ERROR, "stream_index out of range\n");
+        return -1;
+    }
+    AVStream* stream{format_context->streams[stream_index]};
+
+    // 原始输出模式只解码有输出目标的流, 其余的包直接丢掉
+    bool raw_output{video_state->options_.raw_output_};
+    RawSink* raw_sink{stream->codecpar->codec_type == AVMEDIA_TYPE_AUDIO ? &video_state->raw_audio_sink_
+                                                                          : &video_state->raw_video_sink_};
+    if (raw_output && raw_sink->fd_ < 0) {
+        return -1;
+    }
+
+    AVCodecContext* codec_context{OpenCodecContext(stream, video_state->options_)};  // HACK: 不能轻易释放, 否则内存泄漏
+    if (!codec_context) {
         return -1;
     }
 
@@ -183,8 +551,9 @@ int OpenStreamComponent(VideoState* video_state, uint32_t stream_index) {
             av_log(nullptr, AV_LOG_ERROR, "av_channel_layout_copy failed\n");
             return -1;
         }
-        // 打开扬声器
-        ret = OpenAudio(video_state, &ch_layout, sample_rate);
+        // 打开扬声器(原始输出模式不开设备)
+        ret = raw_output ? OpenRawAudio(video_state, &ch_layout, sample_rate)
+                         : OpenAudio(video_state, &ch_layout, sample_rate);
         if (ret < 0) {
             av_log(nullptr, AV_LOG_ERROR, "OpenAudio failed\n");
             return -1;
@@ -193,6 +562,16 @@ int OpenStreamComponent(VideoState* video_state, uint32_t stream_index) {
         video_state->audio_stream_idx_ = stream_index;
         video_state->audio_codec_context_ = codec_context;
 
+        if (raw_output) {
+            // 由原始输出线程代替音频回调拉取 PCM
+            return StartRawOutputThread(video_state, raw_sink, RawAudioThread, "RawAudioThread");
+        }
+
+        // 其他音频源(--mix)混入同一个设备, 失败不影响主音轨
+        if (StartMixSources(video_state, ret) < 0) {
+            av_log(nullptr, AV_LOG_WARNING, "StartMixSources failed, playing without mix sources\n");
+        }
+
         // 开始播放声音
         SDL_PauseAudio(0);
 
@@ -208,7 +587,32 @@ int OpenStreamComponent(VideoState* video_state, uint32_t stream_index) {
         video_state->frame_last_delay_ = 40e-3;
         video_state->video_current_pts_ = av_gettime();
 
+        // 滤镜线程先启动, 解码线程的帧才有人取
+        if (!video_state->options_.video_filters_.empty()) {
+            video_state->filter_tid_ = SDL_CreateThread(VideoFilterThread, "filter_thread", video_state);
+            if (!video_state->filter_tid_) {
+                av_log(nullptr, AV_LOG_ERROR, "SDL_CreateThread failed\n");
+                return -1;
+            }
+        }
         video_state->decode_tid_ = SDL_CreateThread(DecodeThread, "decode_thread", video_state);
+        if (raw_output) {
+            // 由原始输出线程代替刷新定时器取帧
+            return StartRawOutputThread(video_state, raw_sink, RawVideoThread, "RawVideoThread");
+        }
+    }
+
+    // 线程 3: 字幕
+    else if (codec_context->codec_type == AVMEDIA_TYPE_SUBTITLE) {
+        video_state->subtitle_stream_idx_ = stream_index;
+        video_state->subtitle_stream_ = stream;
+        video_state->subtitle_codec_context_ = codec_context;
+        video_state->subtitle_tid_ = SDL_CreateThread(SubtitleDecodeThread, "subtitle_thread", video_state);
+        if (!video_state->subtitle_tid_) {
+            av_log(nullptr, AV_LOG_ERROR, "SDL_CreateThread failed\n");
+            avcodec_free_context(&video_state->subtitle_codec_context_);
+            return -1;
+        }
     }
 
     // NOTE: 正常退出就不需要释放内存(因为赋值出去了)
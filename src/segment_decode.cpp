@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <atomic>
+#include <latch>
+#include <limits>
+#include <memory>
+#include <player/mtx_queue.hpp>
+#include <player/playlist.hpp>
+#include <player/read_thread.hpp>
+#include <player/scope_guard.hpp>
+#include <player/segment_decode.hpp>
+#include <player/thread_pool.hpp>
+#include <vector>
+
+constexpr int64_t kSegmentOpenStart = std::numeric_limits<int64_t>::min();  // 第一段从文件开头读, 不 seek
+constexpr int64_t kSegmentOpenEnd = std::numeric_limits<int64_t>::max();    // 最后一段读到文件结尾
+
+// 一段: 从关键帧 start_key_ 开始, 到关键帧 end_key_(不含)结束
+// NOTE: 关键帧用包的解码时间戳定位(没有 dts 时用 pts), 和索引里的时间戳一致
+struct Segment {
+    int index_;
+    int64_t start_key_;
+    int64_t end_key_;
+    MtxQueue<AVFrame *> frames_{kSegmentQueueFrames};  // 空指针表示这一段结束
+
+    // 统计(解码线程写, 结束后读)
+    int64_t nb_frames_{0};
+    int64_t decode_time_{0};   // 解码耗时(微秒), 不含等 consumer 的时间
+    int64_t blocked_time_{0};  // 队列满等 consumer 的时间(微秒)
+    int error_{0};
+};
+
+static int64_t PacketKey(AVPacket const *packet) {
+    return packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+}
+
+// 视频流所有关键帧的位置: 优先用解复用器的索引, 没有索引(或只有一个条目)时快速扫一遍包
+static std::vector<int64_t> FindKeyFrames(MediaItem *item) {
+    AVStream *stream{item->format_context_->streams[item->video_stream_idx_]};
+    std::vector<int64_t> keyframes;
+    int nb_entries{avformat_index_get_entries_count(stream)};
+    for (int i{0}; i < nb_entries; ++i) {
+        AVIndexEntry const *entry{avformat_index_get_entry(stream, i)};
+        if (entry && (entry->flags & AVINDEX_KEYFRAME)) {
+            keyframes.push_back(entry->timestamp);
+        }
+    }
+    if (keyframes.size() < 2) {
+        keyframes.clear();
+        AVPacket *packet{av_packet_alloc()};
+        while (packet && av_read_frame(item->format_context_, packet) >= 0) {
+            if (packet->stream_index == item->video_stream_idx_ && (packet->flags & AV_PKT_FLAG_KEY) &&
+                PacketKey(packet) != AV_NOPTS_VALUE) {
+                keyframes.push_back(PacketKey(packet));
+            }
+            av_packet_unref(packet);
+        }
+        av_packet_free(&packet);
+    }
+    std::sort(keyframes.begin(), keyframes.end());
+    keyframes.erase(std::unique(keyframes.begin(), keyframes.end()), keyframes.end());
+    return keyframes;
+}
+
+// 帧交给 consumer 线程(队列满时阻塞), 记录阻塞时间以便从解码耗时中扣除
+static void EmitFrame(Segment *segment, AVFrame *frame) {
+    AVFrame *copy{av_frame_alloc()};
+    if (!copy) {
+        return;
+    }
+    av_frame_move_ref(copy, frame);
+    int64_t start{av_gettime_relative()};
+    segment->frames_.Push(copy);
+    segment->blocked_time_ += av_gettime_relative() - start;
+    ++segment->nb_frames_;
+}
+
+// 解码一段, 只输出显示时间在 [起始关键帧, 结束关键帧) 内的帧
+// 开放 GOP 时结束关键帧之后紧跟的前导帧(pts 更小)依赖本段的参考帧, 所以也由本段解码;
+// 本段开头的前导帧则由上一段负责, 这里丢掉
+static void DecodeSegment(Segment *segment, std::string const &file_name, PlayerOptions const &options,
+                          std::atomic<bool> const &abort) {
+    int64_t start_time{av_gettime_relative()};
+    MediaItem item;
+    AVPacket *packet{av_packet_alloc()};
+    AVFrame *frame{av_frame_alloc()};
+    int64_t start_pts{kSegmentOpenStart};  // 起始关键帧的 pts
+    int64_t end_pts{kSegmentOpenEnd};      // 结束关键帧的 pts(读到后才知道)
+    bool started{segment->start_key_ == kSegmentOpenStart};
+    bool reached_end{false};
+    int64_t last_key{segment->start_key_};  // 最近送入解码器的、有时间戳的包的位置
+    int ret{-1};
+
+    // 任何路径退出都要推入结束标记, 否则 consumer 会一直等这一段
+    ScopeGuard cleanup{[&] {
+        segment->decode_time_ = av_gettime_relative() - start_time - segment->blocked_time_;
+        segment->frames_.Push(nullptr);
+        av_frame_free(&frame);
+        av_packet_free(&packet);
+        CloseMediaItem(&item);
+    }};
+
+    // 没有显示时间的帧不能按 pts 判断, 改按产生它的包的解码时间戳归属(包也没有时间戳时用最近送入的包的位置):
+    // 解码时间戳在 [start_key_, end_key_) 内的包只属于这一段, 开放 GOP 时相邻段多解码的那几个包不会重复输出
+    auto owns_frame = [&] {
+        int64_t pts{frame->best_effort_timestamp};
+        if (pts != AV_NOPTS_VALUE) {
+            return pts >= start_pts && pts < end_pts;
+        }
+        int64_t key{frame->pkt_dts != AV_NOPTS_VALUE ? frame->pkt_dts : last_key};
+        return key >= segment->start_key_ && key < segment->end_key_;
+    };
+    auto receive_frames = [&] {
+        while ((ret = avcodec_receive_frame(item.video_codec_context_, frame)) >= 0) {
+            if (owns_frame()) {
+                EmitFrame(segment, frame);
+            }
+            av_frame_unref(frame);
+        }
+    };
+
+    if (!packet || !frame || OpenMediaItem(&item, file_name, options) < 0 || item.video_stream_idx_ < 0) {
+        segment->error_ = -1;
+        return;
+    }
+    if (item.audio_stream_idx_ >= 0) {
+        item.format_context_->streams[item.audio_stream_idx_]->discard = AVDISCARD_ALL;
+    }
+    item.video_codec_context_ = OpenCodecContext(item.format_context_->streams[item.video_stream_idx_], options);
+    if (!item.video_codec_context_) {
+        segment->error_ = -1;
+        return;
+    }
+    if (!started &&
+        av_seek_frame(item.format_context_, item.video_stream_idx_, segment->start_key_, AVSEEK_FLAG_BACKWARD) < 0) {
+        av_log(nullptr, AV_LOG_ERROR, "segment %d: av_seek_frame failed\n", segment->index_);
+        segment->error_ = -1;
+        return;
+    }
+
+    while (!abort && av_read_frame(item.format_context_, packet) >= 0) {
+        bool key{(packet->flags & AV_PKT_FLAG_KEY) != 0};
+        if (packet->stream_index != item.video_stream_idx_) {
+            av_packet_unref(packet);
+            continue;
+        }
+        // seek 可能落在更早的关键帧上, 跳到本段的起始关键帧
+        if (!started) {
+            if (!key || PacketKey(packet) < segment->start_key_) {
+                av_packet_unref(packet);
+                continue;
+            }
+            started = true;
+            start_pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : kSegmentOpenStart;
+        }
+        if (!reached_end && key && PacketKey(packet) >= segment->end_key_) {
+            reached_end = true;
+            end_pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : PacketKey(packet);
+        } else if (reached_end && (key || packet->pts == AV_NOPTS_VALUE || packet->pts >= end_pts)) {
+            av_packet_unref(packet);
+            break;  // 结束关键帧后的前导帧已经送完
+        }
+        if (PacketKey(packet) != AV_NOPTS_VALUE) {
+            last_key = PacketKey(packet);
+        }
+        ret = avcodec_send_packet(item.video_codec_context_, packet);
+        av_packet_unref(packet);
+        if (ret < 0 && ret != AVERROR(EAGAIN)) {
+            av_log(nullptr, AV_LOG_WARNING, "segment %d: avcodec_send_packet failed\n", segment->index_);
+            continue;
+        }
+        receive_frames();
+    }
+    // 排空解码器
+    avcodec_send_packet(item.video_codec_context_, nullptr);
+    receive_frames();
+}
+
+int SegmentDecode(std::string const &file_name, PlayerOptions const &options, FrameConsumer const &consumer) {
+    int64_t start_time{av_gettime_relative()};
+
+    // 找出关键帧并分段(连续的若干个 GOP 为一段)
+    MediaItem probe;
+    if (OpenMediaItem(&probe, file_name, options) < 0) {
+        return -1;
+    }
+    if (probe.video_stream_idx_ < 0) {
+        av_log(nullptr, AV_LOG_ERROR, "%s: no video stream\n", file_name.c_str());
+        CloseMediaItem(&probe);
+        return -1;
+    }
+    std::vector<int64_t> keyframes{FindKeyFrames(&probe)};
+    CloseMediaItem(&probe);
+
+    // 每次调用用自己的线程池, 不用 SharedThreadPool: 段任务会阻塞在有界的帧队列上等 consumer,
+    // 共用时排在后面的其他任务(像素转换、缩略图等)都要等这些队列被取空, 从线程池里发起的调用更会直接死锁
+    ThreadPool pool;
+    int nb_keyframes{static_cast<int>(keyframes.size())};
+    int nb_segments{std::clamp(static_cast<int>(pool.Size() + 1) * kSegmentsPerWorker, 1, FFMAX(nb_keyframes, 1))};
+    std::vector<std::unique_ptr<Segment>> segments;
+    for (int i{0}; i < nb_segments; ++i) {
+        auto segment = std::make_unique<Segment>();
+        segment->index_ = i;
+        // 第 i 段从第 i * nb_keyframes / nb_segments 个关键帧开始
+        auto first_keyframe = [&](int segment_index) {
+            return keyframes[static_cast<int64_t>(segment_index) * nb_keyframes / nb_segments];
+        };
+        segment->start_key_ = i == 0 ? kSegmentOpenStart : first_keyframe(i);
+        segment->end_key_ = i == nb_segments - 1 ? kSegmentOpenEnd : first_keyframe(i + 1);
+        segments.push_back(std::move(segment));
+    }
+    av_log(nullptr, AV_LOG_INFO, "%s: %d keyframes, %d segments, %zu workers\n", file_name.c_str(), nb_keyframes,
+           nb_segments, pool.Size());
+
+    // 按顺序提交: 线程池先进先出且只有这些段, 保证当前要消费的段总是已经在解码, 不会因为队列满而死锁
+    std::atomic<bool> abort{false};
+    std::latch done{nb_segments};
+    for (std::unique_ptr<Segment> &segment : segments) {
+        pool.Submit([&, segment = segment.get()] {
+            DecodeSegment(segment, file_name, options, abort);
+            done.count_down();
+        });
+    }
+
+    // 重排序: 依次消费每一段, 段内的帧本来就是显示顺序
+    int ret{0};
+    int64_t nb_frames{0};
+    for (std::unique_ptr<Segment> &segment : segments) {
+        while (AVFrame *frame = segment->frames_.Pop()) {
+            if (ret >= 0 && consumer && consumer(frame) < 0) {
+                ret = -1;
+                abort = true;  // 之后的帧只取出释放, 让解码线程尽快退出
+            }
+            av_frame_free(&frame);
+            ++nb_frames;
+        }
+        if (segment->error_ < 0) {
+            ret = -1;
+            abort = true;
+        }
+    }
+    done.wait();
+
+    // 吞吐报告
+    int64_t total_decode_time{0};
+    for (std::unique_ptr<Segment> &segment : segments) {
+        total_decode_time += segment->decode_time_;
+        av_log(nullptr, AV_LOG_INFO, "  segment %3d: %6lld frames, %8.1f ms, %7.1f fps%s\n", segment->index_,
+               static_cast<long long>(segment->nb_frames_), segment->decode_time_ / 1000.0,
+               segment->nb_frames_ * 1000000.0 / FFMAX(segment->decode_time_, 1),
+               segment->error_ < 0 ? " (failed)" : "");
+    }
+    double elapsed{(av_gettime_relative() - start_time) / 1000000.0};
+    av_log(nullptr, AV_LOG_INFO, "%s: %lld frames in %.2f s, %.1f fps, parallel speedup %.2fx\n", file_name.c_str(),
+           static_cast<long long>(nb_frames), elapsed, nb_frames / FFMAX(elapsed, 1e-6),
+           total_decode_time / 1000000.0 / FFMAX(elapsed, 1e-6));
+    return ret;
+}
+
+int RunAnalysis(PlayerOptions const &options) {
+    int nb_failed{0};
+    for (std::string const &file_name : options.playlist_) {
+        if (SegmentDecode(file_name, options, nullptr) < 0) {
+            ++nb_failed;
+        }
+    }
+    return nb_failed ? -1 : 0;
+}
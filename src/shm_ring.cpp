@@ -0,0 +1,147 @@
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <player/const.hpp>
+#include <player/shm_ring.hpp>
+
+constexpr size_t kShmSlotDataOffset = 256;  // 槽内图像数据的起始偏移(槽头之后, 对齐到缓存行)
+constexpr int kShmPlaneAlign = 64;          // 每个平面的行对齐, 方便消费者直接用 SIMD 处理
+constexpr size_t kShmPageSize = 4096;
+
+static_assert(sizeof(ShmSlotHeader) <= kShmSlotDataOffset);
+
+static ShmRingHeader *RingHeader(ShmRing const *ring) {
+    return reinterpret_cast<ShmRingHeader *>(ring->base_);
+}
+
+// 创建(或截断残留的)共享内存对象, 大小等第一帧到来时再定
+int CreateShmRing(ShmRing *ring, std::string const &name) {
+    ring->name_ = name.starts_with("/") ? name : "/" + name;
+    ring->fd_ = shm_open(ring->name_.c_str(), O_CREAT | O_RDWR | O_TRUNC | O_CLOEXEC, 0644);
+    if (ring->fd_ < 0) {
+        av_log(nullptr, AV_LOG_ERROR, "shm_open %s failed: %s\n", ring->name_.c_str(), strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+// 按第一帧的大小确定槽的大小并映射, 头部字段全部写好后才写 magic_
+static int MapShmRing(ShmRing *ring, AVFrame const *frame) {
+    int data_size{av_image_get_buffer_size(static_cast<AVPixelFormat>(frame->format), frame->width, frame->height,
+                                           kShmPlaneAlign)};
+    if (data_size < 0) {
+        av_log(nullptr, AV_LOG_ERROR, "%s: unsupported frame format\n", ring->name_.c_str());
+        return -1;
+    }
+    size_t slot_size{FFALIGN(kShmSlotDataOffset + data_size, kShmPageSize)};
+    size_t size{kShmRingHeaderSize + slot_size * kShmRingSlots};
+    if (ftruncate(ring->fd_, static_cast<off_t>(size)) < 0) {
+        av_log(nullptr, AV_LOG_ERROR, "ftruncate %s failed: %s\n", ring->name_.c_str(), strerror(errno));
+        return -1;
+    }
+    void *base{mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd_, 0)};
+    if (base == MAP_FAILED) {
+        av_log(nullptr, AV_LOG_ERROR, "mmap %s failed: %s\n", ring->name_.c_str(), strerror(errno));
+        return -1;
+    }
+    ring->base_ = static_cast<uint8_t *>(base);
+    ring->size_ = size;
+    ring->slot_data_size_ = slot_size - kShmSlotDataOffset;
+
+    // ftruncate 出来的内容全是 0, 槽头不需要再初始化
+    ShmRingHeader *header{RingHeader(ring)};
+    header->version_ = kShmRingVersion;
+    header->nb_slots_ = kShmRingSlots;
+    header->slot_size_ = slot_size;
+    header->magic_.store(kShmRingMagic, std::memory_order_release);
+    av_log(nullptr, AV_LOG_INFO, "shm ring /dev/shm%s: %d slots x %zu KiB\n", ring->name_.c_str(), kShmRingSlots,
+           slot_size / 1024);
+    return 0;
+}
+
+// 把一帧拷进下一个槽并唤醒等待的消费者, 从不等待消费者(没开 --shm 时直接返回)
+int PublishShmFrame(ShmRing *ring, AVFrame const *frame, double pts) {
+    if (ring->fd_ < 0) {
+        return 0;
+    }
+    if (!ring->base_ && MapShmRing(ring, frame) < 0) {
+        close(ring->fd_);  // 之后不再尝试
+        ring->fd_ = -1;
+        return -1;
+    }
+    AVPixelFormat format{static_cast<AVPixelFormat>(frame->format)};
+    int data_size{av_image_get_buffer_size(format, frame->width, frame->height, kShmPlaneAlign)};
+    if (data_size < 0 || static_cast<size_t>(data_size) > ring->slot_data_size_) {
+        if (!ring->nb_skipped_++) {
+            av_log(nullptr, AV_LOG_WARNING, "%s: %dx%d frames do not fit the ring, not published\n",
+                   ring->name_.c_str(), frame->width, frame->height);
+        }
+        return 0;
+    }
+
+    ShmRingHeader *header{RingHeader(ring)};
+    uint64_t seq{header->write_seq_.load(std::memory_order_relaxed)};
+    uint8_t *slot_base{ring->base_ + kShmRingHeaderSize + (seq % kShmRingSlots) * header->slot_size_};
+    ShmSlotHeader *slot{reinterpret_cast<ShmSlotHeader *>(slot_base)};
+
+    // seqlock 写: 先置为奇数, 消费者看到奇数或者前后不一致就知道这一槽正在被覆盖
+    uint64_t lock{slot->lock_.load(std::memory_order_relaxed)};
+    slot->lock_.store(lock + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint8_t *dst_data[4]{};
+    int dst_linesize[4]{};
+    av_image_fill_arrays(dst_data, dst_linesize, slot_base + kShmSlotDataOffset, format, frame->width, frame->height,
+                         kShmPlaneAlign);
+    av_image_copy(dst_data, dst_linesize, const_cast<uint8_t const **>(frame->data), frame->linesize, format,
+                  frame->width, frame->height);
+    slot->seq_ = seq;
+    slot->pts_ = std::isnan(pts) ? AV_NOPTS_VALUE : static_cast<int64_t>(pts * 1000000);
+    slot->format_ = format;
+    slot->width_ = frame->width;
+    slot->height_ = frame->height;
+    slot->sar_num_ = frame->sample_aspect_ratio.num;
+    slot->sar_den_ = frame->sample_aspect_ratio.den;
+    for (int i{0}; i < 4; ++i) {
+        slot->linesize_[i] = dst_linesize[i];
+        slot->offset_[i] = dst_data[i] ? static_cast<uint64_t>(dst_data[i] - slot_base) : 0;
+    }
+    slot->data_size_ = data_size;
+
+    slot->lock_.store(lock + 2, std::memory_order_release);
+    header->write_seq_.store(seq + 1, std::memory_order_release);
+
+    // 跨进程的 futex 不能用 FUTEX_PRIVATE_FLAG; 没有等待者时内核直接返回
+    header->futex_.fetch_add(1, std::memory_order_release);
+    syscall(SYS_futex, &header->futex_, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    ++ring->nb_published_;
+    return 0;
+}
+
+// 删除 /dev/shm 中的名字(退出时调用), 已经映射的进程不受影响
+void UnlinkShmRing(ShmRing *ring) {
+    if (!ring->name_.empty()) {
+        shm_unlink(ring->name_.c_str());
+    }
+}
+
+// 解除映射(JoinVideoState 在所有调用 QueuePicture 的线程结束后调用, 之后不会再发布)
+void DestroyShmRing(ShmRing *ring) {
+    if (ring->base_) {
+        av_log(nullptr, AV_LOG_INFO, "shm ring %s: %lld frames published, %lld skipped\n", ring->name_.c_str(),
+               static_cast<long long>(ring->nb_published_), static_cast<long long>(ring->nb_skipped_));
+        munmap(ring->base_, ring->size_);
+        ring->base_ = nullptr;
+    }
+    if (ring->fd_ >= 0) {
+        close(ring->fd_);
+        ring->fd_ = -1;
+    }
+}
@@ -0,0 +1,520 @@
+#include <cmath>
+#include <cstring>
+#include <player/subtitle.hpp>
+#include <player/video_thread.hpp>
+
+extern SDL_Renderer *renderer;
+
+// ================== Decode ==================
+
+// 字幕解码线程: subtitle_packet_queue_ -> 解码 -> subtitle_frame_queue_, 显示端按视频的 pts 取走
+int SubtitleDecodeThread(void *arg) {
+    VideoState *video_state{static_cast<VideoState *>(arg)};
+    ApplyThreadPolicy(ThreadRole::kDecode, video_state->options_.thread_policies_);
+    AVPacket *packet{av_packet_alloc()};
+    double pts_offset{0};  // 播放列表中当前条目的时间戳偏移(秒)
+
+    while (packet && !video_state->quit_) {
+        if (GetPacketQueue(&video_state->subtitle_packet_queue_, packet, 1) < 0) {
+            break;
+        }
+        ++video_state->wakeup_count_;
+
+        // 空包表示条目结束: 换成读线程交接过来的解码器(下一个条目没有字幕时为空, 之后也不会再有字幕包)
+        if (IsDrainPacket(packet) || IsFlushPacket(packet)) {
+            av_packet_unref(packet);
+            if (std::optional<DecoderHandoff> handoff = video_state->subtitle_handoff_.TryPop()) {
+                avcodec_free_context(&video_state->subtitle_codec_context_);
+                video_state->subtitle_codec_context_ = handoff->codec_context_;
+                pts_offset = handoff->pts_offset_;
+            }
+            continue;
+        }
+        AVCodecContext *codec_context{video_state->subtitle_codec_context_};
+        if (!codec_context) {
+            av_packet_unref(packet);
+            continue;
+        }
+
+        AVSubtitle sub;
+        int got_subtitle{0};
+        int ret{avcodec_decode_subtitle2(codec_context, &sub, &got_subtitle, packet)};
+        av_packet_unref(packet);
+        if (ret < 0) {
+            av_log(nullptr, AV_LOG_WARNING, "avcodec_decode_subtitle2 failed\n");  // 跳过这一条, 不影响播放
+            continue;
+        }
+        if (!got_subtitle) {
+            continue;
+        }
+        if (sub.pts == AV_NOPTS_VALUE) {
+            avsubtitle_free(&sub);  // 没有时间戳的字幕无法和视频对齐
+            continue;
+        }
+
+        Frame *sp{PeekWritableFrameQueue(&video_state->subtitle_frame_queue_)};
+        if (!sp) {
+            avsubtitle_free(&sub);
+            break;
+        }
+        sp->pts_ = sub.pts / static_cast<double>(AV_TIME_BASE) + pts_offset;  // sub.pts 的时间基为 AV_TIME_BASE_Q
+        sp->width_ = codec_context->width;
+        sp->height_ = codec_context->height;
+        sp->sub_ = sub;
+        MoveWriteIndex(&video_state->subtitle_frame_queue_);
+    }
+    av_packet_free(&packet);
+    return 0;
+}
+
+// ================== Active Set ==================
+
+static bool IsBitmapSubtitle(AVSubtitle const *sub) {
+    return sub->num_rects > 0 && sub->rects[0]->type == SUBTITLE_BITMAP;
+}
+
+template <typename Pred>
+static void RemoveActiveSubtitles(SubtitleOverlay *overlay, Pred pred) {
+    for (auto it = overlay->active_.begin(); it != overlay->active_.end();) {
+        if (pred(*it)) {
+            avsubtitle_free(&it->sub_);
+            it = overlay->active_.erase(it);
+            overlay->dirty_ = true;
+        } else {
+            ++it;
+        }
+    }
+}
+
+// 按正在显示的帧的 pts 取走已经开始的字幕, 去掉已经结束或被替换的字幕; 集合有变化时置 dirty_
+static void UpdateActiveSubtitles(VideoState *video_state, Frame const *vp) {
+    SubtitleOverlay *overlay{&video_state->subtitle_overlay_};
+    FrameQueue *f{&video_state->subtitle_frame_queue_};
+    double pts{vp->pts_};
+    if (std::isnan(pts)) {
+        return;
+    }
+    while (NbRemainingFrameQueue(f) > 0) {
+        Frame *sp{PeekFrameQueue(f)};
+        AVSubtitle *sub{&sp->sub_};
+        double start{sp->pts_ + sub->start_display_time / 1000.0};
+        if (start > pts) {
+            break;
+        }
+        // 图形字幕(PGS/DVB)每条都是新的一屏(没有矩形的一条表示清屏); 没有结束时间的字幕都由下一条替换
+        bool replaces_bitmaps{IsBitmapSubtitle(sub) || !sub->num_rects};
+        RemoveActiveSubtitles(overlay, [&](ActiveSubtitle const &s) {
+            return std::isinf(s.end_) || (replaces_bitmaps && IsBitmapSubtitle(&s.sub_));
+        });
+        if (sub->num_rects) {
+            ActiveSubtitle active;
+            active.sub_ = *sub;
+            active.start_ = start;
+            active.end_ = sub->end_display_time && sub->end_display_time != UINT32_MAX
+                              ? sp->pts_ + sub->end_display_time / 1000.0
+                              : INFINITY;
+            active.id_ = ++overlay->next_id_;
+            active.canvas_width_ = sp->width_ > 0 ? sp->width_ : vp->width_;
+            active.canvas_height_ = sp->height_ > 0 ? sp->height_ : vp->height_;
+            overlay->active_.push_back(active);
+            memset(sub, 0, sizeof(*sub));  // 所有权已经转移, MoveReadIndex 不再释放
+            overlay->dirty_ = true;
+        }
+        MoveReadIndex(f);
+    }
+    RemoveActiveSubtitles(overlay, [&](ActiveSubtitle const &s) { return s.end_ <= pts; });
+}
+
+// ================== Atlas ==================
+
+static bool CreateAtlasTexture(SubtitleAtlas *atlas) {
+    if (atlas->texture_) {
+        return true;
+    }
+    atlas->texture_ = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC,
+                                        kSubtitleAtlasSize, kSubtitleAtlasSize);
+    if (!atlas->texture_) {
+        av_log(nullptr, AV_LOG_ERROR, "SDL_CreateTexture failed: %s\n", SDL_GetError());
+        return false;
+    }
+    SDL_SetTextureBlendMode(atlas->texture_, SDL_BLENDMODE_BLEND);
+    return true;
+}
+
+// 清空图集(纹理保留, 旧内容之后被覆盖)
+static void ResetAtlas(SubtitleAtlas *atlas) {
+    atlas->shelf_x_ = 0;
+    atlas->shelf_y_ = 0;
+    atlas->shelf_height_ = 0;
+    atlas->glyphs_.clear();
+    atlas->bitmaps_.clear();
+    ++atlas->nb_resets_;
+}
+
+// 在图集中分配 width x height 并上传 ARGB8888 像素, 四周留 1 像素透明边(缩放采样时不会混入相邻的内容)
+// 图集满了返回 false
+static bool InsertAtlas(SubtitleAtlas *atlas, uint8_t const *pixels, int pitch, int width, int height,
+                        SDL_Rect *rect) {
+    int padded_width{width + 2};
+    int padded_height{height + 2};
+    if (atlas->shelf_x_ + padded_width > kSubtitleAtlasSize) {
+        atlas->shelf_x_ = 0;  // 换到下一行
+        atlas->shelf_y_ += atlas->shelf_height_;
+        atlas->shelf_height_ = 0;
+    }
+    if (padded_width > kSubtitleAtlasSize || atlas->shelf_y_ + padded_height > kSubtitleAtlasSize) {
+        return false;
+    }
+    std::vector<uint32_t> buffer(static_cast<size_t>(padded_width) * padded_height, 0);
+    for (int y{0}; y < height; ++y) {
+        memcpy(&buffer[static_cast<size_t>(y + 1) * padded_width + 1], pixels + static_cast<ptrdiff_t>(y) * pitch,
+               width * sizeof(uint32_t));
+    }
+    SDL_Rect padded{atlas->shelf_x_, atlas->shelf_y_, padded_width, padded_height};
+    SDL_UpdateTexture(atlas->texture_, &padded, buffer.data(), padded_width * sizeof(uint32_t));
+    *rect = {padded.x + 1, padded.y + 1, width, height};
+    atlas->shelf_x_ += padded_width;
+    atlas->shelf_height_ = FFMAX(atlas->shelf_height_, padded_height);
+    ++atlas->nb_uploads_;
+    return true;
+}
+
+// 光栅化一个字形(填充和描边)放进图集, 已经缓存时直接返回; 图集满了返回 nullptr
+static SubtitleGlyph const *GetGlyph(SubtitleOverlay *overlay, uint32_t codepoint) {
+    SubtitleAtlas *atlas{&overlay->atlas_};
+    if (auto it = atlas->glyphs_.find(codepoint); it != atlas->glyphs_.end()) {
+        return &it->second;
+    }
+    SubtitleGlyph glyph;
+    TTF_GlyphMetrics32(overlay->font_, codepoint, nullptr, nullptr, nullptr, nullptr, &glyph.advance_);
+
+    TTF_Font *fonts[]{overlay->font_, overlay->outline_font_};
+    SDL_Rect *rects[]{&glyph.fill_, &glyph.outline_};
+    for (int i{0}; i < 2; ++i) {
+        SDL_Surface *surface{TTF_RenderGlyph32_Blended(fonts[i], codepoint, SDL_Color{255, 255, 255, 255})};
+        if (!surface) {
+            continue;  // 空白字符没有像素
+        }
+        SDL_Surface *argb{surface->format->format == SDL_PIXELFORMAT_ARGB8888
+                              ? surface
+                              : SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0)};
+        bool inserted{!argb || InsertAtlas(atlas, static_cast<uint8_t const *>(argb->pixels), argb->pitch, argb->w,
+                                           argb->h, rects[i])};
+        if (argb != surface) {
+            SDL_FreeSurface(argb);
+        }
+        SDL_FreeSurface(surface);
+        if (!inserted) {
+            return nullptr;
+        }
+    }
+    return &atlas->glyphs_.emplace(codepoint, glyph).first->second;
+}
+
+// 图形字幕的一个矩形(PAL8)转成 ARGB 放进图集, 同一条字幕只转换上传一次
+static SDL_Rect const *GetBitmap(SubtitleAtlas *atlas, ActiveSubtitle const *active, unsigned index) {
+    uint64_t key{static_cast<uint64_t>(active->id_) << 16 | index};
+    if (auto it = atlas->bitmaps_.find(key); it != atlas->bitmaps_.end()) {
+        return &it->second;
+    }
+    AVSubtitleRect const *r{active->sub_.rects[index]};
+    uint32_t const *palette{reinterpret_cast<uint32_t const *>(r->data[1])};  // AV_PIX_FMT_PAL8 的调色板即 ARGB
+    std::vector<uint32_t> argb(static_cast<size_t>(r->w) * r->h);
+    for (int y{0}; y < r->h; ++y) {
+        uint8_t const *src{r->data[0] + static_cast<ptrdiff_t>(y) * r->linesize[0]};
+        for (int x{0}; x < r->w; ++x) {
+            argb[static_cast<size_t>(y) * r->w + x] = palette[src[x]];
+        }
+    }
+    SDL_Rect rect;
+    if (!InsertAtlas(atlas, reinterpret_cast<uint8_t const *>(argb.data()), r->w * sizeof(uint32_t), r->w, r->h,
+                     &rect)) {
+        return nullptr;
+    }
+    return &atlas->bitmaps_.emplace(key, rect).first->second;
+}
+
+// ================== Layout ==================
+
+static void CloseSubtitleFont(SubtitleOverlay *overlay) {
+    TTF_CloseFont(overlay->font_);
+    TTF_CloseFont(overlay->outline_font_);
+    overlay->font_ = nullptr;
+    overlay->outline_font_ = nullptr;
+}
+
+static bool OpenSubtitleFontFile(SubtitleOverlay *overlay, char const *path, int size) {
+    overlay->font_ = TTF_OpenFont(path, size);
+    overlay->outline_font_ = overlay->font_ ? TTF_OpenFont(path, size) : nullptr;
+    if (!overlay->outline_font_) {
+        CloseSubtitleFont(overlay);
+        return false;
+    }
+    overlay->outline_size_ = FFMAX(1, static_cast<int>(std::lrint(size * kSubtitleOutlineScale)));
+    TTF_SetFontOutline(overlay->outline_font_, overlay->outline_size_);
+    overlay->font_path_ = path;
+    return true;
+}
+
+// 按字号打开字体: 字号随显示区域变化, 变了就重开字体并清空图集(缓存的字形是旧字号的)
+static bool OpenSubtitleFont(VideoState *video_state, int size) {
+    SubtitleOverlay *overlay{&video_state->subtitle_overlay_};
+    if (overlay->font_ && overlay->font_size_ == size) {
+        return true;
+    }
+    if (overlay->font_failed_) {
+        return false;
+    }
+    if (!TTF_WasInit() && TTF_Init() < 0) {
+        av_log(nullptr, AV_LOG_ERROR, "TTF_Init failed: %s\n", TTF_GetError());
+        overlay->font_failed_ = true;
+        return false;
+    }
+    CloseSubtitleFont(overlay);
+    if (!overlay->atlas_.glyphs_.empty()) {
+        ResetAtlas(&overlay->atlas_);
+    }
+    overlay->font_size_ = size;
+
+    bool opened{false};
+    if (!overlay->font_path_.empty()) {
+        opened = OpenSubtitleFontFile(overlay, std::string{overlay->font_path_}.c_str(), size);
+    } else if (!video_state->options_.subtitle_font_.empty()) {
+        opened = OpenSubtitleFontFile(overlay, video_state->options_.subtitle_font_.c_str(), size);
+    } else {
+        for (char const *path : kDefaultSubtitleFonts) {
+            if ((opened = OpenSubtitleFontFile(overlay, path, size))) {
+                break;
+            }
+        }
+    }
+    if (!opened) {
+        av_log(nullptr, AV_LOG_WARNING, "cannot open a subtitle font (use --sub-font), text subtitles are hidden\n");
+        overlay->font_failed_ = true;
+        return false;
+    }
+    av_log(nullptr, AV_LOG_VERBOSE, "subtitle font %s, %d px\n", overlay->font_path_.c_str(), size);
+    return true;
+}
+
+// 取出一个 UTF-8 字符, 非法的字节当作 U+FFFD
+static uint32_t NextCodepoint(std::string const &s, size_t *i) {
+    uint8_t c{static_cast<uint8_t>(s[(*i)++])};
+    if ((c >= 0x80 && c < 0xC0) || c >= 0xF8) {
+        return 0xFFFD;
+    }
+    int extra{c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0};
+    uint32_t codepoint{extra ? c & (0x3Fu >> extra) : c};
+    for (; extra > 0; --extra) {
+        if (*i >= s.size() || (static_cast<uint8_t>(s[*i]) & 0xC0) != 0x80) {
+            return 0xFFFD;
+        }
+        codepoint = codepoint << 6 | (static_cast<uint8_t>(s[(*i)++]) & 0x3F);
+    }
+    return codepoint;
+}
+
+// 字幕矩形的纯文本: ASS 去掉对白前面的字段和 {} 中的样式标签, \N 换行, \h 为空格
+static std::string SubtitleRectText(AVSubtitleRect const *r) {
+    char const *p{r->type == SUBTITLE_ASS ? r->ass : r->type == SUBTITLE_TEXT ? r->text : nullptr};
+    if (!p) {
+        return {};
+    }
+    if (r->type == SUBTITLE_ASS) {
+        // ReadOrder,Layer,Style,Name,MarginL,MarginR,MarginV,Effect,Text(旧版本为 "Dialogue: " 加上 Start,End)
+        int fields{strncmp(p, "Dialogue:", 9) ? 8 : 9};
+        for (int i{0}; i < fields && p; ++i) {
+            p = strchr(p, ',');
+            p = p ? p + 1 : nullptr;
+        }
+        if (!p) {
+            return {};
+        }
+    }
+    std::string text;
+    bool in_tag{false};
+    for (; *p; ++p) {
+        if (in_tag) {
+            in_tag = *p != '}';
+        } else if (r->type == SUBTITLE_ASS && *p == '{') {
+            in_tag = true;
+        } else if (r->type == SUBTITLE_ASS && *p == '\\' && (p[1] == 'N' || p[1] == 'n' || p[1] == 'h')) {
+            text += p[1] == 'h' ? ' ' : '\n';
+            ++p;
+        } else if (*p != '\r') {
+            text += *p;
+        }
+    }
+    return text;
+}
+
+struct TextLine {
+    std::vector<SubtitleGlyph const *> glyphs_;
+    int width_{0};
+};
+
+// 一条文字字幕排成若干行, 超过 max_width 时在最后一个空格处换行(没有空格的中日韩文字在这个字之前换行)
+// 图集满了返回 false
+static bool BreakTextLines(SubtitleOverlay *overlay, std::string const &text, int max_width,
+                           std::vector<TextLine>* lines) {
+    lines->emplace_back();
+    int space{-1};  // 当前行最后一个空格的位置
+    for (size_t i{0}; i < text.size();) {
+        uint32_t codepoint{NextCodepoint(text, &i)};
+        if (codepoint == '\n') {
+            lines->emplace_back();
+            space = -1;
+            continue;
+        }
+        SubtitleGlyph const *glyph{GetGlyph(overlay, codepoint)};
+        if (!glyph) {
+            return false;
+        }
+        TextLine *line{&lines->back()};
+        if (codepoint != ' ' && !line->glyphs_.empty() && line->width_ + glyph->advance_ > max_width) {
+            TextLine next;
+            size_t split{space > 0 ? static_cast<size_t>(space) : line->glyphs_.size()};
+            for (size_t j{split}; j < line->glyphs_.size(); ++j) {
+                line->width_ -= line->glyphs_[j]->advance_;
+                if (j > split) {  // 断行处的空格丢掉
+                    next.glyphs_.push_back(line->glyphs_[j]);
+                    next.width_ += line->glyphs_[j]->advance_;
+                }
+            }
+            line->glyphs_.resize(split);
+            lines->push_back(std::move(next));
+            line = &lines->back();
+            space = -1;
+        }
+        if (codepoint == ' ') {
+            space = static_cast<int>(line->glyphs_.size());
+        }
+        line->glyphs_.push_back(glyph);
+        line->width_ += glyph->advance_;
+    }
+    return true;
+}
+
+// 按当前激活的字幕重新生成 quads_, 新出现的字形和位图在这里上传到图集; 图集满了返回 false
+// 文字字幕从视频底部往上堆叠(先开始的在下面), 图形字幕按画布坐标缩放到显示区域
+static bool LayoutSubtitles(VideoState *video_state, SDL_Rect const *rect) {
+    SubtitleOverlay *overlay{&video_state->subtitle_overlay_};
+    SubtitleAtlas *atlas{&overlay->atlas_};
+    overlay->quads_.clear();
+
+    SDL_Color const white{255, 255, 255, 255};
+    SDL_Color const black{0, 0, 0, 255};
+    int bottom{rect->y + rect->h - static_cast<int>(rect->h * kSubtitleMargin)};
+    // 字体在放进任何内容之前打开: 字号变了会清空图集
+    bool has_text{false};
+    for (ActiveSubtitle const &active : overlay->active_) {
+        for (unsigned i{0}; i < active.sub_.num_rects; ++i) {
+            has_text |= active.sub_.rects[i]->type != SUBTITLE_BITMAP;
+        }
+    }
+    bool has_font{has_text && OpenSubtitleFont(video_state, FFMAX(kSubtitleMinFontSize,
+                                                                  static_cast<int>(rect->h * kSubtitleFontScale)))};
+    std::vector<SubtitleQuad> fills;  // 描边全部画完再画填充, 相邻字形的描边不会盖住填充
+
+    for (ActiveSubtitle const &active : overlay->active_) {
+        AVSubtitle const *sub{&active.sub_};
+        for (unsigned i{0}; i < sub->num_rects; ++i) {
+            AVSubtitleRect const *r{sub->rects[i]};
+            if (r->type == SUBTITLE_BITMAP) {
+                if (r->w <= 0 || r->h <= 0 || active.canvas_width_ <= 0 || active.canvas_height_ <= 0) {
+                    continue;
+                }
+                SDL_Rect const *src{GetBitmap(atlas, &active, i)};
+                if (!src) {
+                    return false;
+                }
+                SDL_Rect dst{rect->x + static_cast<int>(int64_t{r->x} * rect->w / active.canvas_width_),
+                             rect->y + static_cast<int>(int64_t{r->y} * rect->h / active.canvas_height_),
+                             static_cast<int>(int64_t{r->w} * rect->w / active.canvas_width_),
+                             static_cast<int>(int64_t{r->h} * rect->h / active.canvas_height_)};
+                overlay->quads_.push_back({*src, dst, white});
+                continue;
+            }
+            if (!has_font) {
+                continue;
+            }
+            std::vector<TextLine> lines;
+            if (!BreakTextLines(overlay, SubtitleRectText(r), static_cast<int>(rect->w * kSubtitleMaxWidth),
+                                &lines)) {
+                return false;
+            }
+            int line_skip{TTF_FontLineSkip(overlay->font_)};
+            int y{bottom - line_skip * static_cast<int>(lines.size())};
+            bottom = y;
+            for (TextLine const &line : lines) {
+                int x{rect->x + (rect->w - line.width_) / 2};
+                for (SubtitleGlyph const *glyph : line.glyphs_) {
+                    if (glyph->outline_.w > 0) {
+                        SDL_Rect dst{x - overlay->outline_size_, y - overlay->outline_size_, glyph->outline_.w,
+                                     glyph->outline_.h};
+                        overlay->quads_.push_back({glyph->outline_, dst, black});
+                    }
+                    if (glyph->fill_.w > 0) {
+                        fills.push_back({glyph->fill_, {x, y, glyph->fill_.w, glyph->fill_.h}, white});
+                    }
+                    x += glyph->advance_;
+                }
+                y += line_skip;
+            }
+        }
+    }
+    overlay->quads_.insert(overlay->quads_.end(), fills.begin(), fills.end());
+    return true;
+}
+
+// 显示端调用: 更新激活的字幕, 集合或显示区域变了才重新排版, 然后把缓存的 quads_ 画到视频上
+void DrawSubtitles(VideoState *video_state, Frame const *vp, SDL_Rect const *rect) {
+    SubtitleOverlay *overlay{&video_state->subtitle_overlay_};
+    UpdateActiveSubtitles(video_state, vp);
+    if (!overlay->visible_ || overlay->active_.empty() || !CreateAtlasTexture(&overlay->atlas_)) {
+        return;
+    }
+    if (overlay->dirty_ || !SDL_RectEquals(rect, &overlay->layout_rect_)) {
+        // 图集满了: 清空后只放当前要显示的内容再排一次
+        if (!LayoutSubtitles(video_state, rect)) {
+            ResetAtlas(&overlay->atlas_);
+            if (!LayoutSubtitles(video_state, rect)) {
+                av_log(nullptr, AV_LOG_WARNING, "subtitles do not fit in the %dx%d atlas\n", kSubtitleAtlasSize,
+                       kSubtitleAtlasSize);
+            }
+        }
+        overlay->layout_rect_ = *rect;
+        overlay->dirty_ = false;
+    }
+
+    SDL_Texture *texture{overlay->atlas_.texture_};
+    for (SubtitleQuad const &quad : overlay->quads_) {
+        SDL_SetTextureColorMod(texture, quad.color_.r, quad.color_.g, quad.color_.b);
+        SDL_RenderCopy(renderer, texture, &quad.src_, &quad.dst_);
+    }
+}
+
+void ToggleSubtitles(VideoState *video_state) {
+    SubtitleOverlay *overlay{&video_state->subtitle_overlay_};
+    overlay->visible_ = !overlay->visible_;
+    av_log(nullptr, AV_LOG_INFO, "subtitles %s\n", overlay->visible_ ? "on" : "off");
+}
+
+// 释放激活的字幕、字体和图集纹理(主线程, 在 SDL_Quit 之前)
+void DestroySubtitleOverlay(SubtitleOverlay *overlay) {
+    RemoveActiveSubtitles(overlay, [](ActiveSubtitle const&) { return true; });
+    overlay->quads_.clear();
+    if (overlay->atlas_.nb_uploads_) {
+        av_log(nullptr, AV_LOG_VERBOSE, "subtitle atlas: %lld uploads, %lld resets\n",
+               (long long)overlay->atlas_.nb_uploads_, (long long)overlay->atlas_.nb_resets_);
+    }
+    ResetAtlas(&overlay->atlas_);
+    if (overlay->atlas_.texture_) {
+        SDL_DestroyTexture(overlay->atlas_.texture_);
+        overlay->atlas_.texture_ = nullptr;
+    }
+    CloseSubtitleFont(overlay);
+    if (TTF_WasInit()) {
+        TTF_Quit();
+    }
+}
@@ -0,0 +1,245 @@
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <player/ffmpeg.hpp>
+#include <player/thread_tuning.hpp>
+
+constexpr char const *kThreadRoleNames[kNbThreadRoles]{"read", "decode", "audio", "present"};
+
+static bool ParseInt(std::string_view text, int *value) {
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), *value);
+    return ec == std::errc{} && end == text.data() + text.size();
+}
+
+// 解析 "0-3,8,10-11" 格式的 CPU 列表(和 /sys 中 cpulist 的格式相同)
+static int ParseCpuList(std::string_view list, std::vector<int> *cpus) {
+    cpus->clear();
+    while (!list.empty()) {
+        size_t comma{list.find(',')};
+        std::string_view range{list.substr(0, comma)};
+        list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+        size_t dash{range.find('-')};
+        int first{0};
+        int last{0};
+        if (!ParseInt(range.substr(0, dash), &first) ||
+            (dash != std::string_view::npos && !ParseInt(range.substr(dash + 1), &last))) {
+            return -1;
+        }
+        if (dash == std::string_view::npos) {
+            last = first;
+        }
+        if (first < 0 || last < first || last >= CPU_SETSIZE) {
+            return -1;
+        }
+        for (int cpu{first}; cpu <= last; ++cpu) {
+            cpus->push_back(cpu);
+        }
+    }
+    std::sort(cpus->begin(), cpus->end());
+    cpus->erase(std::unique(cpus->begin(), cpus->end()), cpus->end());
+    return 0;
+}
+
+static std::string FormatCpuList(std::vector<int> const &cpus) {
+    std::string list;
+    for (size_t i{0}; i < cpus.size();) {
+        size_t j{i};
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+            ++j;
+        }
+        list += (list.empty() ? "" : ",") + std::to_string(cpus[i]);
+        if (j > i) {
+            list += "-" + std::to_string(cpus[j]);
+        }
+        i = j + 1;
+    }
+    return list;
+}
+
+// 解析一条策略: 角色名后跟若干 key=value, 之间用 separators 中的任意字符分隔
+// 例如命令行的 "audio:cpus=2-3:fifo=20", 配置文件中的 "decode numa=1 nice=-5"
+int ParseThreadSpec(ThreadPolicies *policies, std::string_view spec, std::string_view separators) {
+    std::vector<std::string_view> tokens;
+    for (size_t pos{0}; pos < spec.size();) {
+        size_t end{std::min(spec.find_first_of(separators, pos), spec.size())};
+        if (end > pos) {
+            tokens.push_back(spec.substr(pos, end - pos));
+        }
+        pos = end + 1;
+    }
+    if (tokens.empty()) {
+        return 0;
+    }
+    auto role_it = std::find(std::begin(kThreadRoleNames), std::end(kThreadRoleNames), tokens[0]);
+    if (role_it == std::end(kThreadRoleNames)) {
+        av_log(nullptr, AV_LOG_ERROR, "unknown thread role: %.*s (read, decode, audio or present)\n",
+               static_cast<int>(tokens[0].size()), tokens[0].data());
+        return -1;
+    }
+    ThreadRole role{static_cast<ThreadRole>(role_it - std::begin(kThreadRoleNames))};
+    ThreadPolicy *policy{&(*policies)[static_cast<int>(role)]};
+    for (size_t i{1}; i < tokens.size(); ++i) {
+        std::string_view token{tokens[i]};
+        size_t eq{token.find('=')};
+        std::string_view key{token.substr(0, eq)};
+        std::string_view value{eq == std::string_view::npos ? std::string_view{} : token.substr(eq + 1)};
+        int number{0};
+        bool ok{false};
+        if (key == "cpus") {
+            ok = ParseCpuList(value, &policy->cpus_) == 0 && !policy->cpus_.empty();
+        } else if (key == "numa") {
+            ok = ParseInt(value, &number) && number >= 0 && number < static_cast<int>(sizeof(unsigned long) * 8);
+            policy->numa_node_ = number;
+        } else if (key == "nice") {
+            ok = ParseInt(value, &number) && number >= -20 && number <= 19;
+            policy->nice_ = number;
+        } else if (key == "fifo") {
+            // 实时调度只给延迟敏感的线程, 读/解码线程抢占它们反而更容易卡顿
+            ok = ParseInt(value, &number) && number >= 1 && number <= 99 &&
+                 (role == ThreadRole::kAudio || role == ThreadRole::kPresent);
+            policy->fifo_priority_ = number;
+        }
+        if (!ok) {
+            av_log(nullptr, AV_LOG_ERROR, "invalid thread setting for %s: %.*s\n",
+                   kThreadRoleNames[static_cast<int>(role)], static_cast<int>(token.size()), token.data());
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// 读取配置文件: 每行一条策略(格式同 ParseThreadSpec, 空白分隔), # 之后为注释
+int LoadThreadConfig(ThreadPolicies *policies, std::string const &path) {
+    std::ifstream file{path};
+    if (!file) {
+        av_log(nullptr, AV_LOG_ERROR, "cannot open thread config %s: %s\n", path.c_str(), strerror(errno));
+        return -1;
+    }
+    std::string line;
+    for (int line_no{1}; std::getline(file, line); ++line_no) {
+        std::string_view spec{line};
+        spec = spec.substr(0, spec.find('#'));
+        if (ParseThreadSpec(policies, spec, " \t\r") < 0) {
+            av_log(nullptr, AV_LOG_ERROR, "%s:%d: bad thread config line\n", path.c_str(), line_no);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// 读取 NUMA 节点的 CPU 列表
+static int ReadNumaNodeCpus(int node, std::vector<int> *cpus) {
+    std::ifstream file{"/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"};
+    std::string list;
+    if (!std::getline(file, list) || ParseCpuList(list, cpus) < 0 || cpus->empty()) {
+        return -1;
+    }
+    return 0;
+}
+
+static bool IsDefaultPolicy(ThreadPolicy const &policy) {
+    return policy.cpus_.empty() && policy.numa_node_ < 0 && !policy.nice_ && policy.fifo_priority_ == 0;
+}
+
+// 在目标线程里调用(亲和性/nice/调度类都只改调用线程), 按策略调整并报告实际生效的设置
+// 权限不够等失败只警告, 线程保持原来的设置继续运行
+void ApplyThreadPolicy(ThreadRole role, ThreadPolicies const &policies) {
+    ThreadPolicy const &policy{policies[static_cast<int>(role)]};
+    char const *name{kThreadRoleNames[static_cast<int>(role)]};
+    if (IsDefaultPolicy(policy)) {
+        return;
+    }
+    pid_t tid{static_cast<pid_t>(syscall(SYS_gettid))};
+    std::string applied;
+
+    std::vector<int> cpus{policy.cpus_};
+    if (policy.numa_node_ >= 0) {
+        std::vector<int> node_cpus;
+        if (ReadNumaNodeCpus(policy.numa_node_, &node_cpus) < 0) {
+            av_log(nullptr, AV_LOG_WARNING, "%s thread: NUMA node %d not found\n", name, policy.numa_node_);
+        } else {
+            if (cpus.empty()) {
+                cpus = node_cpus;
+            } else {
+                std::vector<int> both;
+                std::set_intersection(cpus.begin(), cpus.end(), node_cpus.begin(), node_cpus.end(),
+                                      std::back_inserter(both));
+                cpus = both;
+                if (cpus.empty()) {
+                    av_log(nullptr, AV_LOG_WARNING, "%s thread: none of cpus %s is on NUMA node %d\n", name,
+                           FormatCpuList(policy.cpus_).c_str(), policy.numa_node_);
+                }
+            }
+            // 之后这个线程分配的内存(包、帧)优先来自本节点, 内存不够时才去别的节点
+            // NOTE: 内核会先把 maxnode 减一再读掩码, 要多传一位, 否则节点 63 被截掉
+            unsigned long node_mask{1UL << policy.numa_node_};
+            if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, &node_mask, sizeof(node_mask) * 8 + 1) < 0) {
+                av_log(nullptr, AV_LOG_WARNING, "%s thread: set_mempolicy failed: %s\n", name, strerror(errno));
+            } else {
+                applied += " mem-node " + std::to_string(policy.numa_node_);
+            }
+        }
+    }
+    if (!cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus) {
+            CPU_SET(cpu, &set);
+        }
+        int ret{pthread_setaffinity_np(pthread_self(), sizeof(set), &set)};
+        if (ret != 0) {
+            av_log(nullptr, AV_LOG_WARNING, "%s thread: cannot pin to cpus %s: %s\n", name,
+                   FormatCpuList(cpus).c_str(), strerror(ret));
+        } else {
+            applied += " cpus " + FormatCpuList(cpus);
+        }
+    }
+    if (policy.nice_) {
+        // Linux 上 nice 是每个线程的属性, 用线程 id 只改这一个线程
+        if (setpriority(PRIO_PROCESS, tid, *policy.nice_) < 0) {
+            av_log(nullptr, AV_LOG_WARNING, "%s thread: cannot set nice %d: %s\n", name, *policy.nice_,
+                   strerror(errno));
+        } else {
+            applied += " nice " + std::to_string(*policy.nice_);
+        }
+    }
+    if (policy.fifo_priority_ > 0) {
+        sched_param param{};
+        param.sched_priority = policy.fifo_priority_;
+        int ret{pthread_setschedparam(pthread_self(), SCHED_FIFO, &param)};
+        if (ret != 0) {
+            // 没有 CAP_SYS_NICE 或 RLIMIT_RTPRIO 不够时退回普通调度
+            av_log(nullptr, AV_LOG_WARNING, "%s thread: SCHED_FIFO %d not permitted (%s), keeping SCHED_OTHER\n",
+                   name, policy.fifo_priority_, strerror(ret));
+        } else {
+            applied += " SCHED_FIFO " + std::to_string(policy.fifo_priority_);
+        }
+    }
+    av_log(nullptr, AV_LOG_INFO, "%s thread (tid %d):%s\n", name, static_cast<int>(tid),
+           applied.empty() ? " no settings applied" : applied.c_str());
+}
+
+// NOTE: 亲和性、nice 和内存策略都只能改调用线程, 新线程从创建它的线程继承;
+// 在调用线程上临时改了再恢复需要记下所有原值, 换一个一次性的线程更简单
+void RunWithThreadPolicy(ThreadRole role, ThreadPolicies const &policies, std::function<void()> const &fn) {
+    if (IsDefaultPolicy(policies[static_cast<int>(role)])) {
+        fn();
+        return;
+    }
+    std::thread thread{[&] {
+        ApplyThreadPolicy(role, policies);
+        fn();
+    }};
+    thread.join();
+}
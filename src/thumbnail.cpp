@@ -0,0 +1,300 @@
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <player/playlist.hpp>
+#include <player/read_thread.hpp>
+#include <player/scope_guard.hpp>
+#include <player/thread_pool.hpp>
+#include <player/thumbnail.hpp>
+#include <unordered_map>
+#include <vector>
+
+// 一个文件的拼图: 所有缩略图按行排列在同一帧里
+struct ContactSheet {
+    AVFrame *frame_{nullptr};
+    SwsContext *sws_context_{nullptr};
+    int columns_{0};
+    int tile_width_{0};
+    int tile_height_{0};
+};
+
+static int InitContactSheet(ContactSheet *sheet, AVCodecParameters const *codec_params, PlayerOptions const &options) {
+    // 按显示宽高比(考虑 SAR)计算缩略图高度, 宽高取偶数以便 4:2:0 色度对齐
+    AVRational sar{codec_params->sample_aspect_ratio};
+    if (sar.num <= 0 || sar.den <= 0) {
+        sar = AVRational{1, 1};
+    }
+    sheet->tile_width_ = options.thumbnail_width_ & ~1;
+    sheet->tile_height_ = static_cast<int>(av_rescale(sheet->tile_width_, int64_t{codec_params->height} * sar.den,
+                                                      int64_t{codec_params->width} * sar.num)) &
+                          ~1;
+    sheet->tile_height_ = FFMAX(sheet->tile_height_, 2);
+    sheet->columns_ = static_cast<int>(std::ceil(std::sqrt(options.thumbnail_count_)));
+    int rows{(options.thumbnail_count_ + sheet->columns_ - 1) / sheet->columns_};
+
+    sheet->frame_ = av_frame_alloc();
+    if (!sheet->frame_) {
+        return AVERROR(ENOMEM);
+    }
+    sheet->frame_->format = options.thumbnail_format_ == "png" ? AV_PIX_FMT_RGB24 : AV_PIX_FMT_YUVJ420P;
+    sheet->frame_->width = sheet->columns_ * sheet->tile_width_;
+    sheet->frame_->height = rows * sheet->tile_height_;
+    if (av_frame_get_buffer(sheet->frame_, 0) < 0) {
+        return -1;
+    }
+    // 缩略图不够时空位保持黑色
+    ptrdiff_t linesizes[4]{sheet->frame_->linesize[0], sheet->frame_->linesize[1], sheet->frame_->linesize[2],
+                           sheet->frame_->linesize[3]};
+    av_image_fill_black(sheet->frame_->data, linesizes, static_cast<AVPixelFormat>(sheet->frame_->format),
+                        AVCOL_RANGE_JPEG, sheet->frame_->width, sheet->frame_->height);
+    return 0;
+}
+
+static void FreeContactSheet(ContactSheet *sheet) {
+    sws_freeContext(sheet->sws_context_);
+    sheet->sws_context_ = nullptr;
+    av_frame_free(&sheet->frame_);
+}
+
+// 把一帧缩放后画到拼图的第 index 格
+static int DrawTile(ContactSheet *sheet, AVFrame const *frame, int index) {
+    AVFrame *dst{sheet->frame_};
+    sheet->sws_context_ = sws_getCachedContext(sheet->sws_context_, frame->width, frame->height,
+                                               static_cast<AVPixelFormat>(frame->format), sheet->tile_width_,
+                                               sheet->tile_height_, static_cast<AVPixelFormat>(dst->format),
+                                               SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!sheet->sws_context_) {
+        av_log(nullptr, AV_LOG_ERROR, "sws_getCachedContext failed\n");
+        return -1;
+    }
+
+    AVPixFmtDescriptor const *desc{av_pix_fmt_desc_get(static_cast<AVPixelFormat>(dst->format))};
+    int max_step[4];
+    av_image_fill_max_pixsteps(max_step, nullptr, desc);
+    int x{(index % sheet->columns_) * sheet->tile_width_};
+    int y{(index / sheet->columns_) * sheet->tile_height_};
+    uint8_t *dst_data[4]{};
+    for (int plane{0}; plane < 4 && dst->data[plane]; ++plane) {
+        bool chroma{plane == 1 || plane == 2};
+        int shift_x{chroma ? desc->log2_chroma_w : 0};
+        int shift_y{chroma ? desc->log2_chroma_h : 0};
+        dst_data[plane] = dst->data[plane] + static_cast<ptrdiff_t>(y >> shift_y) * dst->linesize[plane] +
+                          (x >> shift_x) * max_step[plane];
+    }
+    return sws_scale(sheet->sws_context_, frame->data, frame->linesize, 0, frame->height, dst_data, dst->linesize) > 0
+               ? 0
+               : -1;
+}
+
+// 把一帧编码成 PNG(RGB24)或 JPEG(YUVJ420P)写到文件, 拼图和截图共用
+int WriteImageFile(AVFrame *sheet, std::string const &path, bool png) {
+    int ret{-1};
+    AVCodec const *codec{avcodec_find_encoder(png ? AV_CODEC_ID_PNG : AV_CODEC_ID_MJPEG)};
+    if (!codec) {
+        av_log(nullptr, AV_LOG_ERROR, "encoder not found: %s\n", png ? "png" : "mjpeg");
+        return -1;
+    }
+    AVCodecContext *codec_context{avcodec_alloc_context3(codec)};
+    AVPacket *packet{av_packet_alloc()};
+    FILE *file{nullptr};
+    ScopeGuard cleanup{[&] {
+        if (file) {
+            fclose(file);
+        }
+        av_packet_free(&packet);
+        avcodec_free_context(&codec_context);
+    }};
+    if (!codec_context || !packet) {
+        return -1;
+    }
+    codec_context->width = sheet->width;
+    codec_context->height = sheet->height;
+    codec_context->pix_fmt = static_cast<AVPixelFormat>(sheet->format);
+    codec_context->time_base = AVRational{1, 1};
+    if (!png) {
+        codec_context->flags |= AV_CODEC_FLAG_QSCALE;
+        codec_context->global_quality = FF_QP2LAMBDA * kThumbnailJpegQuality;
+        sheet->quality = codec_context->global_quality;
+    }
+    if ((ret = avcodec_open2(codec_context, codec, nullptr)) < 0) {
+        av_log(nullptr, AV_LOG_ERROR, "avcodec_open2 failed\n");
+        return ret;
+    }
+
+    file = fopen(path.c_str(), "wb");
+    if (!file) {
+        av_log(nullptr, AV_LOG_ERROR, "cannot open %s\n", path.c_str());
+        return -1;
+    }
+    sheet->pts = 0;
+    ret = avcodec_send_frame(codec_context, sheet);
+    if (ret >= 0) {
+        ret = avcodec_send_frame(codec_context, nullptr);
+    }
+    while (ret >= 0) {
+        ret = avcodec_receive_packet(codec_context, packet);
+        if (ret < 0) {
+            break;
+        }
+        if (fwrite(packet->data, 1, packet->size, file) != static_cast<size_t>(packet->size)) {
+            ret = -1;
+        }
+        av_packet_unref(packet);
+    }
+    return ret == AVERROR_EOF ? 0 : ret;
+}
+
+// 解码下一个关键帧(解码器设置了 AVDISCARD_NONKEY, 非关键帧的包直接不送)
+// 返回 0 表示得到一帧, 读到结尾或出错时返回负值
+static int DecodeNextKeyFrame(AVFormatContext *format_context, AVCodecContext *codec_context, int stream_idx,
+                              AVPacket *packet, AVFrame *frame) {
+    while (true) {
+        int ret = avcodec_receive_frame(codec_context, frame);
+        if (ret != AVERROR(EAGAIN)) {
+            return ret;  // 得到一帧, 或者已经排空(EOF)
+        }
+        if (av_read_frame(format_context, packet) < 0) {
+            avcodec_send_packet(codec_context, nullptr);  // 读到结尾: 排空解码器
+            continue;
+        }
+        if (packet->stream_index != stream_idx || !(packet->flags & AV_PKT_FLAG_KEY)) {
+            av_packet_unref(packet);
+            continue;
+        }
+        ret = avcodec_send_packet(codec_context, packet);
+        av_packet_unref(packet);
+        if (ret < 0 && ret != AVERROR(EAGAIN)) {
+            return ret;
+        }
+    }
+}
+
+// 处理一个文件: 在时长上均匀取点, 按索引 seek 到之前最近的关键帧解码, 拼成一张图, 写到 path
+static int ExtractThumbnails(std::string const &file_name, std::string const &path, PlayerOptions const &options) {
+    int ret{-1};
+    int64_t start_time{av_gettime_relative()};
+    MediaItem item;
+    ContactSheet sheet;
+    AVPacket *packet{nullptr};
+    AVFrame *frame{nullptr};
+    ScopeGuard cleanup{[&] {
+        FreeContactSheet(&sheet);
+        av_frame_free(&frame);
+        av_packet_free(&packet);
+        CloseMediaItem(&item);
+    }};
+
+    if (OpenMediaItem(&item, file_name, options) < 0) {
+        return -1;
+    }
+    AVFormatContext *format_context{item.format_context_};
+    if (item.video_stream_idx_ < 0) {
+        av_log(nullptr, AV_LOG_ERROR, "%s: no video stream\n", file_name.c_str());
+        return -1;
+    }
+    // 只要视频流的关键帧, 音频也交给解复用器丢弃
+    if (item.audio_stream_idx_ >= 0) {
+        format_context->streams[item.audio_stream_idx_]->discard = AVDISCARD_ALL;
+    }
+    AVStream *stream{format_context->streams[item.video_stream_idx_]};
+    item.video_codec_context_ = OpenCodecContext(stream, options);
+    if (!item.video_codec_context_) {
+        return -1;
+    }
+    item.video_codec_context_->skip_frame = AVDISCARD_NONKEY;
+
+    packet = av_packet_alloc();
+    frame = av_frame_alloc();
+    if (!packet || !frame || InitContactSheet(&sheet, stream->codecpar, options) < 0) {
+        return -1;
+    }
+
+    int nb_tiles{0};
+    int64_t last_pts{AV_NOPTS_VALUE};
+    for (int i{0}; i < options.thumbnail_count_; ++i) {
+        // 时长未知(比如裸流)时不 seek, 依次取关键帧
+        if (format_context->duration > 0) {
+            int64_t target{format_context->duration * (2 * i + 1) / (2 * options.thumbnail_count_)};
+            if (format_context->start_time != AV_NOPTS_VALUE) {
+                target += format_context->start_time;
+            }
+            target = av_rescale_q(target, AV_TIME_BASE_Q, stream->time_base);
+            if (av_seek_frame(format_context, item.video_stream_idx_, target, AVSEEK_FLAG_BACKWARD) >= 0) {
+                avcodec_flush_buffers(item.video_codec_context_);
+            }
+        }
+        // 关键帧间隔比取点间隔大时会 seek 到同一个关键帧, 跳过已经用过的
+        while ((ret = DecodeNextKeyFrame(format_context, item.video_codec_context_, item.video_stream_idx_, packet,
+                                         frame)) >= 0 &&
+               last_pts != AV_NOPTS_VALUE && frame->best_effort_timestamp <= last_pts) {
+            av_frame_unref(frame);
+        }
+        if (ret < 0) {
+            break;  // 没有更多关键帧了
+        }
+        last_pts = frame->best_effort_timestamp;
+        ret = DrawTile(&sheet, frame, nb_tiles);
+        av_frame_unref(frame);
+        if (ret < 0) {
+            return -1;
+        }
+        ++nb_tiles;
+    }
+    if (nb_tiles == 0) {
+        av_log(nullptr, AV_LOG_ERROR, "%s: no keyframe decoded\n", file_name.c_str());
+        return -1;
+    }
+
+    if (WriteImageFile(sheet.frame_, path, options.thumbnail_format_ == "png") < 0) {
+        return -1;
+    }
+    av_log(nullptr, AV_LOG_INFO, "%s -> %s (%d tiles, %.1f ms)\n", file_name.c_str(), path.c_str(), nb_tiles,
+           (av_gettime_relative() - start_time) / 1000.0);
+    return 0;
+}
+
+// 每个文件的输出路径: 输出目录 / 文件名.格式
+// 不同目录下的同名文件(a/clip.mp4 和 b/clip.mp4)或重复列出的文件会写同一个输出, 并行时互相覆盖,
+// 这些文件名后面加上播放列表下标区分(clip.mp4.0.jpg, clip.mp4.1.jpg), 不冲突的保持原名
+static std::vector<std::string> ThumbnailPaths(PlayerOptions const &options) {
+    std::unordered_map<std::string, int> nb_uses;
+    for (std::string const &file_name : options.playlist_) {
+        ++nb_uses[std::filesystem::path{file_name}.filename().string()];
+    }
+    std::vector<std::string> paths;
+    for (std::size_t i{0}; i < options.playlist_.size(); ++i) {
+        std::string name{std::filesystem::path{options.playlist_[i]}.filename().string()};
+        if (nb_uses[name] > 1) {
+            name += "." + std::to_string(i);
+        }
+        paths.push_back((std::filesystem::path{options.output_dir_} / name).string() + "." + options.thumbnail_format_);
+    }
+    return paths;
+}
+
+int RunThumbnails(PlayerOptions const &options) {
+    std::error_code ec;
+    std::filesystem::create_directories(options.output_dir_, ec);
+    if (ec) {
+        av_log(nullptr, AV_LOG_ERROR, "cannot create %s: %s\n", options.output_dir_.c_str(), ec.message().c_str());
+        return -1;
+    }
+
+    // 每个文件一个任务, 文件内部串行(解码器不再开线程), 文件之间占满所有核
+    int64_t start_time{av_gettime_relative()};
+    int nb_files{static_cast<int>(options.playlist_.size())};
+    std::vector<std::string> paths{ThumbnailPaths(options)};
+    std::atomic<int> nb_failed{0};
+    ThreadPool &pool{SharedThreadPool()};
+    pool.ParallelFor(nb_files, [&](int i) {
+        if (ExtractThumbnails(options.playlist_[i], paths[i], options) < 0) {
+            ++nb_failed;
+        }
+    });
+
+    double elapsed{(av_gettime_relative() - start_time) / 1000000.0};
+    av_log(nullptr, AV_LOG_INFO, "thumbnails: %d files, %d failed, %.2f s (%.1f files/s, %zu workers)\n", nb_files,
+           nb_failed.load(), elapsed, nb_files / FFMAX(elapsed, 1e-6), pool.Size() + 1);
+    return nb_failed ? -1 : 0;
+}
@@ -0,0 +1,220 @@
+#include <cmath>
+#include <player/pixel_convert.hpp>
+#include <player/video_filter.hpp>
+#include <player/video_thread.hpp>
+
+// 解码线程调用: 把解码出的帧交给滤镜线程(转移引用), 队列满时阻塞, 队列中止时返回 -1
+int QueueFilterFrame(VideoState *video_state, AVFrame *frame, double pts, double duration) {
+    Frame *fp{PeekWritableFrameQueue(&video_state->filter_frame_queue_)};
+    if (!fp) {
+        return -1;
+    }
+    fp->pts_ = pts;
+    fp->duration_ = duration;
+    fp->pos_ = frame->pkt_pos;
+    av_frame_move_ref(fp->frame_, frame);
+    MoveWriteIndex(&video_state->filter_frame_queue_);
+    return 0;
+}
+
+static void FreeVideoFilter(VideoFilter *filter) {
+    avfilter_graph_free(&filter->graph_);  // 同时释放图中的所有滤镜
+    filter->src_ = nullptr;
+    filter->sink_ = nullptr;
+}
+
+static bool NeedRebuildVideoFilter(VideoFilter const *filter, AVFrame const *frame) {
+    return frame->width != filter->width_ || frame->height != filter->height_ || frame->format != filter->format_;
+}
+
+// 按 frame 的格式建图: buffer -> 用户指定的滤镜 -> buffersink
+static int BuildVideoFilter(VideoState *video_state, AVFrame const *frame, double duration) {
+    VideoFilter *filter{&video_state->video_filter_};
+    FreeVideoFilter(filter);
+    filter->width_ = frame->width;
+    filter->height_ = frame->height;
+    filter->format_ = frame->format;
+    filter->frame_duration_ = duration;
+
+    std::string const &desc{video_state->options_.video_filters_};
+    filter->graph_ = avfilter_graph_alloc();
+    if (!filter->graph_) {
+        return AVERROR(ENOMEM);
+    }
+    filter->graph_->nb_threads = video_state->options_.filter_threads_;  // 0 为按 CPU 数自动选择
+
+    AVRational sar{frame->sample_aspect_ratio.num > 0 ? frame->sample_aspect_ratio : av_make_q(1, 1)};
+    AVRational frame_rate{duration > 0 ? av_d2q(1 / duration, 100000) : av_make_q(0, 1)};
+    char args[256];
+    snprintf(args, sizeof(args), "video_size=%dx%d:pix_fmt=%d:time_base=1/%d:pixel_aspect=%d/%d:frame_rate=%d/%d",
+             frame->width, frame->height, frame->format, AV_TIME_BASE, sar.num, sar.den, frame_rate.num,
+             frame_rate.den);
+    int ret{avfilter_graph_create_filter(&filter->src_, avfilter_get_by_name("buffer"), "in", args, nullptr,
+                                         filter->graph_)};
+    if (ret < 0) {
+        av_log(nullptr, AV_LOG_ERROR, "cannot create buffer source: %s\n", args);
+        return ret;
+    }
+    ret = avfilter_graph_create_filter(&filter->sink_, avfilter_get_by_name("buffersink"), "out", nullptr, nullptr,
+                                       filter->graph_);
+    if (ret < 0) {
+        av_log(nullptr, AV_LOG_ERROR, "cannot create buffer sink\n");
+        return ret;
+    }
+
+    // outputs/inputs 是从用户滤镜的角度看的: 它的输入接 "in", 输出接 "out"
+    AVFilterInOut *outputs{avfilter_inout_alloc()};
+    AVFilterInOut *inputs{avfilter_inout_alloc()};
+    if (!outputs || !inputs) {
+        avfilter_inout_free(&outputs);
+        avfilter_inout_free(&inputs);
+        return AVERROR(ENOMEM);
+    }
+    outputs->name = av_strdup("in");
+    outputs->filter_ctx = filter->src_;
+    outputs->pad_idx = 0;
+    outputs->next = nullptr;
+    inputs->name = av_strdup("out");
+    inputs->filter_ctx = filter->sink_;
+    inputs->pad_idx = 0;
+    inputs->next = nullptr;
+    ret = avfilter_graph_parse_ptr(filter->graph_, desc.c_str(), &inputs, &outputs, nullptr);
+    avfilter_inout_free(&outputs);
+    avfilter_inout_free(&inputs);
+    if (ret >= 0) {
+        ret = avfilter_graph_config(filter->graph_, nullptr);
+    }
+    if (ret < 0) {
+        av_log(nullptr, AV_LOG_ERROR, "cannot build video filter \"%s\" for %dx%d %s\n", desc.c_str(), frame->width,
+               frame->height, av_get_pix_fmt_name(static_cast<AVPixelFormat>(frame->format)));
+        return ret;
+    }
+    ++filter->nb_builds_;
+    av_log(nullptr, AV_LOG_INFO, "video filter \"%s\": %dx%d %s -> %dx%d %s (%d threads)%s\n", desc.c_str(),
+           frame->width, frame->height, av_get_pix_fmt_name(static_cast<AVPixelFormat>(frame->format)),
+           av_buffersink_get_w(filter->sink_), av_buffersink_get_h(filter->sink_),
+           av_get_pix_fmt_name(static_cast<AVPixelFormat>(av_buffersink_get_format(filter->sink_))),
+           filter->graph_->nb_threads, filter->nb_builds_ > 1 ? ", rebuilt after a format change" : "");
+    return 0;
+}
+
+// 和解码线程一样: SDL 纹理只接受 YUV420P, 滤镜输出其他格式时先并行转换, 然后进显示队列
+static int QueueFilteredPicture(VideoState *video_state, PixelConverter *converter, AVFrame *frame,
+                                AVFrame *converted_frame, double pts, double duration) {
+    AVFrame *picture{frame};
+    if (NeedPixelConvert(frame->format)) {
+        if (ConvertFrame(converter, frame, converted_frame) < 0) {
+            return 0;  // 跳过这一帧
+        }
+        picture = converted_frame;
+    }
+    int ret{QueuePicture(video_state, picture, pts, duration, frame->pkt_pos)};
+    av_frame_unref(converted_frame);
+    return ret;
+}
+
+// 取出滤镜图中所有已经输出的帧放进显示队列, 显示队列中止时返回 -1
+static int PullFilteredFrames(VideoState *video_state, PixelConverter *converter, AVFrame *filtered,
+                              AVFrame *converted_frame) {
+    VideoFilter *filter{&video_state->video_filter_};
+    while (true) {
+        int ret{av_buffersink_get_frame(filter->sink_, filtered)};
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+            return 0;
+        }
+        if (ret < 0) {
+            av_log(nullptr, AV_LOG_ERROR, "av_buffersink_get_frame failed\n");
+            return 0;
+        }
+        // 去隔行的倍帧模式等会改变帧率和时间戳, 都以滤镜的输出为准
+        AVRational time_base{av_buffersink_get_time_base(filter->sink_)};
+        AVRational frame_rate{av_buffersink_get_frame_rate(filter->sink_)};
+        double duration{frame_rate.num > 0 && frame_rate.den > 0 ? av_q2d(av_inv_q(frame_rate))
+                                                                 : filter->frame_duration_};
+        double pts{filtered->pts == AV_NOPTS_VALUE ? NAN : filtered->pts * av_q2d(time_base)};
+        ret = QueueFilteredPicture(video_state, converter, filtered, converted_frame, pts, duration);
+        av_frame_unref(filtered);
+        if (ret < 0) {
+            return -1;
+        }
+    }
+}
+
+// 送入结束标记, 取出滤镜中缓存的帧(yadif 等会留住最后一帧); 之后这个图不能再用
+static int DrainVideoFilter(VideoState *video_state, PixelConverter *converter, AVFrame *filtered,
+                            AVFrame *converted_frame) {
+    VideoFilter *filter{&video_state->video_filter_};
+    if (!filter->graph_) {
+        return 0;
+    }
+    av_buffersrc_add_frame(filter->src_, nullptr);
+    int ret{PullFilteredFrames(video_state, converter, filtered, converted_frame)};
+    FreeVideoFilter(filter);
+    return ret;
+}
+
+// 滤镜线程: filter_frame_queue_ -> 滤镜图 -> (像素格式转换) -> video_frame_queue_
+int VideoFilterThread(void *arg) {
+    VideoState *video_state{static_cast<VideoState *>(arg)};
+    ApplyThreadPolicy(ThreadRole::kDecode, video_state->options_.thread_policies_);  // 和解码线程用同一组设置
+    VideoFilter *filter{&video_state->video_filter_};
+    AVFrame *filtered{av_frame_alloc()};
+    AVFrame *converted_frame{av_frame_alloc()};
+    PixelConverter converter;
+    bool aborted{false};
+
+    while (Frame *fp = PeekReadableFrameQueue(&video_state->filter_frame_queue_)) {
+        AVFrame *frame{fp->frame_};
+        if (NeedRebuildVideoFilter(filter, frame)) {
+            // 格式变了(换条目、换轨或流中途改变分辨率): 旧图中缓存的帧先显示完
+            if (DrainVideoFilter(video_state, &converter, filtered, converted_frame) < 0) {
+                aborted = true;
+                break;
+            }
+            if (BuildVideoFilter(video_state, frame, fp->duration_) < 0) {
+                FreeVideoFilter(filter);
+                av_log(nullptr, AV_LOG_WARNING, "showing unfiltered video until the format changes\n");
+            }
+        }
+
+        int ret{0};
+        if (filter->graph_) {
+            frame->pts = std::isnan(fp->pts_) ? AV_NOPTS_VALUE : std::llrint(fp->pts_ * AV_TIME_BASE);
+            // KEEP_REF: 队列中的帧仍由 MoveReadIndex 释放(内存记账按入队时的大小扣除)
+            ret = av_buffersrc_add_frame_flags(filter->src_, frame, AV_BUFFERSRC_FLAG_KEEP_REF);
+            MoveReadIndex(&video_state->filter_frame_queue_);
+            if (ret < 0) {
+                av_log(nullptr, AV_LOG_ERROR, "av_buffersrc_add_frame failed\n");
+                continue;
+            }
+            ret = PullFilteredFrames(video_state, &converter, filtered, converted_frame);
+        } else {
+            // 同样不能把队列中的帧直接转移出去, 另外引用一份
+            // NOTE: 滤镜队列没有 keep_last, MoveReadIndex 之后槽位随时会被解码线程重写, 时间戳要先取出来
+            double pts{fp->pts_};
+            double duration{fp->duration_};
+            ret = av_frame_ref(filtered, frame);
+            MoveReadIndex(&video_state->filter_frame_queue_);
+            if (ret < 0) {
+                continue;
+            }
+            ret = QueueFilteredPicture(video_state, &converter, filtered, converted_frame, pts, duration);
+            av_frame_unref(filtered);
+        }
+        if (ret < 0) {
+            aborted = true;
+            break;
+        }
+    }
+
+    // 解码线程已经结束了整个播放列表: 排空滤镜, 然后通知显示端没有更多的帧
+    if (!aborted && !video_state->quit_ &&
+        DrainVideoFilter(video_state, &converter, filtered, converted_frame) >= 0) {
+        FinishFrameQueue(&video_state->video_frame_queue_);
+    }
+    FreeVideoFilter(filter);
+    FreePixelConverter(&converter);
+    av_frame_free(&converted_frame);
+    av_frame_free(&filtered);
+    return 0;
+}
@@ -1,3 +1,7 @@
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <player/audio_thread.hpp>
 #include <player/video_thread.hpp>
 
 extern SDL_Window* window;
@@ -6,12 +10,13 @@ extern SDL_Renderer* renderer;
 int OpenVideo(VideoState* video_state) {
     SDL_SetWindowTitle(window, video_state->file_name_.c_str());
 
-    SDL_SetWindowSize(window, kScreenWidth, kScreenHeight);
+    PipelineConfig const& pipeline{video_state->options_.pipeline_};
+    SDL_SetWindowSize(window, pipeline.screen_width_, pipeline.screen_height_);
     SDL_SetWindowPosition(window, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED);
     SDL_ShowWindow(window);
 
-    video_state->width_ = kScreenWidth;
-    video_state->height_ = kScreenHeight;
+    video_state->width_ = pipeline.screen_width_;
+    video_state->height_ = pipeline.screen_height_;
 
     return 0;
 }
@@ -24,6 +29,16 @@ void DisplayVideo(VideoState* video_state) {
 
     AVFrame* frame = vp->frame_;
 
+    // 分辨率变了(换轨或者播放列表切换条目)就重建纹理
+    int texture_width{0}, texture_height{0};
+    if (video_state->texture_) {
+        SDL_QueryTexture(video_state->texture_, nullptr, nullptr, &texture_width, &texture_height);
+        if (texture_width != frame->width || texture_height != frame->height) {
+            SDL_DestroyTexture(video_state->texture_);
+            video_state->texture_ = nullptr;
+        }
+    }
+
     if (!video_state->texture_) {
         int width = frame->width;
         int height = frame->height;
@@ -46,23 +61,75 @@ void DisplayVideo(VideoState* video_state) {
                          frame->linesize[1], frame->data[2], frame->linesize[2]);
     SDL_RenderClear(renderer);
     SDL_RenderCopy(renderer, video_state->texture_, nullptr, &rect);
+    DrawSubtitles(video_state, vp, &rect);  // 字幕只在变化时重新排版上传, 其余时候直接从图集复制
     SDL_RenderPresent(renderer);
 
     // 释放视频帧
     MoveReadIndex(&video_state->video_frame_queue_);
 }
 
+// 低延迟模式: 只要后面还有更新的帧, 就丢掉已经超过目标延迟的帧
+static void DropLateFrames(VideoState* video_state) {
+    FrameQueue* f{&video_state->video_frame_queue_};
+    while (NbRemainingFrameQueue(f) > 1) {
+        Frame* vp{PeekFrameQueue(f)};
+        if (!vp->arrival_time_ ||
+            (av_gettime_relative() - vp->arrival_time_) / 1000000.0 <= video_state->options_.target_latency_) {
+            break;
+        }
+        MoveReadIndex(f);
+        ++video_state->frame_drops_;
+    }
+}
+
+// 记录即将显示的帧的端到端延迟(从读到包到显示), 每秒输出一次
+static void UpdateLatency(VideoState* video_state, Frame* vp) {
+    if (!vp->arrival_time_) {
+        return;
+    }
+    int64_t now{av_gettime_relative()};
+    video_state->latency_ = (now - vp->arrival_time_) / 1000000.0;
+    video_state->latency_avg_ = video_state->latency_avg_ == 0
+                                    ? video_state->latency_
+                                    : 0.9 * video_state->latency_avg_ + 0.1 * video_state->latency_;
+    if (now - video_state->latency_report_time_ >= 1000000) {
+        video_state->latency_report_time_ = now;
+        av_log(nullptr, AV_LOG_INFO,
+               "latency: %.0f ms (avg %.0f ms, target %.0f ms), dropped %lld frames, %lld audio packets\n",
+               video_state->latency_ * 1000, video_state->latency_avg_ * 1000,
+               video_state->options_.target_latency_ * 1000, (long long)video_state->frame_drops_,
+               (long long)video_state->audio_packet_drops_);
+    }
+}
+
 void VideoRefreshTimer(void* user_data) {
     VideoState* video_state = static_cast<VideoState*>(user_data);
     Frame* vp{nullptr};
 
     double actual_delay, delay, sync_threshold, ref_clock, diff;
 
-    if (video_state->video_stream_) {                      // 如果存在视频流
-        if (video_state->video_frame_queue_.size_ == 0) {  // 如果视频帧队列为空
-            RefreshSchedule(video_state, 1);               // 快速刷新直到发现有数据
+    ++video_state->wakeup_count_;
+
+    if (video_state->paused_) {  // 暂停时停表, 恢复时由 TogglePause 重新启动
+        video_state->refresh_parked_ = true;
+        return;
+    }
+
+    if (video_state->video_stream_) {                                       // 如果存在视频流
+        if (NbRemainingFrameQueue(&video_state->video_frame_queue_) == 0) {  // 如果视频帧队列为空
+            // 停表, 由 QueuePicture 在有新帧时重新启动(不再 1 ms 轮询)
+            video_state->refresh_parked_ = true;
+            // 复查: 解码线程可能恰好在停表前入队
+            if (NbRemainingFrameQueue(&video_state->video_frame_queue_) > 0 &&
+                video_state->refresh_parked_.exchange(false)) {
+                RefreshSchedule(video_state, 1);
+            }
         } else {
+            if (video_state->options_.low_latency_) {
+                DropLateFrames(video_state);
+            }
             vp = PeekFrameQueue(&video_state->video_frame_queue_);
+            UpdateLatency(video_state, vp);
             video_state->video_current_pts_ = vp->pts_;
             video_state->video_current_pts_time_ = av_gettime();
             if (video_state->frame_last_pts_ == 0) {
@@ -87,8 +154,9 @@ void VideoRefreshTimer(void* user_data) {
 
             // Skip or repeat the frame. Take delay into account
             // FFPlay still doesn't "know if this is the best guess."
-            sync_threshold = (delay > kMaxAvSyncThreshold) ? delay : kMaxAvSyncThreshold;
-            if (fabs(diff) < kAvNoSyncThreshold) {
+            PipelineConfig const& pipeline{video_state->options_.pipeline_};
+            sync_threshold = (delay > pipeline.max_sync_threshold_) ? delay : pipeline.max_sync_threshold_;
+            if (fabs(diff) < pipeline.no_sync_threshold_) {
                 if (diff <= -sync_threshold) {        // diff 小于负阈值, 视频慢了
                     delay = 0;                        // 不要延迟，立即播放
                 } else if (diff >= sync_threshold) {  // diff 大于阈值, 视频快了
@@ -107,19 +175,184 @@ void VideoRefreshTimer(void* user_data) {
             DisplayVideo(video_state);
         }
     } else {
-        RefreshSchedule(video_state, 100);
+        // 视频流还没打开, 停表等待第一帧入队
+        video_state->refresh_parked_ = true;
     }
 }
 
+void TogglePause(VideoState* video_state) {
+    if (video_state->paused_) {
+        // 恢复: 暂停期间流逝的时间不算进视频时钟, 否则恢复后会连续追帧
+        double paused_time = (av_gettime() - video_state->pause_start_time_) / 1000000.0;
+        video_state->frame_timer_ += paused_time;
+        av_log(nullptr, AV_LOG_INFO, "resume after %.3f s, %lld wakeups while paused\n", paused_time,
+               (long long)(video_state->wakeup_count_ - video_state->wakeup_count_at_pause_));
+        {
+            std::lock_guard lk{video_state->state_mtx_};
+            video_state->paused_ = false;
+        }
+        video_state->state_cv_.notify_all();
+        SDL_PauseAudio(0);
+        if (video_state->refresh_parked_.exchange(false)) {
+            RefreshSchedule(video_state, 1);
+        }
+    } else {
+        video_state->pause_start_time_ = av_gettime();
+        {
+            std::lock_guard lk{video_state->state_mtx_};
+            video_state->paused_ = true;
+        }
+        SDL_PauseAudio(1);  // 音频回调停止, 音频时钟随之冻结
+        video_state->wakeup_count_at_pause_ = video_state->wakeup_count_;
+    }
+}
+
+// 调节软件音量(音频回调在下一帧生效)
+static void UpdateVolume(VideoState* video_state, float step) {
+    float volume{std::clamp(video_state->volume_ + step, 0.0f, kMaxVolume)};
+    video_state->volume_ = volume;
+    av_log(nullptr, AV_LOG_INFO, "volume: %.0f%%\n", volume * 100);
+}
+
+// F1-F8 静音/取消静音对应的混音源, 按住 Shift 时切换 solo
+static void ToggleMixerSource(VideoState* video_state, int index, bool solo) {
+    if (!video_state->audio_mixer_ready_) {
+        return;
+    }
+    std::vector<std::unique_ptr<MixerSource>>& sources{video_state->audio_mixer_.sources_};
+    if (index >= static_cast<int>(sources.size())) {
+        return;
+    }
+    MixerSource* source{sources[index].get()};
+    if (solo) {
+        source->solo_ = !source->solo_;
+        av_log(nullptr, AV_LOG_INFO, "mix source %s: solo %s\n", source->name_.c_str(), source->solo_ ? "on" : "off");
+    } else {
+        source->muted_ = !source->muted_;
+        av_log(nullptr, AV_LOG_INFO, "mix source %s: %s\n", source->name_.c_str(),
+               source->muted_ ? "muted" : "unmuted");
+    }
+}
+
+// 退出: 设置退出标志并唤醒所有阻塞在队列/混音器上的线程
+void RequestQuit(VideoState* video_state) {
+    {
+        std::lock_guard lk{video_state->state_mtx_};
+        video_state->quit_ = true;
+    }
+    video_state->state_cv_.notify_all();
+    if (video_state->quit_fd_ >= 0) {
+        eventfd_write(video_state->quit_fd_, 1);  // 唤醒等直播文件增长的读线程
+    }
+    // 唤醒阻塞在队列上的解码/读线程
+    AbortPacketQueue(&video_state->video_packet_queue_);
+    AbortPacketQueue(&video_state->audio_packet_queue_);
+    AbortPacketQueue(&video_state->subtitle_packet_queue_);
+    SignalFrameQueue(&video_state->video_frame_queue_);
+    SignalFrameQueue(&video_state->filter_frame_queue_);
+    SignalFrameQueue(&video_state->subtitle_frame_queue_);
+    if (video_state->audio_mixer_ready_) {
+        AbortAudioMixer(&video_state->audio_mixer_);
+    }
+    UnlinkShmRing(&video_state->shm_ring_);
+}
+
+// 结构化退出: RequestQuit 之后等所有线程和协程结束, 返回后没有任何后台工作再访问 video_state
+void JoinVideoState(VideoState* video_state) {
+    SDL_WaitThread(video_state->read_tid_, nullptr);
+    video_state->read_tid_ = nullptr;
+    if (video_state->quit_fd_ >= 0) {
+        close(video_state->quit_fd_);
+        video_state->quit_fd_ = -1;
+    }
+    // 以下线程都由读线程创建, 读线程退出后句柄不会再变
+    SDL_WaitThread(video_state->preload_tid_, nullptr);
+    video_state->preload_tid_ = nullptr;
+    SDL_WaitThread(video_state->decode_tid_, nullptr);
+    video_state->decode_tid_ = nullptr;
+    SDL_WaitThread(video_state->filter_tid_, nullptr);
+    video_state->filter_tid_ = nullptr;
+    // 解码线程和滤镜线程(--vf 时由它调用 QueuePicture)都结束了, 不会再有帧发布到共享内存
+    DestroyShmRing(&video_state->shm_ring_);
+    SDL_WaitThread(video_state->subtitle_tid_, nullptr);
+    video_state->subtitle_tid_ = nullptr;
+    SDL_WaitThread(video_state->raw_video_sink_.tid_, nullptr);
+    video_state->raw_video_sink_.tid_ = nullptr;
+    SDL_WaitThread(video_state->raw_audio_sink_.tid_, nullptr);
+    video_state->raw_audio_sink_.tid_ = nullptr;
+    // 已经提交的截图/剪辑写完再退出, 读线程已经结束, 剪辑缓冲不会再变
+    StopCaptureThread(video_state);
+    FreeClipRing(&video_state->clip_ring_);
+    // 混音源的协程在 AbortAudioMixer 之后都会恢复并运行结束
+    video_state->audio_mixer_.executor_.Shutdown();
+    // 音频回调和混音源都已停止, 可以释放音频缓冲(同时从内存账上扣除)
+    DestroyAudioMixer(&video_state->audio_mixer_);
+    FreeAudioBuffer(video_state);
+    // 字幕叠加层属于主线程(纹理和字体), 也在这里释放
+    DestroySubtitleOverlay(&video_state->subtitle_overlay_);
+}
+
 void SdlEventLoop(VideoState* video_state) {
+    ApplyThreadPolicy(ThreadRole::kPresent, video_state->options_.thread_policies_);  // 事件循环和视频刷新都在主线程
     SDL_Event event;
     while (true) {
         SDL_WaitEvent(&event);
         switch (event.type) {
-            case SDL_QUIT:
-                video_state->quit_ = true;
+            case SDL_KEYDOWN:
+                switch (event.key.keysym.sym) {
+                    case SDLK_SPACE:
+                    case SDLK_p:
+                        TogglePause(video_state);
+                        break;
+                    case SDLK_a:  // 切换音频轨
+                        ++video_state->audio_track_requests_;
+                        break;
+                    case SDLK_v:  // 切换视频轨
+                        ++video_state->video_track_requests_;
+                        break;
+                    case SDLK_9:  // 减小音量
+                    case SDLK_KP_DIVIDE:
+                        UpdateVolume(video_state, -kVolumeStep);
+                        break;
+                    case SDLK_0:  // 增大音量
+                    case SDLK_KP_MULTIPLY:
+                        UpdateVolume(video_state, kVolumeStep);
+                        break;
+                    case SDLK_m:  // 静音
+                        video_state->muted_ = !video_state->muted_;
+                        av_log(nullptr, AV_LOG_INFO, "%s\n", video_state->muted_ ? "muted" : "unmuted");
+                        break;
+                    case SDLK_s:  // 截图
+                        RequestScreenshot(video_state);
+                        break;
+                    case SDLK_c:  // 保存最近 --clip-seconds 秒
+                        RequestClip(video_state);
+                        break;
+                    case SDLK_t:  // 显示/隐藏字幕
+                        ToggleSubtitles(video_state);
+                        break;
+                    case SDLK_i:  // 输出内存占用
+                        ReportMemoryUsage();
+                        break;
+                    default:
+                        if (event.key.keysym.sym >= SDLK_F1 && event.key.keysym.sym <= SDLK_F8) {
+                            ToggleMixerSource(video_state, event.key.keysym.sym - SDLK_F1,
+                                              event.key.keysym.mod & KMOD_SHIFT);
+                        }
+                        break;
+                }
+                break;
+            case SDL_QUIT: {
+                RequestQuit(video_state);
+                SDL_CloseAudio();  // 先停掉音频回调, 它还在读解码器和混音源
+                JoinVideoState(video_state);
+                ReportMemoryUsage();
                 SDL_Quit();
                 return;
+            }
+            case kFFAutoTuneEvent:
+                FinishAutoTune(video_state);
+                break;
             case kFFRefreshEvent:
                 // NOTE: 这里是视频刷新
                 VideoRefreshTimer(event.user.data1);
@@ -144,15 +377,24 @@ int QueuePicture(VideoState* video_state, AVFrame* src_frame, double pts, double
     vp->pts_ = pts;
     vp->duration_ = duration;
     vp->pos_ = pos;
+    vp->arrival_time_ = static_cast<int64_t>(reinterpret_cast<intptr_t>(src_frame->opaque));
 
     SetDefaultWindowSize(vp->width_, vp->height_, vp->sar_);
 
+    // 同时发布到共享内存(只拷贝一次, 不等消费者)
+    PublishShmFrame(&video_state->shm_ring_, src_frame, pts);
+
     av_frame_move_ref(vp->frame_, src_frame);
     MoveWriteIndex(&video_state->video_frame_queue_);
+
+    // 刷新定时器停表了(之前无帧可显示), 有新帧了就重新启动; 暂停时留给 TogglePause 恢复
+    if (!video_state->paused_ && video_state->refresh_parked_.exchange(false)) {
+        RefreshSchedule(video_state, 1);
+    }
     return 0;
 }
 
-double SyschronizeVideo(VideoState* video_state, AVFrame* frame, double pts) {
+double SyschronizeVideo(VideoState* video_state, AVFrame* frame, double pts, AVRational time_base) {
     double frame_delay;
 
     if (pts != 0) {
@@ -164,7 +406,7 @@ double SyschronizeVideo(VideoState* video_state, AVFrame* frame, double pts) {
     }
 
     //  更新视频时钟
-    frame_delay = av_q2d(video_state->video_stream_->time_base);  // 时间基 -> 秒
+    frame_delay = av_q2d(time_base);  // 时间基 -> 秒
     // 如果我们在重复一帧，相应调整时钟
     frame_delay += frame->repeat_pict * (frame_delay * 0.5);
     video_state->video_clock_ += frame_delay;
@@ -179,27 +421,53 @@ int DecodeThread(void* arg) {
     double duration;
 
     VideoState* video_state = static_cast<VideoState*>(arg);
-    AVFrame* video_frame = av_frame_alloc();  // 解码后的视频帧
+    ApplyThreadPolicy(ThreadRole::kDecode, video_state->options_.thread_policies_);
+    AVFrame* video_frame = av_frame_alloc();      // 解码后的视频帧
+    AVFrame* converted_frame = av_frame_alloc();  // 转换成 YUV420P 后的视频帧
+    PixelConverter converter;
     Frame* frame = nullptr;
+    bool filtering{!video_state->options_.video_filters_.empty()};  // 有滤镜时帧交给滤镜线程, 由它转换和入队
 
-    AVRational time_base = video_state->video_stream_->time_base;
+    AVRational time_base = video_state->video_codec_context_->pkt_timebase;
     AVRational frame_rate = video_state->video_stream_->avg_frame_rate;
+    double pts_offset{0};  // 播放列表中当前条目的时间戳偏移(秒)
+
+    // 换成读线程交接过来的解码器(下一个条目或换轨)
+    auto switch_decoder = [&](DecoderHandoff& handoff) {
+        avcodec_free_context(&video_state->video_codec_context_);
+        video_state->video_codec_context_ = handoff.codec_context_;
+        time_base = handoff.codec_context_->pkt_timebase;
+        frame_rate = handoff.frame_rate_;
+        pts_offset = handoff.pts_offset_;
+    };
 
     while (true) {
         if (video_state->quit_) {
             break;
         }
 
-        // 非阻塞读取
-        ret = GetPacketQueue(&video_state->video_packet_queue_, &video_state->video_packet_, 0);
-        if (ret <= 0) {
-            // 意味着我们停止获取包
-            av_log(nullptr, AV_LOG_DEBUG, "Video delay 10 ms\n");
-            SDL_Delay(10);  // 没当读不到数据就等 10 ms 再看
+        // 阻塞读取, 没有包时睡在条件变量上(不轮询), 队列中止时返回 -1
+        ret = GetPacketQueue(&video_state->video_packet_queue_, &video_state->video_packet_, 1);
+        ++video_state->wakeup_count_;
+        if (ret < 0) {
+            break;
+        }
+
+        // 换轨: 旧解码器中缓存的帧直接丢弃
+        if (IsFlushPacket(&video_state->video_packet_)) {
+            av_packet_unref(&video_state->video_packet_);
+            if (std::optional<DecoderHandoff> handoff = video_state->video_handoff_.TryPop()) {
+                switch_decoder(*handoff);
+            } else {
+                avcodec_flush_buffers(video_state->video_codec_context_);
+            }
             continue;
         }
 
-        ret = avcodec_send_packet(video_state->video_codec_context_, &video_state->video_packet_);
+        // 空包表示当前条目结束: 送 nullptr 排空解码器中缓存的帧
+        bool drain = IsDrainPacket(&video_state->video_packet_);
+        int64_t decode_start{av_gettime_relative()};  // 自动调优统计每帧的解码耗时(不含等待队列)
+        ret = avcodec_send_packet(video_state->video_codec_context_, drain ? nullptr : &video_state->video_packet_);
         av_packet_unref(&video_state->video_packet_);  // 清空引用计数(因为解码器内部会拷贝一份)
         if (ret < 0) {
             av_log(nullptr, AV_LOG_ERROR, "avcodec_send_packet failed\n");
@@ -221,15 +489,75 @@ int DecodeThread(void* arg) {
             // 计算当前帧的时长
             AVRational rational{frame_rate.den, frame_rate.num};
             duration = (frame_rate.num && frame_rate.den ? av_q2d(rational) : 0);
-            pts = (video_frame->pts == AV_NOPTS_VALUE) ? NAN : video_frame->pts * av_q2d(time_base);
-            pts = SyschronizeVideo(video_state, video_frame, pts);
+            pts = (video_frame->pts == AV_NOPTS_VALUE) ? NAN : video_frame->pts * av_q2d(time_base) + pts_offset;
+            pts = SyschronizeVideo(video_state, video_frame, pts, time_base);
+
+            // SDL 纹理只接受 YUV420P, 其他格式先并行转换
+            AVFrame* picture{video_frame};
+            if (!filtering && NeedPixelConvert(video_frame->format)) {
+                if (ConvertFrame(&converter, video_frame, converted_frame) < 0) {
+                    av_frame_unref(video_frame);
+                    continue;
+                }
+                picture = converted_frame;
+            }
+
+            if (video_state->auto_tune_.collecting_) {
+                RecordDecodeTime(&video_state->auto_tune_, (av_gettime_relative() - decode_start) / 1000000.0,
+                                 duration);
+            }
 
-            // 插入到视频帧队列
-            QueuePicture(video_state, video_frame, pts, duration, video_frame->pkt_pos);
+            // 插入到视频帧队列或滤镜队列(队列中止时失败)
+            if ((filtering ? QueueFilterFrame(video_state, picture, pts, duration)
+                           : QueuePicture(video_state, picture, pts, duration, video_frame->pkt_pos)) < 0) {
+                av_frame_unref(video_frame);
+                av_frame_unref(converted_frame);
+                break;
+            }
 
             // 解引用
             av_frame_unref(video_frame);
+            av_frame_unref(converted_frame);
+            decode_start = av_gettime_relative();
+        }
+
+        // 排空后切换到读线程预加载好的下一个条目的解码器, 播放列表结束时没有交接
+        if (drain) {
+            if (std::optional<DecoderHandoff> handoff = video_state->video_handoff_.TryPop()) {
+                switch_decoder(*handoff);
+            } else {
+                // 有滤镜时由滤镜线程排空滤镜之后再结束显示队列
+                FinishFrameQueue(filtering ? &video_state->filter_frame_queue_ : &video_state->video_frame_queue_);
+            }
         }
     }
+    FreePixelConverter(&converter);
+    av_frame_free(&converted_frame);
+    av_frame_free(&video_frame);
     return 0;
-}
\ No newline at end of file
+}
+
+// 原始输出模式的视频线程: 代替刷新定时器, 帧一入队就写出去(不按时钟显示), 写不动时阻塞
+int RawVideoThread(void* arg) {
+    VideoState* video_state = static_cast<VideoState*>(arg);
+    ApplyThreadPolicy(ThreadRole::kPresent, video_state->options_.thread_policies_);
+    RawSink* sink{&video_state->raw_video_sink_};
+    AVRational frame_rate{video_state->video_stream_->avg_frame_rate};
+    while (Frame* vp = PeekReadableFrameQueue(&video_state->video_frame_queue_)) {
+        if (!WaitRawOutputResumed(video_state)) {
+            break;
+        }
+        int ret{WriteRawVideoFrame(sink, vp->frame_, frame_rate)};
+        if (ret >= 0) {
+            MarkRawSinkTime(sink, vp->pts_, vp->pts_ + vp->duration_);
+        }
+        MoveReadIndex(&video_state->video_frame_queue_);
+        if (ret < 0) {
+            sink->error_ = -1;
+            RequestQuit(video_state);  // 下游关闭或写出错: 整个管线退出, 不让另一路因为队列满而卡死
+            break;
+        }
+    }
+    FinishRawOutputThread(video_state);
+    return 0;
+}
@@ -9,13 +9,18 @@ set_warnings("allextra")
 
 add_requires("ffmpeg")
 add_requires("libsdl")
+add_requires("libsdl_ttf")  -- 文字字幕的字形光栅化
 add_requires("fmt")
+add_requires("xxhash")
 
 target("player")
     set_kind("binary")
     add_files("src/*.cpp")
     add_includedirs("include")
-    add_packages("libsdl", "ffmpeg", "fmt")
+    add_packages("libsdl", "libsdl_ttf", "ffmpeg", "fmt", "xxhash")
+    if is_plat("linux") then
+        add_syslinks("rt")  -- shm_open(旧版 glibc 在 librt 中)
+    end
     -- on_run(function (target)
     --     import("core.base.option")
     --     local argv = {}
@@ -24,3 +29,34 @@ target("player")
     --     table.insert(argv, option.get("arguments")[1])
     --     os.execv("valgrind", argv)
     -- end)
+
+-- 音频转换内核与 swr 的对比(不参与默认构建)
+target("audio_convert_bench")
+    set_kind("binary")
+    set_default(false)
+    add_files("bench/audio_convert_bench.cpp", "src/audio_kernels.cpp")
+    add_includedirs("include")
+    add_packages("libsdl", "ffmpeg")
+
+-- 管线性能回归测试: 自己生成测试媒体, 和 bench/pipeline_baseline.txt 比较(不参与默认构建)
+target("pipeline_bench")
+    set_kind("binary")
+    set_default(false)
+    add_files("bench/pipeline_bench.cpp", "bench/test_media.cpp", "src/*.cpp|main.cpp")
+    set_rundir("$(projectdir)")  -- 基线文件的默认路径相对于项目目录
+    add_includedirs("include")
+    add_packages("libsdl", "libsdl_ttf", "ffmpeg", "fmt", "xxhash")
+    if is_plat("linux") then
+        add_syslinks("rt")
+    end
+
+-- 暂停空闲测试: 暂停期间统计各线程的上下文切换, 原始输出和 SDL 播放(dummy 驱动)两条路径(不参与默认构建)
+target("pause_idle_test")
+    set_kind("binary")
+    set_default(false)
+    add_files("bench/pause_idle_test.cpp", "bench/test_media.cpp", "src/*.cpp|main.cpp")
+    add_includedirs("include")
+    add_packages("libsdl", "libsdl_ttf", "ffmpeg", "fmt", "xxhash")
+    if is_plat("linux") then
+        add_syslinks("rt")
+    end